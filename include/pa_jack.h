@@ -70,6 +70,37 @@ PaError PaJack_SetClientName( const char* name );
  */
 PaError PaJack_GetClientName(const char** clientName);
 
+/** JACK specific stream parameters, pass through PaStreamParameters.hostApiSpecificStreamInfo.
+ *
+ * These only affect blocking streams (i.e., streams opened without a callback), which exchange data with the JACK
+ * process callback through a FIFO per direction. The settings given with the input parameters apply to the input
+ * FIFO and Pa_ReadStream, those given with the output parameters to the output FIFO and Pa_WriteStream.
+ */
+typedef struct PaJackStreamInfo
+{
+    unsigned long size;             /**< sizeof (PaJackStreamInfo) */
+    PaHostApiTypeId hostApiType;    /**< paJACK */
+    unsigned long version;          /**< 1 */
+
+    /** Depth of the FIFO in frames, or 0 to derive it from suggestedLatency as usual.
+     *
+     * The depth is rounded up to a power of 2 and must hold at least one JACK period, otherwise Pa_OpenStream fails
+     * with paBufferTooSmall. A deep FIFO rides out longer stalls of the reading or writing thread, at the cost of
+     * latency.
+     */
+    unsigned long fifoFrames;
+
+    /** Number of frames that must become available before a blocked Pa_ReadStream/Pa_WriteStream is woken, or 0 to
+     * only wake it once its whole remaining request can be carried out. Smaller values let the call make progress
+     * in smaller steps, at the cost of more wakeups.
+     */
+    unsigned long wakeupFrames;
+}
+PaJackStreamInfo;
+
+/** Initialize host API specific structure, call this before setting relevant attributes. */
+void PaJack_InitializeStreamInfo( PaJackStreamInfo *info );
+
 #ifdef __cplusplus
 }
 #endif
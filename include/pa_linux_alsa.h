@@ -57,6 +57,18 @@ typedef struct PaAlsaStreamInfo
     unsigned long version;
 
     const char *deviceString;
+
+    /* Version 2 */
+
+    /** Open several devices as one aggregate device instead of deviceString, if not 0.
+     *
+     * The channels of the member devices are presented contiguously, in the order of the members. The members are
+     * linked so that they start and stop together, but there is no compensation for drift between their clocks,
+     * hence they should share a clock source (e.g. word clock or an S/PDIF slave) for prolonged use.
+     */
+    unsigned long aggregateDeviceCount;
+    const char * const *aggregateDeviceStrings;  /**< ALSA device strings of the members */
+    const int *aggregateChannelCounts;           /**< Number of channels to use from each member */
 }
 PaAlsaStreamInfo;
 
@@ -70,6 +82,43 @@ void PaAlsa_InitializeStreamInfo( PaAlsaStreamInfo *info );
  **/
 void PaAlsa_EnableRealtimeScheduling( PaStream *s, int enable );
 
+/** Value of the Linux SCHED_DEADLINE policy, for PaAlsaThreadScheduling.policy. */
+#define paAlsaSchedDeadline 6
+
+/** Scheduling of the audio callback thread, see PaAlsa_SetStreamScheduling. */
+typedef struct PaAlsaThreadScheduling
+{
+    int policy;                 /**< SCHED_OTHER, SCHED_FIFO, SCHED_RR or paAlsaSchedDeadline */
+    int priority;               /**< Static priority for SCHED_FIFO and SCHED_RR */
+    /** For paAlsaSchedDeadline, the fraction of each host buffer period reserved as runtime for the thread. The
+     * period (and deadline) is the duration of a host buffer. */
+    double deadlineUtilization;
+    double deadlinePeriod;      /**< Output only: the SCHED_DEADLINE period in seconds */
+    /** Bit i allows the thread to run on CPU i, 0 for no restriction. Must be 0 for paAlsaSchedDeadline, the kernel
+     * doesn't admit SCHED_DEADLINE threads with a restricted affinity. */
+    unsigned long long cpuMask;
+    int granted;                /**< Output only: non-zero if the requested scheduling took effect in full */
+}
+PaAlsaThreadScheduling;
+
+/** Configure the scheduling of the audio callback thread, instead of SCHED_FIFO at priority 1.
+ *
+ * This implies PaAlsa_EnableRealtimeScheduling and takes effect when the stream is next started. If the policy can't
+ * be applied for lack of privileges the thread runs with what it has got, SCHED_DEADLINE falls back to SCHED_FIFO.
+ * Check the granted field from PaAlsa_GetStreamScheduling for the outcome. Pa_StartStream fails with
+ * paInternalError if the policy is refused for any other reason.
+ *
+ * @return paInvalidFlag for an unknown policy, a priority outside the policy's range or paAlsaSchedDeadline combined
+ * with a cpuMask.
+ */
+PaError PaAlsa_SetStreamScheduling( PaStream *s, const PaAlsaThreadScheduling *scheduling );
+
+/** Get the scheduling in effect for the callback thread of a running stream.
+ *
+ * @return paStreamIsStopped if there is no callback thread, i.e. the stream is stopped or in blocking mode.
+ */
+PaError PaAlsa_GetStreamScheduling( PaStream *s, PaAlsaThreadScheduling *scheduling );
+
 #if 0
 void PaAlsa_EnableWatchdog( PaStream *s, int enable );
 #endif
@@ -80,6 +129,63 @@ PaError PaAlsa_GetStreamInputCard( PaStream *s, int *card );
 /** Get the ALSA-lib card index of this stream's output device. */
 PaError PaAlsa_GetStreamOutputCard( PaStream *s, int *card );
 
+/** Discard output that has been queued but not played yet, so that it is rendered again.
+ *
+ * This allows a stream to run with a deep buffer for robustness against underruns, while still reacting
+ * quickly to changes in what should be heard: all queued output beyond the first safetyFrames frames is
+ * rewound (see snd_pcm_rewind) and then produced again. In callback mode the stream callback is invoked
+ * for it again, the rewind takes place in the callback thread before it next waits for the device. Output
+ * which PortAudio holds back to adapt the callback buffer size is discarded as well.
+ * Combine a small period size with a large number of periods (see PaAlsa_SetNumPeriods) for quick
+ * reaction. In blocking mode the rewind takes effect immediately, the frames must be written again and
+ * this must not be called concurrently with Pa_WriteStream.
+ *
+ * Not all devices can rewind all of their queued output, in which case less or nothing is rewound.
+ * @param safetyFrames The number of queued frames to keep, as a margin against underrun while
+ * rendering again.
+ * @param framesRewound If not NULL, receives the number of frames rewound in blocking mode, in
+ * callback mode it is always 0 since the rewind is deferred.
+ */
+PaError PaAlsa_InvalidateStreamOutput( PaStream *s, unsigned long safetyFrames, unsigned long *framesRewound );
+
+/** Xrun statistics of one direction of an ALSA stream, see PaAlsa_GetStreamXrunInfo. */
+typedef struct PaAlsaXrunDirectionInfo
+{
+    unsigned long xrunCount;    /**< Number of underruns (output) or overruns (input) */
+    PaTime lastXrunTime;        /**< When the last xrun occurred, on the clock of Pa_GetStreamTime, 0 if none did */
+    unsigned long framesLost;   /**< Frames lost between the xruns occurring and their detection, in total */
+    int lastXrunState;          /**< The snd_pcm_state_t of the pcm when the last xrun was detected */
+}
+PaAlsaXrunDirectionInfo;
+
+/** Xrun statistics of an ALSA stream, accumulated since the stream was opened. */
+typedef struct PaAlsaXrunInfo
+{
+    PaAlsaXrunDirectionInfo input;
+    PaAlsaXrunDirectionInfo output;
+    unsigned long restartCount;     /**< Number of times the pcms had to be restarted to recover */
+    PaTime restartTime;             /**< Seconds spent restarting the pcms, in total */
+    PaTime lastRestartDuration;     /**< Seconds spent on the last restart */
+}
+PaAlsaXrunInfo;
+
+/** Retrieve the xrun statistics of a stream.
+ *
+ * The statistics are updated by the thread recovering from xruns without taking locks, this function may be called
+ * from any thread and returns a consistent snapshot.
+ * @param s The stream to query.
+ * @param info Receives the statistics.
+ */
+PaError PaAlsa_GetStreamXrunInfo( PaStream *s, PaAlsaXrunInfo *info );
+
+/** Convert a stream time (see Pa_GetStreamTime and PaStreamCallbackTimeInfo) to wall clock time, for logging.
+ *
+ * Stream times are taken from a monotonic clock, so they don't jump when the wall clock is stepped. The current offset
+ * between the clocks is applied.
+ * @param realtime Receives the corresponding number of seconds since the epoch.
+ */
+PaError PaAlsa_StreamTimeToRealtime( PaStream *s, PaTime streamTime, PaTime *realtime );
+
 /** Set the number of periods (buffer fragments) to configure devices with.
  *
  * By default the number of periods is 4, this is the lowest number of periods that works well on
@@ -93,6 +199,55 @@ PaError PaAlsa_SetNumPeriods( int numPeriods );
  */
 PaError PaAlsa_SetRetriesBusy( int retries );
 
+/** Set the maximum number of closed streams whose pcms are kept open and configured for reuse.
+ *
+ * When a stream is closed its pcms are put in a pool instead of being closed. Opening a stream with the
+ * same devices, channel counts, sample formats, suggested latencies, sample rate and frames per buffer
+ * then reuses the pooled pcms, skipping device opening and hardware parameter negotiation. The least
+ * recently used pcms are closed when the pool is full. Pooled devices remain busy to other clients.
+ * Streams opened through PaAlsaStreamInfo are not pooled.
+ *
+ * By default the pool size is 0, i.e. pooling is disabled. Reducing the size closes excess pcms, all
+ * pooled pcms are closed when PortAudio is terminated.
+ * @param maxPooledStreams The maximum number of pooled streams.
+ */
+PaError PaAlsa_SetPcmPoolSize( int maxPooledStreams );
+
+/** Called when a sound card is added to or removed from the system.
+ * @param card The ALSA card number.
+ * @param added Nonzero if the card was added, zero if it was removed.
+ * @param userData The userData passed to PaAlsa_SetDeviceChangeCallback.
+ */
+typedef void PaAlsaDeviceChangeCallback( int card, int added, void *userData );
+
+/** Set a function to be called when sound cards are added or removed, e.g. USB devices being plugged in.
+ *
+ * The device nodes in /dev/snd (or the directory named by the PA_ALSA_DEVICE_DIR environment variable)
+ * are monitored from a separate thread, which also calls the callback. The callback shouldn't call
+ * PortAudio, rather it should signal the application to call PaAlsa_RefreshDeviceList. Passing NULL
+ * stops monitoring.
+ */
+PaError PaAlsa_SetDeviceChangeCallback( PaAlsaDeviceChangeCallback *callback, void *userData );
+
+/** Update the ALSA device list after sound cards have been added or removed, without reinitializing
+ * PortAudio.
+ *
+ * Only the hardware devices of changed cards are probed. The indices of ALSA devices stay valid: the devices of
+ * a removed card remain in the list with zero channels and a device reappearing under the same name takes its
+ * old index.
+ *
+ * New devices take the place of reserved devices. Pa_Initialize reserves as many as the PA_ALSA_RESERVED_DEVICES
+ * environment variable says (none by default), listed as zero channel devices named "(reserved)". Once there
+ * are no reserved devices left, new devices are appended, which changes the PaDeviceIndex of every device of
+ * the host APIs following ALSA (e.g. OSS and JACK). Applications that keep such indices should reserve enough
+ * devices, or look the devices up again when devicesChanged is set.
+ *
+ * If any card changed, PaDeviceInfo pointers obtained before the call are invalid afterwards. Open streams are
+ * unaffected. Must not be called concurrently with other PortAudio functions.
+ * @param devicesChanged If non-NULL, receives nonzero if any device was added or removed.
+ */
+PaError PaAlsa_RefreshDeviceList( int *devicesChanged );
+
 /** Set the path and name of ALSA library file if PortAudio is configured to load it dynamically (see
  *  PA_ALSA_DYNAMIC). This setting will overwrite the default name set by PA_ALSA_PATHNAME define.
  * @param pathName Full path with filename. Only filename can be used, but dlopen() will lookup default
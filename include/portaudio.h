@@ -100,7 +100,8 @@ typedef enum PaErrorCode
     paCanNotReadFromAnOutputOnlyStream,
     paCanNotWriteToAnInputOnlyStream,
     paIncompatibleStreamHostApi,
-    paBadBufferPtr
+    paBadBufferPtr,
+    paInvalidArgument
 } PaErrorCode;
 
 
@@ -578,7 +579,7 @@ PaError Pa_IsFormatSupported( const PaStreamParameters *inputParameters,
 
  @see Pa_OpenStream, Pa_OpenDefaultStream, Pa_OpenDefaultStream, Pa_CloseStream,
  Pa_StartStream, Pa_StopStream, Pa_AbortStream, Pa_IsStreamActive,
- Pa_GetStreamTime, Pa_GetStreamCpuLoad
+ Pa_GetStreamTime, Pa_GetStreamCpuLoad, Pa_GetStreamStatistics
 
 */
 typedef void PaStream;
@@ -597,7 +598,8 @@ typedef void PaStream;
 
  @see Pa_OpenStream, Pa_OpenDefaultStream
  @see paNoFlag, paClipOff, paDitherOff, paNeverDropInput,
-  paPrimeOutputBuffersUsingStreamCallback, paPlatformSpecificFlags
+  paPrimeOutputBuffersUsingStreamCallback, paLockStreamMemory,
+  paPlatformSpecificFlags
 */
 typedef unsigned long PaStreamFlags;
 
@@ -633,6 +635,18 @@ typedef unsigned long PaStreamFlags;
 */
 #define   paPrimeOutputBuffersUsingStreamCallback ((PaStreamFlags) 0x00000008)
 
+/** Prefault and lock into physical memory the buffers owned by the stream,
+ and pre-grow the stack of the stream's callback thread, so that the audio
+ thread does not take page faults while the stream is running. The number of
+ bytes actually locked is reported in PaStreamInfo::lockedMemorySize; it may
+ be less than requested if the process's locked memory limit is too low.
+ Setting the PA_MLOCKALL environment variable to a nonzero value before
+ Pa_Initialize() additionally locks the whole process with mlockall() on
+ systems which support it.
+ @see PaStreamInfo
+*/
+#define   paLockStreamMemory ((PaStreamFlags) 0x00000010)
+
 /** A mask specifying the platform specific bits.
  @see PaStreamFlags
 */
@@ -1014,6 +1028,14 @@ typedef struct PaStreamInfo
      parameter passed to Pa_OpenStream().
     */
     double sampleRate;
+
+    /** The number of bytes of stream-owned memory which were locked into
+     physical memory when the stream was opened with the paLockStreamMemory
+     flag. The value of this field will be zero (0) if the flag was not
+     passed, or if the host API or platform does not support memory locking.
+     @see paLockStreamMemory
+    */
+    unsigned long lockedMemorySize;
     
 } PaStreamInfo;
 
@@ -1071,6 +1093,110 @@ PaTime Pa_GetStreamTime( PaStream *stream );
 double Pa_GetStreamCpuLoad( PaStream* stream );
 
 
+/** The number of bins in PaStreamStatistics::wakeupJitterHistogram. */
+#define paWakeupJitterBinCount (6)
+
+
+/** A structure containing statistics of a callback stream: its CPU load,
+ callback execution times, wakeup jitter and xrun counts. Unlike
+ Pa_GetStreamCpuLoad() these show the spikes that cause buffer underflows.
+ Loads are fractions of the available CPU time, as for Pa_GetStreamCpuLoad().
+
+ @see Pa_GetStreamStatistics
+*/
+typedef struct PaStreamStatistics
+{
+    /** this is struct version 2 */
+    int structVersion;
+
+    /** The smoothed load, the same value Pa_GetStreamCpuLoad() returns. */
+    double cpuLoad;
+
+    /** The highest load of a single callback since the stream was started. */
+    double peakCpuLoad;
+
+    /** Percentiles of the load of single callbacks since the stream was
+     started. These are taken from a histogram with buckets a quarter octave
+     wide, so they are accurate to about 19%, and err on the high side.
+    */
+    double medianCpuLoad;
+    double p99CpuLoad;
+    double p999CpuLoad;
+
+    /** The number of callbacks the statistics are based on. */
+    unsigned long cpuLoadMeasurementCount;
+
+    /** The number of times the stream callback has been called. */
+    unsigned long callbackCount;
+
+    /** The shortest, mean and longest execution time of the stream callback,
+     in seconds.
+    */
+    PaTime minCallbackDuration;
+    PaTime meanCallbackDuration;
+    PaTime maxCallbackDuration;
+
+    /** The number of callbacks which ran for longer than the duration of the
+     frames they were asked to process. A stream can't keep up while this
+     happens repeatedly.
+    */
+    unsigned long overBudgetCallbackCount;
+
+    /** Wakeup jitter is the difference between the time the host delivered a
+     buffer and the time expected from the duration of the previous one. Buffers
+     delivered together in one wakeup are counted once. The mean and largest
+     jitter are in seconds.
+    */
+    unsigned long wakeupCount;
+    PaTime meanWakeupJitter;
+    PaTime maxWakeupJitter;
+
+    /** The number of wakeups by jitter, as a fraction of the expected
+     interval: less than 1/16, 1/16 to 1/8, 1/8 to 1/4, 1/4 to 1/2, 1/2 to 1 and
+     a whole period or more.
+    */
+    unsigned long wakeupJitterHistogram[paWakeupJitterBinCount];
+
+    /** The number of callbacks which were passed each of the
+     paInputUnderflow, paInputOverflow, paOutputUnderflow and
+     paOutputOverflow status flags.
+    */
+    unsigned long inputUnderflowCount;
+    unsigned long inputOverflowCount;
+    unsigned long outputUnderflowCount;
+    unsigned long outputOverflowCount;
+} PaStreamStatistics;
+
+
+/** Retrieve statistics of the specified stream. The statistics are reset
+ when the stream is started. All values are zero for blocking read/write
+ streams.
+
+ This function may be called from the stream callback function or the
+ application, it doesn't block the stream callback.
+
+ @param stream The stream to retrieve statistics for.
+
+ @param statistics A pointer to a PaStreamStatistics structure which will be
+ filled in.
+
+ @return paNoError on success, or an error code if stream is not valid.
+
+ @see PaStreamStatistics
+*/
+PaError Pa_GetStreamStatistics( PaStream* stream, PaStreamStatistics* statistics );
+
+
+/** Set the time constant, in seconds, of the filter which smooths the value
+ returned by Pa_GetStreamCpuLoad(). A longer time constant gives a steadier
+ value which is slower to follow changes. The default is 0.05 seconds.
+ Has no effect on blocking read/write streams.
+
+ @return paNoError on success, or an error code if stream is not valid.
+*/
+PaError Pa_SetStreamCpuLoadTimeConstant( PaStream* stream, PaTime timeConstant );
+
+
 /** Read samples from an input stream. The function doesn't return until
  the entire buffer has been filled - this may involve waiting for the operating
  system to supply the data.
@@ -1157,6 +1283,48 @@ signed long Pa_GetStreamWriteAvailable( PaStream* stream );
 PaError Pa_GetSampleSize( PaSampleFormat format );
 
 
+/** Categories of memory allocated by PortAudio.
+ @see Pa_GetMemoryUsage
+*/
+typedef enum PaMemoryCategory
+{
+    paMemoryGeneral=0,          /**< allocations not covered by another category */
+    paMemoryDeviceInfo,         /**< host API and device information */
+    paMemoryBufferProcessor,    /**< sample format conversion and buffer adaption */
+    paMemoryHostApiStream,      /**< host API specific stream state and buffers */
+    paMemoryRingBuffer,         /**< ring buffers, such as those of blocking streams */
+    paMemoryTotal               /**< the sum of all other categories */
+} PaMemoryCategory;
+
+
+/** A structure containing the memory usage of a PaMemoryCategory.
+ @see Pa_GetMemoryUsage
+*/
+typedef struct PaMemoryUsage
+{
+    unsigned long currentBytes;     /**< bytes currently allocated */
+    unsigned long peakBytes;        /**< the highest value currentBytes has had */
+    unsigned long currentBlocks;    /**< blocks currently allocated */
+    unsigned long totalAllocations; /**< blocks allocated since the process started */
+} PaMemoryUsage;
+
+
+/** Retrieve the amount of memory PortAudio has allocated for a category.
+ Memory is accounted for from the start of the process, so this function may
+ be called whether or not PortAudio is initialized. Bytes are counted as
+ requested, allocator overhead isn't included.
+
+ @param category The category to retrieve usage for, or paMemoryTotal for
+ the sum of all categories.
+
+ @param usage A pointer to a PaMemoryUsage structure which will be filled in.
+
+ @return paNoError on success, or paInvalidArgument if category is not a
+ valid PaMemoryCategory, in which case usage is left unchanged.
+*/
+PaError Pa_GetMemoryUsage( PaMemoryCategory category, PaMemoryUsage *usage );
+
+
 /** Put the caller to sleep for at least 'msec' milliseconds. This function is
  provided only as a convenience for authors of portable code (such as the tests
  and examples in the PortAudio distribution.)
@@ -44,82 +44,102 @@
 */
 
 
+#include <assert.h>
+#include <stddef.h> /* for size_t */
+
 #include "pa_allocation.h"
 #include "pa_util.h"
 
 
 /*
-    Maintain 3 singly linked lists...
-    linkBlocks: the buffers used to allocate the links
-    spareLinks: links available for use in the allocations list
-    allocations: the buffers currently allocated using PaUtil_ContextAllocateMemory()
+    Blocks are carved out of chunks by bumping an offset. The group keeps
+    two singly linked lists...
+    chunks: regular chunks, the first one is the one currently being filled
+    largeChunks: chunks which hold a single block too large to share a chunk
 
-    Link block size is doubled every time new links are allocated.
+    The regular chunk size is doubled every time a new chunk is allocated,
+    up to PA_MAX_CHUNK_SIZE_.
 */
 
 
-#define PA_INITIAL_LINK_COUNT_    16
+#define PA_INITIAL_CHUNK_SIZE_    4096
+#define PA_MAX_CHUNK_SIZE_        65536
 
-struct PaUtilAllocationGroupLink
+struct PaUtilAllocationGroupChunk
 {
-    struct PaUtilAllocationGroupLink *next;
-    void *buffer;
+    struct PaUtilAllocationGroupChunk *next;
+    char *base;         /* block space, following this header */
+    long size;          /* bytes of block space */
+    long used;          /* offset of the first unused byte */
+    long lastOffset;    /* offset of the most recent block, or -1 */
 };
 
-/*
-    Allocate a block of links. The first link will have it's buffer member
-    pointing to the block, and it's next member set to <nextBlock>. The remaining
-    links will have NULL buffer members, and each link will point to
-    the next link except the last, which will point to <nextSpare>
-*/
-static struct PaUtilAllocationGroupLink *AllocateLinks( long count,
-        struct PaUtilAllocationGroupLink *nextBlock,
-        struct PaUtilAllocationGroupLink *nextSpare )
-{
-    struct PaUtilAllocationGroupLink *result;
-    int i;
-    
-    result = (struct PaUtilAllocationGroupLink *)PaUtil_AllocateMemory(
-            sizeof(struct PaUtilAllocationGroupLink) * count );
+
+static long AlignOffset( const char *base, long offset, long alignment )
+{
+    size_t address = (size_t)(base + offset);
+    return offset + (long)(((address + alignment - 1) & ~(size_t)(alignment - 1)) - address);
+}
+
+
+static struct PaUtilAllocationGroupChunk *AllocateChunk( long size, PaMemoryCategory category )
+{
+    struct PaUtilAllocationGroupChunk *result;
+
+    result = (struct PaUtilAllocationGroupChunk *)PaUtil_AllocateTaggedMemory(
+            sizeof(struct PaUtilAllocationGroupChunk) + size, category );
     if( result )
     {
-        /* the block link */
-        result[0].buffer = result;
-        result[0].next = nextBlock;
-
-        /* the spare links */
-        for( i=1; i<count; ++i )
-        {
-            result[i].buffer = 0;
-            result[i].next = &result[i+1];
-        }
-        result[count-1].next = nextSpare;
+        result->next = 0;
+        result->base = (char *)(result + 1);
+        result->size = size;
+        result->used = 0;
+        result->lastOffset = -1;
     }
-    
+
     return result;
 }
 
 
+static void FreeChunks( struct PaUtilAllocationGroupChunk *chunk )
+{
+    struct PaUtilAllocationGroupChunk *next;
+
+    while( chunk )
+    {
+        next = chunk->next;
+        PaUtil_FreeMemory( chunk );
+        chunk = next;
+    }
+}
+
+
 PaUtilAllocationGroup* PaUtil_CreateAllocationGroup( void )
+{
+    return PaUtil_CreateTaggedAllocationGroup( paMemoryGeneral );
+}
+
+
+PaUtilAllocationGroup* PaUtil_CreateTaggedAllocationGroup( PaMemoryCategory category )
 {
     PaUtilAllocationGroup* result = 0;
-    struct PaUtilAllocationGroupLink *links;
+    struct PaUtilAllocationGroupChunk *chunk;
 
 
-    links = AllocateLinks( PA_INITIAL_LINK_COUNT_, 0, 0 );
-    if( links != 0 )
+    chunk = AllocateChunk( PA_INITIAL_CHUNK_SIZE_, category );
+    if( chunk != 0 )
     {
-        result = (PaUtilAllocationGroup*)PaUtil_AllocateMemory( sizeof(PaUtilAllocationGroup) );
+        result = (PaUtilAllocationGroup*)PaUtil_AllocateTaggedMemory( sizeof(PaUtilAllocationGroup), category );
         if( result )
         {
-            result->linkCount = PA_INITIAL_LINK_COUNT_;
-            result->linkBlocks = &links[0];
-            result->spareLinks = &links[1];
-            result->allocations = 0;
+            result->category = category;
+            result->chunkSize = PA_INITIAL_CHUNK_SIZE_ * 2;
+            result->chunks = chunk;
+            result->largeChunks = 0;
         }
         else
         {
-            PaUtil_FreeMemory( links );
+            PaUtil_FreeMemory( chunk );
         }
     }
 
@@ -129,69 +149,77 @@ PaUtilAllocationGroup* PaUtil_CreateAllocationGroup( void )
 
 void PaUtil_DestroyAllocationGroup( PaUtilAllocationGroup* group )
 {
-    struct PaUtilAllocationGroupLink *current = group->linkBlocks;
-    struct PaUtilAllocationGroupLink *next;
-
-    while( current )
-    {
-        next = current->next;
-        PaUtil_FreeMemory( current->buffer );
-        current = next;
-    }
+    FreeChunks( group->chunks );
+    FreeChunks( group->largeChunks );
 
     PaUtil_FreeMemory( group );
 }
 
 
-void* PaUtil_GroupAllocateMemory( PaUtilAllocationGroup* group, long size )
+void* PaUtil_GroupAllocateAlignedMemory( PaUtilAllocationGroup* group, long size, long alignment )
 {
-    struct PaUtilAllocationGroupLink *links, *link;
-    void *result = 0;
-    
-    /* allocate more links if necessary */
-    if( !group->spareLinks )
+    struct PaUtilAllocationGroupChunk *chunk = group->chunks;
+    long offset;
+
+    if( size <= 0 || alignment <= 0 || (alignment & (alignment - 1)) != 0 )
+        return 0;
+
+    /* large blocks get a chunk of their own, so they can be freed individually */
+    if( size + alignment > group->chunkSize / 4 )
     {
-        /* double the link count on each block allocation */
-        links = AllocateLinks( group->linkCount, group->linkBlocks, group->spareLinks );
-        if( links )
-        {
-            group->linkCount += group->linkCount;
-            group->linkBlocks = &links[0];
-            group->spareLinks = &links[1];
-        }
+        chunk = AllocateChunk( size + alignment - 1, group->category );
+        if( !chunk )
+            return 0;
+
+        chunk->lastOffset = AlignOffset( chunk->base, 0, alignment );
+        chunk->used = chunk->lastOffset + size;
+        chunk->next = group->largeChunks;
+        group->largeChunks = chunk;
+
+        return chunk->base + chunk->lastOffset;
     }
 
-    if( group->spareLinks )
+    offset = chunk ? AlignOffset( chunk->base, chunk->used, alignment ) : 0;
+    if( !chunk || offset + size > chunk->size )
     {
-        result = PaUtil_AllocateMemory( size );
-        if( result )
-        {
-            link = group->spareLinks;
-            group->spareLinks = link->next;
+        /* start a new chunk, the unused tail of the current one is abandoned */
+        chunk = AllocateChunk( group->chunkSize, group->category );
+        if( !chunk )
+            return 0;
 
-            link->buffer = result;
-            link->next = group->allocations;
+        if( group->chunkSize < PA_MAX_CHUNK_SIZE_ )
+            group->chunkSize += group->chunkSize;
+        chunk->next = group->chunks;
+        group->chunks = chunk;
 
-            group->allocations = link;
-        }
+        offset = AlignOffset( chunk->base, 0, alignment );
     }
 
-    return result;    
+    chunk->lastOffset = offset;
+    chunk->used = offset + size;
+
+    return chunk->base + offset;
+}
+
+
+void* PaUtil_GroupAllocateMemory( PaUtilAllocationGroup* group, long size )
+{
+    return PaUtil_GroupAllocateAlignedMemory( group, size, PA_ALLOCATION_DEFAULT_ALIGNMENT );
 }
 
 
 void PaUtil_GroupFreeMemory( PaUtilAllocationGroup* group, void *buffer )
 {
-    struct PaUtilAllocationGroupLink *current = group->allocations;
-    struct PaUtilAllocationGroupLink *previous = 0;
+    struct PaUtilAllocationGroupChunk *current = group->largeChunks;
+    struct PaUtilAllocationGroupChunk *previous = 0;
 
     if( buffer == 0 )
         return;
 
-    /* find the right link and remove it */
+    /* large blocks are released along with their chunk */
     while( current )
     {
-        if( current->buffer == buffer )
+        if( current->base + current->lastOffset == (char *)buffer )
         {
             if( previous )
             {
@@ -199,45 +227,135 @@ void PaUtil_GroupFreeMemory( PaUtilAllocationGroup* group, void *buffer )
             }
             else
             {
-                group->allocations = current->next;
+                group->largeChunks = current->next;
             }
 
-            current->buffer = 0;
-            current->next = group->spareLinks;
-            group->spareLinks = current;
-
-            break;
+            PaUtil_FreeMemory( current );
+            return;
         }
         
         previous = current;
         current = current->next;
     }
 
-    PaUtil_FreeMemory( buffer ); /* free the memory whether we found it in the list or not */
+    /* the most recent block of the current chunk can be given back, other
+       blocks stay allocated until the whole group is freed */
+    current = group->chunks;
+    if( current && current->lastOffset >= 0 && current->base + current->lastOffset == (char *)buffer )
+    {
+        current->used = current->lastOffset;
+        current->lastOffset = -1;
+    }
 }
 
 
 void PaUtil_FreeAllAllocations( PaUtilAllocationGroup* group )
 {
-    struct PaUtilAllocationGroupLink *current = group->allocations;
-    struct PaUtilAllocationGroupLink *previous = 0;
+    FreeChunks( group->largeChunks );
+    group->largeChunks = 0;
 
-    /* free all buffers in the allocations list */
-    while( current )
+    /* keep the current, largest, chunk for reuse */
+    if( group->chunks )
     {
-        PaUtil_FreeMemory( current->buffer );
-        current->buffer = 0;
-
-        previous = current;
-        current = current->next;
+        FreeChunks( group->chunks->next );
+        group->chunks->next = 0;
+        group->chunks->used = 0;
+        group->chunks->lastOffset = -1;
     }
+}
+
+
+long PaUtil_LockAllocationGroup( PaUtilAllocationGroup* group )
+{
+    struct PaUtilAllocationGroupChunk *current;
+    long result = 0;
+
+    for( current = group->chunks; current; current = current->next )
+        result += PaUtil_LockMemory( current, sizeof(struct PaUtilAllocationGroupChunk) + current->size );
+    for( current = group->largeChunks; current; current = current->next )
+        result += PaUtil_LockMemory( current, sizeof(struct PaUtilAllocationGroupChunk) + current->size );
 
-    /* link the former allocations list onto the front of the spareLinks list */
-    if( previous )
+    return result;
+}
+
+
+PaUtilFixedPool* PaUtil_CreateFixedPool( long blockSize, long capacity, long alignment )
+{
+    PaUtilFixedPool *result;
+    char *storage;
+    long i;
+
+    if( alignment == 0 )
+        alignment = PA_ALLOCATION_DEFAULT_ALIGNMENT;
+    if( blockSize <= 0 || capacity <= 0 || alignment < 0 || (alignment & (alignment - 1)) != 0 )
+        return 0;
+
+    /* every block must be able to hold the free list link, and keep the alignment of the next block */
+    if( blockSize < (long)sizeof(void*) )
+        blockSize = sizeof(void*);
+    blockSize = (blockSize + alignment - 1) & ~(alignment - 1);
+
+    result = (PaUtilFixedPool*)PaUtil_AllocateMemory( sizeof(PaUtilFixedPool) + blockSize * capacity + alignment - 1 );
+    if( !result )
+        return 0;
+
+    storage = (char *)(result + 1);
+    result->storage = storage + AlignOffset( storage, 0, alignment );
+    result->blockSize = blockSize;
+    result->capacity = capacity;
+    result->availableCount = capacity;
+
+    /* thread the free list through the blocks, in address order */
+    for( i = 0; i < capacity - 1; ++i )
+        *(void **)(result->storage + i * blockSize) = result->storage + (i + 1) * blockSize;
+    *(void **)(result->storage + (capacity - 1) * blockSize) = 0;
+    result->freeList = result->storage;
+
+    return result;
+}
+
+
+void PaUtil_DestroyFixedPool( PaUtilFixedPool* pool )
+{
+    PaUtil_FreeMemory( pool );
+}
+
+
+void* PaUtil_FixedPoolAllocate( PaUtilFixedPool* pool )
+{
+    void *result = pool->freeList;
+
+    if( result )
     {
-        previous->next = group->spareLinks;
-        group->spareLinks = group->allocations;
-        group->allocations = 0;
+        pool->freeList = *(void **)result;
+        --pool->availableCount;
     }
+
+    return result;
+}
+
+
+void PaUtil_FixedPoolFree( PaUtilFixedPool* pool, void *block )
+{
+    if( block == 0 )
+        return;
+
+    assert( (char *)block >= pool->storage && (char *)block < pool->storage + pool->blockSize * pool->capacity );
+    assert( ((char *)block - pool->storage) % pool->blockSize == 0 );
+
+    *(void **)block = pool->freeList;
+    pool->freeList = block;
+    ++pool->availableCount;
 }
 
+
+long PaUtil_GetFixedPoolAvailable( const PaUtilFixedPool* pool )
+{
+    return pool->availableCount;
+}
+
+
+long PaUtil_LockFixedPool( PaUtilFixedPool* pool )
+{
+    return PaUtil_LockMemory( pool->storage, pool->blockSize * pool->capacity );
+}
@@ -51,52 +51,145 @@
  a list of allocated blocks, and can free all allocations at once. This
  can be usefull for cleaning up after a partially initialized object fails.
 
+ Allocation groups are arenas: small blocks are carved out of large
+ contiguous chunks by bumping a pointer, so opening an object which makes
+ many small allocations only calls the system allocator a few times, and
+ freeing the group doesn't depend on the number of blocks. Blocks which
+ are large compared to the chunk size get a chunk of their own.
+
+ The fixed pool provides blocks of a single size from storage reserved up
+ front. Allocating and freeing a pool block takes constant time and never
+ calls the system allocator, so it may be used from a real-time thread.
+
  The allocation group implementation is built on top of the lower
  level allocation functions defined in pa_util.h
 */
 
 
+#include "portaudio.h"
+
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif /* __cplusplus */
 
 
+/** The alignment of blocks returned by PaUtil_GroupAllocateMemory. */
+#define PA_ALLOCATION_DEFAULT_ALIGNMENT     16
+
+/** An alignment which keeps blocks from sharing cache lines with other
+ blocks, for PaUtil_GroupAllocateAlignedMemory and PaUtil_CreateFixedPool.
+*/
+#define PA_ALLOCATION_CACHE_LINE_ALIGNMENT  64
+
+
 typedef struct
 {
-    long linkCount;
-    struct PaUtilAllocationGroupLink *linkBlocks;
-    struct PaUtilAllocationGroupLink *spareLinks;
-    struct PaUtilAllocationGroupLink *allocations;
+    PaMemoryCategory category;  /**< the category chunks are accounted for in */
+    long chunkSize;     /**< the size of the next regular chunk, doubled on every chunk allocation */
+    struct PaUtilAllocationGroupChunk *chunks;      /**< regular chunks, blocks are carved from the first */
+    struct PaUtilAllocationGroupChunk *largeChunks; /**< chunks holding a single large block */
 }PaUtilAllocationGroup;
 
 
 
-/** Create an allocation group.
+/** Create an allocation group. Its memory is accounted for as paMemoryGeneral.
 */
 PaUtilAllocationGroup* PaUtil_CreateAllocationGroup( void );
 
-/** Destroy an allocation group, but not the memory allocated through the group.
+/** Create an allocation group whose memory is accounted for in category.
+ @see Pa_GetMemoryUsage
+*/
+PaUtilAllocationGroup* PaUtil_CreateTaggedAllocationGroup( PaMemoryCategory category );
+
+/** Destroy an allocation group. Since blocks live in the group's chunks this
+ also releases any blocks which haven't been freed with
+ PaUtil_FreeAllAllocations.
 */
 void PaUtil_DestroyAllocationGroup( PaUtilAllocationGroup* group );
 
-/** Allocate a block of memory though an allocation group.
+/** Allocate a block of memory though an allocation group. The block is
+ aligned to PA_ALLOCATION_DEFAULT_ALIGNMENT.
 */
 void* PaUtil_GroupAllocateMemory( PaUtilAllocationGroup* group, long size );
 
+/** Allocate a block of memory though an allocation group, aligned to
+ alignment bytes. alignment must be a power of two.
+ @see PA_ALLOCATION_CACHE_LINE_ALIGNMENT
+*/
+void* PaUtil_GroupAllocateAlignedMemory( PaUtilAllocationGroup* group, long size, long alignment );
+
 /** Free a block of memory that was previously allocated though an allocation
- group. Calling this function is a relatively time consuming operation.
- Under normal circumstances clients should call PaUtil_FreeAllAllocations to
- free all allocated blocks simultaneously.
+ group. Only large blocks, which have a chunk of their own, and the most
+ recently allocated block are actually released, other blocks are kept
+ until PaUtil_FreeAllAllocations is called. Under normal circumstances
+ clients should call PaUtil_FreeAllAllocations to free all allocated blocks
+ simultaneously. Blocks which must be returned to the system individually,
+ for example a scratch buffer released before the group itself, should be
+ obtained with PaUtil_AllocateMemory or PaUtil_AllocateTaggedMemory and
+ released with PaUtil_FreeMemory instead.
  @see PaUtil_FreeAllAllocations
 */
 void PaUtil_GroupFreeMemory( PaUtilAllocationGroup* group, void *buffer );
 
 /** Free all blocks of memory which have been allocated through the allocation
- group. This function doesn't destroy the group itself.
+ group. This function doesn't destroy the group itself. The most recently
+ allocated regular chunk is kept for reuse by subsequent allocations.
 */
 void PaUtil_FreeAllAllocations( PaUtilAllocationGroup* group );
 
+/** Prefault and lock all chunks currently owned by the group.
+ Returns the number of bytes locked.
+ @see PaUtil_LockMemory
+*/
+long PaUtil_LockAllocationGroup( PaUtilAllocationGroup* group );
+
+
+/** A pool of equally sized blocks, see PaUtil_CreateFixedPool.
+
+ A pool is not synchronized: a given pool must only be used by one thread
+ at a time, which is typically the audio thread once the stream is running.
+*/
+typedef struct
+{
+    char *storage;
+    long blockSize;         /**< the size of each block including alignment padding */
+    long capacity;
+    long availableCount;
+    void *freeList;         /**< singly linked through the first word of each free block */
+}PaUtilFixedPool;
+
+/** Create a pool of capacity blocks of blockSize bytes, aligned to alignment
+ bytes. alignment must be a power of two, or 0 for
+ PA_ALLOCATION_DEFAULT_ALIGNMENT. All storage is allocated here. Returns
+ NULL if memory couldn't be allocated.
+*/
+PaUtilFixedPool* PaUtil_CreateFixedPool( long blockSize, long capacity, long alignment );
+
+/** Destroy a pool created with PaUtil_CreateFixedPool, including the
+ storage of all its blocks. pool may be NULL.
+*/
+void PaUtil_DestroyFixedPool( PaUtilFixedPool* pool );
+
+/** Take a block from the pool in constant time. Returns NULL if all blocks
+ are in use. Safe to call from a real-time thread.
+*/
+void* PaUtil_FixedPoolAllocate( PaUtilFixedPool* pool );
+
+/** Return a block obtained from PaUtil_FixedPoolAllocate to the pool in
+ constant time. block may be NULL. Safe to call from a real-time thread.
+*/
+void PaUtil_FixedPoolFree( PaUtilFixedPool* pool, void *block );
+
+/** Return the number of blocks which can currently be allocated from the pool. */
+long PaUtil_GetFixedPoolAvailable( const PaUtilFixedPool* pool );
+
+/** Prefault and lock the pool's storage. Returns the number of bytes locked.
+ @see PaUtil_LockMemory
+*/
+long PaUtil_LockFixedPool( PaUtilFixedPool* pool );
+
 
 #ifdef __cplusplus
 }
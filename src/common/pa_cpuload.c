@@ -41,20 +41,83 @@
  @ingroup common_src
 
  @brief Functions to assist in measuring the CPU utilization of a callback
- stream. Used to implement the Pa_GetStreamCpuLoad() function.
-
- @todo Dynamically calculate the coefficients used to smooth the CPU Load
- Measurements over time to provide a uniform characterisation of CPU Load
- independent of rate at which PaUtil_BeginCpuLoadMeasurement /
- PaUtil_EndCpuLoadMeasurement are called. see http://www.portaudio.com/trac/ticket/113
+ stream. Used to implement the Pa_GetStreamCpuLoad() and
+ Pa_GetStreamStatistics() functions.
+
+ The smoothing filter's coefficient is calculated from the duration of each
+ measured buffer, which gives a uniform characterisation of CPU Load
+ independent of the rate at which PaUtil_BeginCpuLoadMeasurement /
+ PaUtil_EndCpuLoadMeasurement are called (see
+ http://www.portaudio.com/trac/ticket/113).
 */
 
 
 #include "pa_cpuload.h"
 
 #include <assert.h>
+#include <math.h>
+#include <string.h> /* for memset() */
 
 #include "pa_util.h"   /* for PaUtil_GetTime() */
+#include "pa_memorybarrier.h"
+
+
+/* Lower bounds of the four quarter octave buckets within an octave, as fractions of the octave's lower bound */
+static const double quarterOctaves_[4] = { 1., 1.189207115, 1.414213562, 1.681792831 };
+
+#define PA_CPU_LOAD_HISTOGRAM_MIN_EXPONENT_  (-12)
+
+
+static int GetHistogramBucket( double load )
+{
+    int exponent, bucket, i;
+    double mantissa;
+
+    if( load <= 0. )
+        return 0;
+
+    /* load = mantissa * 2^exponent with mantissa in [0.5, 1) */
+    mantissa = frexp( load, &exponent ) * 2.;
+    exponent -= 1;
+
+    for( i = 3; i > 0 && mantissa < quarterOctaves_[i]; --i )
+        ;
+
+    bucket = (exponent - PA_CPU_LOAD_HISTOGRAM_MIN_EXPONENT_) * 4 + i;
+    if( bucket < 0 )
+        return 0;
+    if( bucket >= PA_CPU_LOAD_HISTOGRAM_SIZE )
+        return PA_CPU_LOAD_HISTOGRAM_SIZE - 1;
+    return bucket;
+}
+
+
+static double GetHistogramBucketUpperBound( int bucket )
+{
+    int octave = bucket / 4, quarter = bucket % 4;
+
+    return ldexp( quarter == 3 ? 2. : quarterOctaves_[quarter + 1], octave + PA_CPU_LOAD_HISTOGRAM_MIN_EXPONENT_ );
+}
+
+
+static double GetPercentile( const unsigned long *histogram, unsigned long count, double fraction )
+{
+    unsigned long threshold, cumulative = 0;
+    int i;
+
+    if( count == 0 )
+        return 0.;
+
+    threshold = (unsigned long)ceil( fraction * count );
+    for( i = 0; i < PA_CPU_LOAD_HISTOGRAM_SIZE; ++i )
+    {
+        cumulative += histogram[i];
+        if( cumulative >= threshold )
+            break;
+    }
+
+    return GetHistogramBucketUpperBound( i < PA_CPU_LOAD_HISTOGRAM_SIZE ? i : PA_CPU_LOAD_HISTOGRAM_SIZE - 1 );
+}
 
 
 void PaUtil_InitializeCpuLoadMeasurer( PaUtilCpuLoadMeasurer* measurer, double sampleRate )
@@ -62,12 +125,17 @@ void PaUtil_InitializeCpuLoadMeasurer( PaUtilCpuLoadMeasurer* measurer, double s
     assert( sampleRate > 0 );
 
     measurer->samplingPeriod = 1. / sampleRate;
-    measurer->averageLoad = 0.;
+    measurer->timeConstant = PA_CPU_LOAD_DEFAULT_TIME_CONSTANT;
+    measurer->sequence = 0;
+    PaUtil_ResetCpuLoadMeasurer( measurer );
 }
 
 void PaUtil_ResetCpuLoadMeasurer( PaUtilCpuLoadMeasurer* measurer )
 {
     measurer->averageLoad = 0.;
+    measurer->peakLoad = 0.;
+    measurer->measurementCount = 0;
+    memset( measurer->histogram, 0, sizeof (measurer->histogram) );
 }
 
 void PaUtil_BeginCpuLoadMeasurement( PaUtilCpuLoadMeasurer* measurer )
@@ -78,7 +146,7 @@ void PaUtil_BeginCpuLoadMeasurement( PaUtilCpuLoadMeasurer* measurer )
 
 void PaUtil_EndCpuLoadMeasurement( PaUtilCpuLoadMeasurer* measurer, unsigned long framesProcessed )
 {
-    double measurementEndTime, secondsFor100Percent, measuredLoad;
+    double measurementEndTime, secondsFor100Percent, measuredLoad, coefficient;
 
     if( framesProcessed > 0 ){
         measurementEndTime = PaUtil_GetTime();
@@ -88,13 +156,22 @@ void PaUtil_EndCpuLoadMeasurement( PaUtilCpuLoadMeasurer* measurer, unsigned lon
 
         measuredLoad = (measurementEndTime - measurer->measurementStartTime) / secondsFor100Percent;
 
-        /* Low pass filter the calculated CPU load to reduce jitter using a simple IIR low pass filter. */
-        /** FIXME @todo these coefficients shouldn't be hardwired see: http://www.portaudio.com/trac/ticket/113 */
-#define LOWPASS_COEFFICIENT_0   (0.9)
-#define LOWPASS_COEFFICIENT_1   (0.99999 - LOWPASS_COEFFICIENT_0)
+        /* Low pass filter the calculated CPU load to reduce jitter using a one pole IIR filter. The coefficient
+           depends on the duration of the measured buffer, so that the time constant doesn't vary with the
+           buffer size. */
+        coefficient = measurer->timeConstant > 0. ? exp( -secondsFor100Percent / measurer->timeConstant ) : 0.;
+        measurer->averageLoad = (coefficient * measurer->averageLoad) + ((1. - coefficient) * measuredLoad);
+
+        ++measurer->sequence;
+        PaUtil_WriteMemoryBarrier();
 
-        measurer->averageLoad = (LOWPASS_COEFFICIENT_0 * measurer->averageLoad) +
-                               (LOWPASS_COEFFICIENT_1 * measuredLoad);
+        if( measuredLoad > measurer->peakLoad )
+            measurer->peakLoad = measuredLoad;
+        ++measurer->histogram[GetHistogramBucket( measuredLoad )];
+        ++measurer->measurementCount;
+
+        PaUtil_WriteMemoryBarrier();
+        ++measurer->sequence;
     }
 }
 
@@ -103,3 +180,34 @@ double PaUtil_GetCpuLoad( PaUtilCpuLoadMeasurer* measurer )
 {
     return measurer->averageLoad;
 }
+
+
+void PaUtil_SetCpuLoadTimeConstant( PaUtilCpuLoadMeasurer* measurer, double timeConstant )
+{
+    measurer->timeConstant = timeConstant > 0. ? timeConstant : 0.;
+}
+
+
+void PaUtil_GetCpuLoadStatistics( PaUtilCpuLoadMeasurer* measurer, PaUtilCpuLoadStatistics* statistics )
+{
+    unsigned long histogram[PA_CPU_LOAD_HISTOGRAM_SIZE];
+    unsigned long sequence;
+
+    /* Retry until no update overlapped copying */
+    do
+    {
+        while( (sequence = measurer->sequence) & 1 )
+            ;
+        PaUtil_ReadMemoryBarrier();
+        statistics->peakLoad = measurer->peakLoad;
+        statistics->measurementCount = measurer->measurementCount;
+        memcpy( histogram, measurer->histogram, sizeof (histogram) );
+        PaUtil_ReadMemoryBarrier();
+    }
+    while( sequence != measurer->sequence );
+
+    statistics->averageLoad = measurer->averageLoad;
+    statistics->medianLoad = GetPercentile( histogram, statistics->measurementCount, 0.5 );
+    statistics->p99Load = GetPercentile( histogram, statistics->measurementCount, 0.99 );
+    statistics->p999Load = GetPercentile( histogram, statistics->measurementCount, 0.999 );
+}
@@ -43,7 +43,8 @@
  @ingroup common_src
 
  @brief Functions to assist in measuring the CPU utilization of a callback
- stream. Used to implement the Pa_GetStreamCpuLoad() function.
+ stream. Used to implement the Pa_GetStreamCpuLoad() and
+ Pa_GetStreamStatistics() functions.
 */
 
 
@@ -53,18 +54,66 @@ extern "C"
 #endif /* __cplusplus */
 
 
-typedef struct {
+/** The number of buckets of the per-measurement load histogram. Buckets are
+ a quarter octave wide and cover loads from 2^-12 to 2^4, loads outside this
+ range are counted in the first or last bucket.
+*/
+#define PA_CPU_LOAD_HISTOGRAM_SIZE  64
+
+/** The default time constant of the filter that smooths the load returned
+ by PaUtil_GetCpuLoad, in seconds.
+*/
+#define PA_CPU_LOAD_DEFAULT_TIME_CONSTANT   (0.05)
+
+
+typedef struct PaUtilCpuLoadMeasurer {
     double samplingPeriod;
     double measurementStartTime;
     double averageLoad;
+    volatile double timeConstant;   /**< of the averageLoad filter, in seconds */
+
+    /* Statistics, only written by the measuring thread. sequence is odd while
+       they are being updated, so that PaUtil_GetCpuLoadStatistics can read
+       them from another thread without locking. */
+    volatile unsigned long sequence;
+    double peakLoad;
+    unsigned long measurementCount;
+    unsigned long histogram[PA_CPU_LOAD_HISTOGRAM_SIZE];
 } PaUtilCpuLoadMeasurer; /**< @todo need better name than measurer */
 
+
+/** A consistent snapshot of the statistics of a PaUtilCpuLoadMeasurer. The
+ percentiles are the upper bounds of the histogram buckets they fall in.
+*/
+typedef struct {
+    double averageLoad;
+    double peakLoad;
+    double medianLoad;
+    double p99Load;
+    double p999Load;
+    unsigned long measurementCount;
+} PaUtilCpuLoadStatistics;
+
 void PaUtil_InitializeCpuLoadMeasurer( PaUtilCpuLoadMeasurer* measurer, double sampleRate );
 void PaUtil_BeginCpuLoadMeasurement( PaUtilCpuLoadMeasurer* measurer );
 void PaUtil_EndCpuLoadMeasurement( PaUtilCpuLoadMeasurer* measurer, unsigned long framesProcessed );
+
+/** Reset the average load and the statistics. Must not be called while
+ measurements are being made, i.e. only while the stream is stopped.
+*/
 void PaUtil_ResetCpuLoadMeasurer( PaUtilCpuLoadMeasurer* measurer );
 double PaUtil_GetCpuLoad( PaUtilCpuLoadMeasurer* measurer );
 
+/** Set the time constant of the filter smoothing the value returned by
+ PaUtil_GetCpuLoad. May be called from any thread.
+*/
+void PaUtil_SetCpuLoadTimeConstant( PaUtilCpuLoadMeasurer* measurer, double timeConstant );
+
+/** Retrieve the statistics of measurer. May be called from any thread while
+ measurements are being made.
+*/
+void PaUtil_GetCpuLoadStatistics( PaUtilCpuLoadMeasurer* measurer, PaUtilCpuLoadStatistics* statistics );
+
 
 #ifdef __cplusplus
 }
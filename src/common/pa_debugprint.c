@@ -48,17 +48,26 @@
 	"byte code/abi portable". So the technique used here is to allocate a local
 	a static array, write in it, then callback the user with a pointer to its
 	start.
+
+	In asynchronous mode messages are formatted into the slots of a bounded
+	multi-producer queue and written out by a background thread, see
+	PaUtil_EnableAsyncDebugPrint.
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 
 #include "pa_debugprint.h"
+#include "pa_util.h"
+#include "pa_memorybarrier.h"
 
-// for OutputDebugStringA
-#if defined(_MSC_VER) && defined(PA_ENABLE_MSVC_DEBUG_OUTPUT)
+// for OutputDebugStringA and the asynchronous output thread
+#if defined(_WIN32)
 	#define WIN32_LEAN_AND_MEAN // exclude rare headers
 	#include "windows.h"
+#else
+	#include <pthread.h>
 #endif
 
 // User callback
@@ -85,6 +94,250 @@ void PaUtil_SetDebugPrintFunction(PaUtilLogCallback cb)
 
 #define PA_LOG_BUF_SIZE 2048
 
+// How often the output thread looks for queued messages
+#define PA_LOG_DRAIN_INTERVAL_MSEC 10
+
+
+/*
+ Asynchronous output. A slot's sequence says whose turn it is: the slot at
+ queue position pos may be claimed by a producer while sequence == pos, and
+ read by the output thread once the producer has set sequence = pos + 1. The
+ output thread then sets it to pos + PA_DEBUG_PRINT_ASYNC_QUEUE_SIZE, handing
+ the slot to the producer one lap later.
+*/
+typedef struct PaUtilLogSlot
+{
+	volatile long sequence;
+	char text[PA_DEBUG_PRINT_ASYNC_MESSAGE_SIZE];
+} PaUtilLogSlot;
+
+static PaUtilLogSlot *logQueue_ = NULL; // never freed once allocated, see PaUtil_EnableAsyncDebugPrint
+static volatile long logEnqueuePosition_ = 0;
+static long logDequeuePosition_ = 0;
+static volatile long logDroppedCount_ = 0;
+static unsigned long logReportedDropCount_ = 0;
+static volatile int logAsync_ = 0;
+static volatile int logThreadRunning_ = 0;
+static int logAsyncEnabledByEnvironment_ = 0;
+
+#if defined(_WIN32)
+static HANDLE logThread_;
+#else
+static pthread_t logThread_;
+#endif
+
+
+static void WriteLogMessage( const char *text )
+{
+	if (userCB != NULL)
+	{
+		userCB(text);
+	}
+	else
+	{
+		fputs(text, stderr);
+		fflush(stderr);
+	}
+}
+
+
+// Claim a queue slot. Returns NULL and counts a drop if the queue is full
+static PaUtilLogSlot *ClaimLogSlot( long *position )
+{
+	long difference, dropped;
+	PaUtilLogSlot *slot;
+
+	for(;;)
+	{
+		*position = logEnqueuePosition_;
+		slot = &logQueue_[ *position & (PA_DEBUG_PRINT_ASYNC_QUEUE_SIZE - 1) ];
+		difference = (long)((unsigned long)slot->sequence - (unsigned long)*position);
+
+		if( difference == 0 )
+		{
+			if( PaUtil_AtomicCompareAndSwap( &logEnqueuePosition_, *position, *position + 1 ) )
+				return slot;
+		}
+		else if( difference < 0 )
+		{
+			break; // the output thread hasn't read the slot's previous message
+		}
+		// otherwise another producer claimed the slot first, try again
+	}
+
+	do
+	{
+		dropped = logDroppedCount_;
+	}
+	while( !PaUtil_AtomicCompareAndSwap( &logDroppedCount_, dropped, dropped + 1 ) );
+
+	return NULL;
+}
+
+
+static void DrainLogQueue( void )
+{
+	unsigned long dropped;
+
+	for(;;)
+	{
+		PaUtilLogSlot *slot = &logQueue_[ logDequeuePosition_ & (PA_DEBUG_PRINT_ASYNC_QUEUE_SIZE - 1) ];
+
+		if( slot->sequence != logDequeuePosition_ + 1 )
+			break;
+		PaUtil_ReadMemoryBarrier();
+
+		WriteLogMessage( slot->text );
+
+		PaUtil_FullMemoryBarrier(); // finish reading the text before the slot is reused
+		slot->sequence = logDequeuePosition_ + PA_DEBUG_PRINT_ASYNC_QUEUE_SIZE;
+		++logDequeuePosition_;
+	}
+
+	dropped = (unsigned long)logDroppedCount_;
+	if( dropped != logReportedDropCount_ )
+	{
+		char text[64];
+		sprintf( text, "PaUtil_DebugPrint: %lu messages dropped\n", dropped - logReportedDropCount_ );
+		WriteLogMessage( text );
+		logReportedDropCount_ = dropped;
+	}
+}
+
+
+#if defined(_WIN32)
+static DWORD WINAPI LogThreadFunc( LPVOID parameter )
+#else
+static void *LogThreadFunc( void *parameter )
+#endif
+{
+	(void)parameter;
+
+	while( logThreadRunning_ )
+	{
+		DrainLogQueue();
+		Pa_Sleep( PA_LOG_DRAIN_INTERVAL_MSEC );
+	}
+	DrainLogQueue();
+
+	return 0;
+}
+
+
+static int StartLogThread( void )
+{
+	logThreadRunning_ = 1;
+
+#if defined(_WIN32)
+	logThread_ = CreateThread( NULL, 0, LogThreadFunc, NULL, 0, NULL );
+	if( logThread_ == NULL )
+	{
+		logThreadRunning_ = 0;
+		return -1;
+	}
+	SetThreadPriority( logThread_, THREAD_PRIORITY_BELOW_NORMAL );
+#else
+	{
+		// Don't inherit a realtime policy from the calling thread
+		pthread_attr_t attr;
+		struct sched_param param;
+		int error;
+
+		pthread_attr_init( &attr );
+		pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED );
+		pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
+		param.sched_priority = 0;
+		pthread_attr_setschedparam( &attr, &param );
+
+		error = pthread_create( &logThread_, &attr, LogThreadFunc, NULL );
+		pthread_attr_destroy( &attr );
+		if( error != 0 )
+		{
+			logThreadRunning_ = 0;
+			return -1;
+		}
+	}
+#endif
+
+	return 0;
+}
+
+
+static void StopLogThread( void )
+{
+	logThreadRunning_ = 0;
+
+#if defined(_WIN32)
+	WaitForSingleObject( logThread_, INFINITE );
+	CloseHandle( logThread_ );
+#else
+	pthread_join( logThread_, NULL );
+#endif
+}
+
+
+int PaUtil_EnableAsyncDebugPrint( int enable )
+{
+	long i;
+
+	if( !enable )
+	{
+		if( logAsync_ )
+		{
+			logAsync_ = 0;
+			StopLogThread();
+		}
+		return 0;
+	}
+
+	if( logAsync_ )
+		return 0;
+
+	// A thread may still be writing into the queue after asynchronous mode
+	// is disabled, so it is kept; the message is written on re-enabling
+	if( logQueue_ == NULL )
+	{
+		logQueue_ = (PaUtilLogSlot*)malloc( sizeof(PaUtilLogSlot) * PA_DEBUG_PRINT_ASYNC_QUEUE_SIZE );
+		if( logQueue_ == NULL )
+			return -1;
+		for( i = 0; i < PA_DEBUG_PRINT_ASYNC_QUEUE_SIZE; ++i )
+			logQueue_[i].sequence = i;
+	}
+
+	if( StartLogThread() != 0 )
+		return -1;
+
+	PaUtil_WriteMemoryBarrier();
+	logAsync_ = 1;
+	return 0;
+}
+
+
+unsigned long PaUtil_GetDroppedDebugPrintCount( void )
+{
+	return (unsigned long)logDroppedCount_;
+}
+
+
+void PaUtil_InitializeDebugPrint( void )
+{
+	const char *async = getenv( "PA_DEBUG_ASYNC" );
+
+	if( async != NULL && atoi( async ) != 0 && !logAsync_ )
+		logAsyncEnabledByEnvironment_ = ( PaUtil_EnableAsyncDebugPrint( 1 ) == 0 );
+}
+
+
+void PaUtil_TerminateDebugPrint( void )
+{
+	if( logAsyncEnabledByEnvironment_ )
+	{
+		PaUtil_EnableAsyncDebugPrint( 0 );
+		logAsyncEnabledByEnvironment_ = 0;
+	}
+}
+
+
 void PaUtil_DebugPrint( const char *format, ... )
 {
 	// Optional logging into Output console of Visual Studio
@@ -100,6 +353,25 @@ void PaUtil_DebugPrint( const char *format, ... )
 	}
 #endif
 
+	// Queue for the output thread
+	if (logAsync_)
+	{
+		long position;
+		PaUtilLogSlot *slot = ClaimLogSlot(&position);
+		if (slot != NULL)
+		{
+			va_list ap;
+			va_start(ap, format);
+			VSNPRINTF(slot->text, sizeof(slot->text), format, ap);
+			slot->text[sizeof(slot->text)-1] = 0;
+			va_end(ap);
+
+			PaUtil_WriteMemoryBarrier();
+			slot->sequence = position + 1;
+		}
+		return;
+	}
+
 	// Output to User-Callback
     if (userCB != NULL)
     {
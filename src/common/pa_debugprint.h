@@ -142,6 +142,50 @@ typedef void (*PaUtilLogCallback ) (const char *log);
 void PaUtil_SetDebugPrintFunction(PaUtilLogCallback  cb);
 
 
+#define PA_DEBUG_PRINT_ASYNC_MESSAGE_SIZE   (256)   /**< longest queued message, including the terminator */
+#define PA_DEBUG_PRINT_ASYNC_QUEUE_SIZE     (256)   /**< number of queued messages, a power of two */
+
+/**
+    Switch PaUtil_DebugPrint() between writing each message before returning
+    (the default) and queueing it for a low priority background thread, which
+    writes it to stderr or passes it to the function installed with
+    PaUtil_SetDebugPrintFunction().
+
+    In asynchronous mode PaUtil_DebugPrint() doesn't block or take locks, so
+    it may be used from audio threads. Messages are still formatted by the
+    caller and are truncated to PA_DEBUG_PRINT_ASYNC_MESSAGE_SIZE - 1
+    characters. When the queue is full messages are dropped and the
+    background thread reports how many.
+
+    Disabling asynchronous mode waits for queued messages to be written.
+
+    Pa_Initialize() enables asynchronous mode if the PA_DEBUG_ASYNC
+    environment variable is set to a non-zero number, and Pa_Terminate()
+    disables it again.
+
+    @return 0 on success, non-zero if the background thread could not be
+    started, in which case messages continue to be written synchronously.
+*/
+int PaUtil_EnableAsyncDebugPrint( int enable );
+
+/**
+    Return the number of messages dropped because the asynchronous queue
+    was full.
+*/
+unsigned long PaUtil_GetDroppedDebugPrintCount( void );
+
+/**
+    Enable asynchronous mode if PA_DEBUG_ASYNC is set. Called by
+    Pa_Initialize().
+*/
+void PaUtil_InitializeDebugPrint( void );
+
+/**
+    Undo PaUtil_InitializeDebugPrint(). Called by Pa_Terminate().
+*/
+void PaUtil_TerminateDebugPrint( void );
+
+
 
 #ifdef __cplusplus
 }
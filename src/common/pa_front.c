@@ -73,7 +73,9 @@
 #include "pa_types.h"
 #include "pa_hostapi.h"
 #include "pa_stream.h"
-#include "pa_trace.h" /* still usefull?*/
+#include "pa_cpuload.h"
+#include "pa_process.h"
+#include "pa_trace.h"
 #include "pa_debugprint.h"
 
 
@@ -165,8 +167,8 @@ static PaError InitializeHostApis( void )
 
     initializerCount = CountHostApiInitializers();
 
-    hostApis_ = (PaUtilHostApiRepresentation**)PaUtil_AllocateMemory(
-            sizeof(PaUtilHostApiRepresentation*) * initializerCount );
+    hostApis_ = (PaUtilHostApiRepresentation**)PaUtil_AllocateTaggedMemory(
+            sizeof(PaUtilHostApiRepresentation*) * initializerCount, paMemoryDeviceInfo );
     if( !hostApis_ )
     {
         result = paInsufficientMemory;
@@ -330,7 +332,10 @@ PaError Pa_Initialize( void )
         PA_VALIDATE_ENDIANNESS;
         
         PaUtil_InitializeClock();
+        PaUtil_InitializeMemoryLocking();
         PaUtil_ResetTraceMessages();
+        PaUtil_InitializeStreamTrace();
+        PaUtil_InitializeDebugPrint();
 
         result = InitializeHostApis();
         if( result == paNoError )
@@ -358,6 +363,8 @@ PaError Pa_Terminate( void )
             TerminateHostApis();
 
             PaUtil_DumpTraceMessages();
+            PaUtil_TerminateStreamTrace();
+            PaUtil_TerminateDebugPrint();
         }
         result = paNoError;
     }
@@ -415,6 +422,7 @@ const char *Pa_GetErrorText( PaError errorCode )
     case paCanNotWriteToAnInputOnlyStream:      result = "Can't write to an input only stream"; break;
     case paIncompatibleStreamHostApi: result = "Incompatible stream host API"; break;
     case paBadBufferPtr:             result = "Bad buffer pointer"; break;
+    case paInvalidArgument:          result = "Invalid argument"; break;
     default:                         
 		if( errorCode > 0 )
 			result = "Invalid error code (value greater than zero)"; 
@@ -509,6 +517,33 @@ PaError PaUtil_DeviceIndexToHostApiDeviceIndex(
 }
 
 
+void PaUtil_HostApiDeviceCountChanged( void )
+{
+    int i, baseDeviceIndex = 0, offset;
+
+    if( !PA_IS_INITIALISED_ )
+        return;
+
+    for( i=0; i < hostApisCount_; ++i )
+    {
+        PaUtilHostApiRepresentation* hostApi = hostApis_[i];
+        offset = baseDeviceIndex - hostApi->privatePaFrontInfo.baseDeviceIndex;
+
+        hostApi->privatePaFrontInfo.baseDeviceIndex = baseDeviceIndex;
+
+        if( hostApi->info.defaultInputDevice != paNoDevice )
+            hostApi->info.defaultInputDevice += offset;
+
+        if( hostApi->info.defaultOutputDevice != paNoDevice )
+            hostApi->info.defaultOutputDevice += offset;
+
+        baseDeviceIndex += hostApi->info.deviceCount;
+    }
+
+    deviceCount_ = baseDeviceIndex;
+}
+
+
 PaHostApiIndex Pa_GetHostApiCount( void )
 {
     int result;
@@ -968,7 +1003,7 @@ static PaError ValidateOpenStreamParameters(
     if( (sampleRate < 1000.0) || (sampleRate > 200000.0) )
         return paInvalidSampleRate;
 
-    if( ((streamFlags & ~paPlatformSpecificFlags) & ~(paClipOff | paDitherOff | paNeverDropInput | paPrimeOutputBuffersUsingStreamCallback ) ) != 0 )
+    if( ((streamFlags & ~paPlatformSpecificFlags) & ~(paClipOff | paDitherOff | paNeverDropInput | paPrimeOutputBuffersUsingStreamCallback | paLockStreamMemory ) ) != 0 )
         return paInvalidFlag;
 
     if( streamFlags & paNeverDropInput )
@@ -1593,6 +1628,88 @@ double Pa_GetStreamCpuLoad( PaStream* stream )
 }
 
 
+PaError Pa_GetStreamStatistics( PaStream* stream, PaStreamStatistics* statistics )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+    PaUtilCpuLoadMeasurer *cpuLoadMeasurer;
+    PaUtilBufferProcessor *bufferProcessor;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetStreamStatistics" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tPaStreamStatistics* statistics: 0x%p\n", statistics ));
+
+    if( result == paNoError )
+    {
+        memset( statistics, 0, sizeof (PaStreamStatistics) );
+        statistics->structVersion = 2;
+
+        cpuLoadMeasurer = PA_STREAM_REP( stream )->cpuLoadMeasurer;
+        if( cpuLoadMeasurer )
+        {
+            PaUtilCpuLoadStatistics cpuLoadStatistics;
+
+            PaUtil_GetCpuLoadStatistics( cpuLoadMeasurer, &cpuLoadStatistics );
+            statistics->cpuLoad = cpuLoadStatistics.averageLoad;
+            statistics->peakCpuLoad = cpuLoadStatistics.peakLoad;
+            statistics->medianCpuLoad = cpuLoadStatistics.medianLoad;
+            statistics->p99CpuLoad = cpuLoadStatistics.p99Load;
+            statistics->p999CpuLoad = cpuLoadStatistics.p999Load;
+            statistics->cpuLoadMeasurementCount = cpuLoadStatistics.measurementCount;
+        }
+
+        bufferProcessor = PA_STREAM_REP( stream )->bufferProcessor;
+        if( bufferProcessor && bufferProcessor->streamCallback )
+        {
+            PaUtilBufferProcessorStatistics bufferProcessorStatistics;
+            int i;
+
+            PaUtil_GetBufferProcessorStatistics( bufferProcessor, &bufferProcessorStatistics );
+            statistics->callbackCount = bufferProcessorStatistics.callbackCount;
+            statistics->minCallbackDuration = bufferProcessorStatistics.minCallbackDuration;
+            statistics->maxCallbackDuration = bufferProcessorStatistics.maxCallbackDuration;
+            if( bufferProcessorStatistics.callbackCount > 0 )
+                statistics->meanCallbackDuration =
+                        bufferProcessorStatistics.totalCallbackDuration / bufferProcessorStatistics.callbackCount;
+            statistics->overBudgetCallbackCount = bufferProcessorStatistics.overBudgetCallbackCount;
+
+            statistics->wakeupCount = bufferProcessorStatistics.wakeupCount;
+            if( bufferProcessorStatistics.wakeupCount > 0 )
+                statistics->meanWakeupJitter =
+                        bufferProcessorStatistics.totalWakeupJitter / bufferProcessorStatistics.wakeupCount;
+            statistics->maxWakeupJitter = bufferProcessorStatistics.maxWakeupJitter;
+            for( i = 0; i < paWakeupJitterBinCount; ++i )
+                statistics->wakeupJitterHistogram[i] = bufferProcessorStatistics.wakeupJitterHistogram[i];
+
+            statistics->inputUnderflowCount = bufferProcessorStatistics.inputUnderflowCount;
+            statistics->inputOverflowCount = bufferProcessorStatistics.inputOverflowCount;
+            statistics->outputUnderflowCount = bufferProcessorStatistics.outputUnderflowCount;
+            statistics->outputOverflowCount = bufferProcessorStatistics.outputOverflowCount;
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_GetStreamStatistics", result );
+
+    return result;
+}
+
+
+PaError Pa_SetStreamCpuLoadTimeConstant( PaStream* stream, PaTime timeConstant )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_SetStreamCpuLoadTimeConstant" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tPaTime timeConstant: %g\n", timeConstant ));
+
+    if( result == paNoError && PA_STREAM_REP( stream )->cpuLoadMeasurer )
+        PaUtil_SetCpuLoadTimeConstant( PA_STREAM_REP( stream )->cpuLoadMeasurer, timeConstant );
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_SetStreamCpuLoadTimeConstant", result );
+
+    return result;
+}
+
+
 PaError Pa_ReadStream( PaStream* stream,
                        void *buffer,
                        unsigned long frames )
@@ -1768,3 +1885,22 @@ PaError Pa_GetSampleSize( PaSampleFormat format )
     return (PaError) result;
 }
 
+
+PaError Pa_GetMemoryUsage( PaMemoryCategory category, PaMemoryUsage *usage )
+{
+    PaError result = paNoError;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetMemoryUsage" );
+    PA_LOGAPI(("\tPaMemoryCategory category: %d\n", category ));
+    PA_LOGAPI(("\tPaMemoryUsage* usage: 0x%p\n", usage ));
+
+    if( (int)category < paMemoryGeneral || category > paMemoryTotal )
+        result = paInvalidArgument;
+    else
+        PaUtil_GetMemoryUsage( category, usage );
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_GetMemoryUsage", result );
+
+    return result;
+}
+
@@ -49,6 +49,8 @@
 
 #include "pa_process.h"
 #include "pa_util.h"
+#include "pa_trace.h"
+#include "pa_memorybarrier.h"
 
 
 #define PA_FRAMES_PER_TEMP_BUFFER_WHEN_HOST_BUFFER_SIZE_IS_UNKNOWN_    1024
@@ -249,7 +251,7 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         tempInputBufferSize =
             bp->framesPerTempBuffer * bp->bytesPerUserInputSample * inputChannelCount;
          
-        bp->tempInputBuffer = PaUtil_AllocateMemory( tempInputBufferSize );
+        bp->tempInputBuffer = PaUtil_AllocateTaggedMemory( tempInputBufferSize, paMemoryBufferProcessor );
         if( bp->tempInputBuffer == 0 )
         {
             result = paInsufficientMemory;
@@ -262,7 +264,7 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         if( userInputSampleFormat & paNonInterleaved )
         {
             bp->tempInputBufferPtrs =
-                (void **)PaUtil_AllocateMemory( sizeof(void*)*inputChannelCount );
+                (void **)PaUtil_AllocateTaggedMemory( sizeof(void*)*inputChannelCount, paMemoryBufferProcessor );
             if( bp->tempInputBufferPtrs == 0 )
             {
                 result = paInsufficientMemory;
@@ -271,7 +273,7 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         }
 
         bp->hostInputChannels[0] = (PaUtilChannelDescriptor*)
-                PaUtil_AllocateMemory( sizeof(PaUtilChannelDescriptor) * inputChannelCount * 2);
+                PaUtil_AllocateTaggedMemory( sizeof(PaUtilChannelDescriptor) * inputChannelCount * 2, paMemoryBufferProcessor );
         if( bp->hostInputChannels[0] == 0 )
         {
             result = paInsufficientMemory;
@@ -319,7 +321,7 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         tempOutputBufferSize =
                 bp->framesPerTempBuffer * bp->bytesPerUserOutputSample * outputChannelCount;
 
-        bp->tempOutputBuffer = PaUtil_AllocateMemory( tempOutputBufferSize );
+        bp->tempOutputBuffer = PaUtil_AllocateTaggedMemory( tempOutputBufferSize, paMemoryBufferProcessor );
         if( bp->tempOutputBuffer == 0 )
         {
             result = paInsufficientMemory;
@@ -332,7 +334,7 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         if( userOutputSampleFormat & paNonInterleaved )
         {
             bp->tempOutputBufferPtrs =
-                (void **)PaUtil_AllocateMemory( sizeof(void*)*outputChannelCount );
+                (void **)PaUtil_AllocateTaggedMemory( sizeof(void*)*outputChannelCount, paMemoryBufferProcessor );
             if( bp->tempOutputBufferPtrs == 0 )
             {
                 result = paInsufficientMemory;
@@ -341,7 +343,7 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         }
 
         bp->hostOutputChannels[0] = (PaUtilChannelDescriptor*)
-                PaUtil_AllocateMemory( sizeof(PaUtilChannelDescriptor)*outputChannelCount * 2 );
+                PaUtil_AllocateTaggedMemory( sizeof(PaUtilChannelDescriptor)*outputChannelCount * 2, paMemoryBufferProcessor );
         if( bp->hostOutputChannels[0] == 0 )
         {                                                                     
             result = paInsufficientMemory;
@@ -351,12 +353,38 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         bp->hostOutputChannels[1] = &bp->hostOutputChannels[0][outputChannelCount];
     }
 
+    bp->lockedMemorySize = 0;
+    if( streamFlags & paLockStreamMemory )
+    {
+        if( inputChannelCount > 0 )
+        {
+            bp->lockedMemorySize += PaUtil_LockMemory( bp->tempInputBuffer, tempInputBufferSize );
+            bp->lockedMemorySize += PaUtil_LockMemory( bp->tempInputBufferPtrs,
+                    (bp->tempInputBufferPtrs) ? sizeof(void*)*inputChannelCount : 0 );
+            bp->lockedMemorySize += PaUtil_LockMemory( bp->hostInputChannels[0],
+                    sizeof(PaUtilChannelDescriptor) * inputChannelCount * 2 );
+        }
+
+        if( outputChannelCount > 0 )
+        {
+            bp->lockedMemorySize += PaUtil_LockMemory( bp->tempOutputBuffer, tempOutputBufferSize );
+            bp->lockedMemorySize += PaUtil_LockMemory( bp->tempOutputBufferPtrs,
+                    (bp->tempOutputBufferPtrs) ? sizeof(void*)*outputChannelCount : 0 );
+            bp->lockedMemorySize += PaUtil_LockMemory( bp->hostOutputChannels[0],
+                    sizeof(PaUtilChannelDescriptor) * outputChannelCount * 2 );
+        }
+    }
+
     PaUtil_InitializeTriangularDitherState( &bp->ditherGenerator );
 
     bp->samplePeriod = 1. / sampleRate;
 
     bp->streamCallback = streamCallback;
     bp->userData = userData;
+    bp->trace = PaUtil_GetStreamTrace();
+
+    bp->statisticsSequence = 0;
+    PaUtil_ResetBufferProcessorStatistics( bp );
 
     return result;
 
@@ -407,10 +435,9 @@ void PaUtil_TerminateBufferProcessor( PaUtilBufferProcessor* bp )
 
 void PaUtil_ResetBufferProcessor( PaUtilBufferProcessor* bp )
 {
-    unsigned long tempInputBufferSize, tempOutputBufferSize;
+    unsigned long tempInputBufferSize;
 
     bp->framesInTempInputBuffer = bp->initialFramesInTempInputBuffer;
-    bp->framesInTempOutputBuffer = bp->initialFramesInTempOutputBuffer;
 
     if( bp->framesInTempInputBuffer > 0 )
     {
@@ -419,6 +446,16 @@ void PaUtil_ResetBufferProcessor( PaUtilBufferProcessor* bp )
         memset( bp->tempInputBuffer, 0, tempInputBufferSize );
     }
 
+    PaUtil_ResetBufferProcessorOutput( bp );
+}
+
+
+void PaUtil_ResetBufferProcessorOutput( PaUtilBufferProcessor* bp )
+{
+    unsigned long tempOutputBufferSize;
+
+    bp->framesInTempOutputBuffer = bp->initialFramesInTempOutputBuffer;
+
     if( bp->framesInTempOutputBuffer > 0 )
     {      
         tempOutputBufferSize =
@@ -428,6 +465,136 @@ void PaUtil_ResetBufferProcessor( PaUtilBufferProcessor* bp )
 }
 
 
+void PaUtil_GetBufferProcessorStatistics( PaUtilBufferProcessor* bp,
+        PaUtilBufferProcessorStatistics *statistics )
+{
+    unsigned long sequence;
+
+    /* Retry until no update overlapped copying */
+    do
+    {
+        while( (sequence = bp->statisticsSequence) & 1 )
+            ;
+        PaUtil_ReadMemoryBarrier();
+        *statistics = bp->statistics;
+        PaUtil_ReadMemoryBarrier();
+    }
+    while( sequence != bp->statisticsSequence );
+}
+
+
+/* Bracket changes to bp->statistics so that readers can detect them */
+static void BeginStatisticsUpdate( PaUtilBufferProcessor *bp )
+{
+    ++bp->statisticsSequence;
+    PaUtil_WriteMemoryBarrier();
+}
+
+static void EndStatisticsUpdate( PaUtilBufferProcessor *bp )
+{
+    PaUtil_WriteMemoryBarrier();
+    ++bp->statisticsSequence;
+}
+
+
+void PaUtil_ResetBufferProcessorStatistics( PaUtilBufferProcessor* bp )
+{
+    BeginStatisticsUpdate( bp );
+    memset( &bp->statistics, 0, sizeof (bp->statistics) );
+    EndStatisticsUpdate( bp );
+
+    bp->lastWakeupTime = 0.;
+    bp->expectedWakeupInterval = 0.;
+}
+
+
+/*
+    RecordWakeup() is called when the host starts a buffer. Buffers which
+    start less than half the expected interval after the last wakeup are
+    taken to be delivered by the same wakeup, otherwise the difference between
+    the actual and expected interval is recorded as the wakeup jitter.
+*/
+static void RecordWakeup( PaUtilBufferProcessor *bp, PaStreamCallbackFlags callbackStatusFlags )
+{
+    PaTime now = PaUtil_GetTime();
+    PaTime interval = now - bp->lastWakeupTime;
+    int newWakeup = bp->lastWakeupTime == 0. || interval >= bp->expectedWakeupInterval * .5;
+
+    BeginStatisticsUpdate( bp );
+
+    if( newWakeup && bp->lastWakeupTime != 0. && bp->expectedWakeupInterval > 0. )
+    {
+        PaTime jitter = interval - bp->expectedWakeupInterval;
+        double threshold = 1. / 16.;
+        int bin = 0;
+
+        if( jitter < 0. )
+            jitter = -jitter;
+
+        while( bin < paWakeupJitterBinCount - 1 && jitter >= bp->expectedWakeupInterval * threshold )
+        {
+            ++bin;
+            threshold *= 2.;
+        }
+
+        ++bp->statistics.wakeupCount;
+        bp->statistics.totalWakeupJitter += jitter;
+        if( jitter > bp->statistics.maxWakeupJitter )
+            bp->statistics.maxWakeupJitter = jitter;
+        ++bp->statistics.wakeupJitterHistogram[bin];
+    }
+
+    if( callbackStatusFlags & paInputUnderflow )
+        ++bp->statistics.inputUnderflowCount;
+    if( callbackStatusFlags & paInputOverflow )
+        ++bp->statistics.inputOverflowCount;
+    if( callbackStatusFlags & paOutputUnderflow )
+        ++bp->statistics.outputUnderflowCount;
+    if( callbackStatusFlags & paOutputOverflow )
+        ++bp->statistics.outputOverflowCount;
+
+    EndStatisticsUpdate( bp );
+
+    if( newWakeup )
+    {
+        bp->lastWakeupTime = now;
+        bp->expectedWakeupInterval = 0.;
+    }
+
+    if( callbackStatusFlags )
+        PaUtil_TraceEvent( bp->trace, "callback status flags %#lx", (long)callbackStatusFlags, 0, 0, 0 );
+}
+
+
+/* Call immediately before and after calling bp->streamCallback */
+static void BeginCallbackMeasurement( PaUtilBufferProcessor *bp )
+{
+    PaUtil_TraceBegin( bp->trace, "stream callback" );
+    bp->callbackStartTime = PaUtil_GetTime();
+}
+
+static void EndCallbackMeasurement( PaUtilBufferProcessor *bp, unsigned long frameCount )
+{
+    PaTime duration = PaUtil_GetTime() - bp->callbackStartTime;
+
+    PaUtil_TraceEnd( bp->trace, "stream callback" );
+
+    BeginStatisticsUpdate( bp );
+
+    if( bp->statistics.callbackCount == 0 || duration < bp->statistics.minCallbackDuration )
+        bp->statistics.minCallbackDuration = duration;
+    if( duration > bp->statistics.maxCallbackDuration )
+        bp->statistics.maxCallbackDuration = duration;
+    bp->statistics.totalCallbackDuration += duration;
+    ++bp->statistics.callbackCount;
+
+    if( duration > frameCount * bp->samplePeriod )
+        ++bp->statistics.overBudgetCallbackCount;
+
+    EndStatisticsUpdate( bp );
+}
+
+
 unsigned long PaUtil_GetBufferProcessorInputLatencyFrames( PaUtilBufferProcessor* bp )
 {
     return bp->initialFramesInTempInputBuffer;
@@ -686,6 +853,7 @@ void PaUtil_BeginBufferProcessing( PaUtilBufferProcessor* bp,
     bp->timeInfo->outputBufferDacTime += bp->framesInTempOutputBuffer * bp->samplePeriod;
 
     bp->callbackStatusFlags = callbackStatusFlags;
+    RecordWakeup( bp, callbackStatusFlags );
 
     bp->hostInputFrameCount[1] = 0;
     bp->hostOutputFrameCount[1] = 0;
@@ -866,8 +1034,10 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
                 }
             }
         
+            BeginCallbackMeasurement( bp );
             *streamCallbackResult = bp->streamCallback( userInput, userOutput,
                     frameCount, bp->timeInfo, bp->callbackStatusFlags, bp->userData );
+            EndCallbackMeasurement( bp, frameCount );
 
             if( *streamCallbackResult == paAbort )
             {
@@ -1048,9 +1218,11 @@ static unsigned long AdaptingInputOnlyProcess( PaUtilBufferProcessor *bp,
             {
                 bp->timeInfo->outputBufferDacTime = 0;
 
+                BeginCallbackMeasurement( bp );
                 *streamCallbackResult = bp->streamCallback( userInput, userOutput,
                         bp->framesPerUserBuffer, bp->timeInfo,
                         bp->callbackStatusFlags, bp->userData );
+                EndCallbackMeasurement( bp, bp->framesPerUserBuffer );
 
                 bp->timeInfo->inputBufferAdcTime += bp->framesPerUserBuffer * bp->samplePeriod;
             }
@@ -1110,9 +1282,11 @@ static unsigned long AdaptingOutputOnlyProcess( PaUtilBufferProcessor *bp,
 
             bp->timeInfo->inputBufferAdcTime = 0;
             
+            BeginCallbackMeasurement( bp );
             *streamCallbackResult = bp->streamCallback( userInput, userOutput,
                     bp->framesPerUserBuffer, bp->timeInfo,
                     bp->callbackStatusFlags, bp->userData );
+            EndCallbackMeasurement( bp, bp->framesPerUserBuffer );
 
             if( *streamCallbackResult == paAbort )
             {
@@ -1296,8 +1470,18 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
     unsigned int destSampleStrideSamples; /* stride from one sample to the next within a channel, in samples */
     unsigned int destChannelStrideBytes; /* stride from one channel to the next, in bytes */
     unsigned int i, j;
+    int noInput = !bp->hostInputChannels[0][0].data;
  
 
+    if( noInput )
+    {
+        /* no input was supplied (see PaUtil_SetNoInput), for example while
+            priming the output. Zeros are fed to the callback instead, and the
+            output frame count determines how much is processed */
+        bp->hostInputFrameCount[0] = bp->hostOutputFrameCount[0];
+        bp->hostInputFrameCount[1] = bp->hostOutputFrameCount[1];
+    }
+
     framesAvailable = bp->hostInputFrameCount[0] + bp->hostInputFrameCount[1];/* this is assumed to be the same as the output buffer's frame count */
 
     if( processPartialUserBuffers )
@@ -1378,16 +1562,23 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
 
             for( i=0; i<bp->inputChannelCount; ++i )
             {
-                bp->inputConverter( destBytePtr, destSampleStrideSamples,
-                                        hostInputChannels[i].data,
-                                        hostInputChannels[i].stride,
-                                        frameCount, &bp->ditherGenerator );
+                if( noInput )
+                {
+                    bp->inputZeroer( destBytePtr, destSampleStrideSamples, frameCount );
+                }
+                else
+                {
+                    bp->inputConverter( destBytePtr, destSampleStrideSamples,
+                                            hostInputChannels[i].data,
+                                            hostInputChannels[i].stride,
+                                            frameCount, &bp->ditherGenerator );
+
+                    /* advance src ptr for next iteration */
+                    hostInputChannels[i].data = ((unsigned char*)hostInputChannels[i].data) +
+                            frameCount * hostInputChannels[i].stride * bp->bytesPerHostInputSample;
+                }
 
                 destBytePtr += destChannelStrideBytes;  /* skip to next destination channel */
-
-                /* advance src ptr for next iteration */
-                hostInputChannels[i].data = ((unsigned char*)hostInputChannels[i].data) +
-                        frameCount * hostInputChannels[i].stride * bp->bytesPerHostInputSample;
             }
 
             if( bp->hostInputFrameCount[0] > 0 )
@@ -1444,9 +1635,11 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
 
                 /* call streamCallback */
 
+                BeginCallbackMeasurement( bp );
                 *streamCallbackResult = bp->streamCallback( userInput, userOutput,
                         bp->framesPerUserBuffer, bp->timeInfo,
                         bp->callbackStatusFlags, bp->userData );
+                EndCallbackMeasurement( bp, bp->framesPerUserBuffer );
 
                 bp->timeInfo->inputBufferAdcTime += bp->framesPerUserBuffer * bp->samplePeriod;
                 bp->timeInfo->outputBufferDacTime += bp->framesPerUserBuffer * bp->samplePeriod;
@@ -1494,6 +1687,8 @@ unsigned long PaUtil_EndBufferProcessing( PaUtilBufferProcessor* bp, int *stream
             || *streamCallbackResult == paComplete
             || *streamCallbackResult == paAbort ); /* don't forget to pass in a valid callback result value */
 
+    PaUtil_TraceBegin( bp->trace, "buffer processing" );
+
     if( bp->useNonAdaptingProcess )
     {
         if( bp->inputChannelCount != 0 && bp->outputChannelCount != 0 )
@@ -1645,6 +1840,10 @@ unsigned long PaUtil_EndBufferProcessing( PaUtilBufferProcessor* bp, int *stream
         }
     }
 
+    bp->expectedWakeupInterval += framesProcessed * bp->samplePeriod;
+
+    PaUtil_TraceEnd( bp->trace, "buffer processing" );
+
     return framesProcessed;
 }
 
@@ -1652,7 +1851,22 @@ unsigned long PaUtil_EndBufferProcessing( PaUtilBufferProcessor* bp, int *stream
 int PaUtil_IsBufferProcessorOutputEmpty( PaUtilBufferProcessor* bp )
 {
     return (bp->framesInTempOutputBuffer) ? 0 : 1;
-} 
+}
+
+void PaUtil_BeginDirectStreamCallback( PaUtilBufferProcessor* bp,
+        PaStreamCallbackFlags callbackStatusFlags )
+{
+    RecordWakeup( bp, callbackStatusFlags );
+    BeginCallbackMeasurement( bp );
+}
+
+
+void PaUtil_EndDirectStreamCallback( PaUtilBufferProcessor* bp, unsigned long frameCount )
+{
+    EndCallbackMeasurement( bp, frameCount );
+    bp->expectedWakeupInterval += frameCount * bp->samplePeriod;
+}
+ 
 
 
 unsigned long PaUtil_CopyInput( PaUtilBufferProcessor* bp,
@@ -87,7 +87,8 @@
 
  Call PaUtil_ResetBufferProcessor to clear any sample data which is present
  in the buffer processor before starting to use it (for example when
- Pa_StartStream is called).
+ Pa_StartStream is called), and PaUtil_ResetBufferProcessorStatistics to
+ clear the callback timing, jitter and xrun statistics it gathers.
 
  When the buffer processor is no longer used call
  PaUtil_TerminateBufferProcessor.
@@ -245,12 +246,34 @@ typedef struct PaUtilChannelDescriptor{
 }PaUtilChannelDescriptor;
 
 
+/** @brief Callback timing and status statistics gathered by the buffer
+ processor. See PaStreamStatistics for the meaning of the fields.
+*/
+typedef struct PaUtilBufferProcessorStatistics{
+    unsigned long callbackCount;
+    PaTime minCallbackDuration;
+    PaTime maxCallbackDuration;
+    PaTime totalCallbackDuration;
+    unsigned long overBudgetCallbackCount;
+
+    unsigned long wakeupCount;
+    PaTime totalWakeupJitter;
+    PaTime maxWakeupJitter;
+    unsigned long wakeupJitterHistogram[paWakeupJitterBinCount];
+
+    unsigned long inputUnderflowCount;
+    unsigned long inputOverflowCount;
+    unsigned long outputUnderflowCount;
+    unsigned long outputOverflowCount;
+}PaUtilBufferProcessorStatistics;
+
+
 /** @brief The main buffer processor data structure.
 
  Allocate one of these, initialize it with PaUtil_InitializeBufferProcessor
  and terminate it with PaUtil_TerminateBufferProcessor.
 */
-typedef struct {
+typedef struct PaUtilBufferProcessor{
     unsigned long framesPerUserBuffer;
     unsigned long framesPerHostBuffer;
 
@@ -310,6 +333,16 @@ typedef struct {
 
     PaStreamCallback *streamCallback;
     void *userData;
+
+    unsigned long lockedMemorySize; /**< bytes locked when initialized with paLockStreamMemory */
+
+    struct PaUtilTrace *trace; /**< the stream trace, NULL unless tracing is enabled. see pa_trace.h */
+
+    PaUtilBufferProcessorStatistics statistics;
+    volatile unsigned long statisticsSequence; /**< odd while statistics is being updated */
+    PaTime callbackStartTime;
+    PaTime lastWakeupTime;          /**< when the current host wakeup began, 0 before the first one */
+    PaTime expectedWakeupInterval;  /**< duration of the frames processed since lastWakeupTime */
 } PaUtilBufferProcessor;
 
 
@@ -345,7 +378,8 @@ typedef struct {
  
  @param streamFlags Stream flags as passed to Pa_OpenStream, this parameter is
  used for selecting special sample conversion options such as clipping and
- dithering.
+ dithering. If paLockStreamMemory is set the processor's buffers are locked
+ and the number of bytes locked is stored in lockedMemorySize.
  
  @param framesPerUserBuffer Number of frames per user buffer, as requested
  by the framesPerBuffer parameter to Pa_OpenStream. This parameter may be
@@ -406,6 +440,32 @@ void PaUtil_TerminateBufferProcessor( PaUtilBufferProcessor* bufferProcessor );
 void PaUtil_ResetBufferProcessor( PaUtilBufferProcessor* bufferProcessor );
 
 
+/** Clear internally buffered output data only, e.g. after the host API has
+ discarded queued output, so that the next callback renders all of it again.
+ Buffered input is kept.
+
+ @param bufferProcessor The buffer processor to reset.
+*/
+void PaUtil_ResetBufferProcessorOutput( PaUtilBufferProcessor* bufferProcessor );
+
+
+/** Clear the statistics gathered by a buffer processor. Call it from your
+ StartStream routine, so that each run of the stream reports its own
+ statistics. PaUtil_ResetBufferProcessor doesn't clear them, since it is
+ also used to flush the buffer processor while the stream is running.
+ Readers using PaUtil_GetBufferProcessorStatistics never observe a partially
+ cleared set of statistics.
+*/
+void PaUtil_ResetBufferProcessorStatistics( PaUtilBufferProcessor* bufferProcessor );
+
+
+/** Retrieve a consistent copy of the statistics gathered by a buffer
+ processor. May be called from any thread while the stream is running.
+*/
+void PaUtil_GetBufferProcessorStatistics( PaUtilBufferProcessor* bufferProcessor,
+        PaUtilBufferProcessorStatistics *statistics );
+
+
 /** Retrieve the input latency of a buffer processor, in frames.
 
  @param bufferProcessor The buffer processor examine.
@@ -673,6 +733,21 @@ unsigned long PaUtil_EndBufferProcessing( PaUtilBufferProcessor* bufferProcessor
 */
 int PaUtil_IsBufferProcessorOutputEmpty( PaUtilBufferProcessor* bufferProcessor );
 
+
+/** Account for a stream callback which a host API makes itself, bypassing
+ the buffer processor, so that it is reflected in the buffer processor's
+ statistics and in the stream trace. Call PaUtil_BeginDirectStreamCallback
+ immediately before the callback and PaUtil_EndDirectStreamCallback after it.
+
+ @param callbackStatusFlags The flags passed to the callback.
+
+ @param frameCount The number of frames the callback processed.
+*/
+void PaUtil_BeginDirectStreamCallback( PaUtilBufferProcessor* bufferProcessor,
+        PaStreamCallbackFlags callbackStatusFlags );
+void PaUtil_EndDirectStreamCallback( PaUtilBufferProcessor* bufferProcessor,
+        unsigned long frameCount );
+
 /*@}*/
 
 
@@ -93,6 +93,10 @@ void PaUtil_InitializeStreamRepresentation( PaUtilStreamRepresentation *streamRe
     streamRepresentation->streamInfo.inputLatency = 0.;
     streamRepresentation->streamInfo.outputLatency = 0.;
     streamRepresentation->streamInfo.sampleRate = 0.;
+    streamRepresentation->streamInfo.lockedMemorySize = 0;
+
+    streamRepresentation->cpuLoadMeasurer = 0;
+    streamRepresentation->bufferProcessor = 0;
 }
 
 
@@ -152,6 +152,8 @@ typedef struct PaUtilStreamRepresentation {
     PaStreamFinishedCallback *streamFinishedCallback;
     void *userData;
     PaStreamInfo streamInfo;
+    struct PaUtilCpuLoadMeasurer *cpuLoadMeasurer; /**< the stream's measurer, for Pa_GetStreamStatistics(). NULL if the host API doesn't measure the load */
+    struct PaUtilBufferProcessor *bufferProcessor; /**< the stream's buffer processor, for Pa_GetStreamStatistics(). NULL if the host API doesn't use one */
 } PaUtilStreamRepresentation;
 
 
@@ -47,11 +47,707 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <string.h>
+#include <ctype.h>
 #include <assert.h>
 #include "pa_trace.h"
 #include "pa_util.h"
 #include "pa_debugprint.h"
+#include "pa_memorybarrier.h"
+
+#if defined(_MSC_VER) && (_MSC_VER < 1900)
+#define snprintf _snprintf
+#endif
+
+
+/* Arguments are stored untyped, the conversions in the event's format string
+   select which member is used. */
+typedef union PaUtilTraceArgument
+{
+    long integer;
+    double real;
+    const void *pointer;
+} PaUtilTraceArgument;
+
+typedef struct PaUtilTraceRecord
+{
+    /* write index + 1 once the record is complete, 0 while it is being
+       written. Lets a dump detect records overwritten while it reads them. */
+    volatile unsigned long sequence;
+    PaTime timeStamp;
+    const char *format;
+    PaUtilTraceEventType type;
+    unsigned long threadId; /* rings are reused after PaUtil_ReleaseTraceThread() */
+    PaUtilTraceArgument arguments[PA_TRACE_MAX_ARGUMENTS];
+} PaUtilTraceRecord;
+
+#define PA_TRACE_RING_FREE_      (0)
+#define PA_TRACE_RING_CLAIMED_   (1)
+#define PA_TRACE_RING_OWNED_     (2)
+
+/* A ring is written only by the thread that owns it, readers only look at
+   records below writeIndex. */
+typedef struct PaUtilTraceRing
+{
+    volatile long state;
+    volatile unsigned long threadId;
+    PaUtilTraceRecord *records;
+    volatile unsigned long writeIndex;
+} PaUtilTraceRing;
+
+struct PaUtilTrace
+{
+    PaUtilTraceMode mode;
+    unsigned long ringSize; /* a power of two */
+    PaTime timeReference;
+    volatile long droppedCount;
+    PaUtilTraceRecord *records;
+    PaUtilTraceRing rings[PA_TRACE_MAX_THREADS];
+};
+
+
+PaError PaUtil_CreateTrace( PaUtilTrace **trace, unsigned long recordsPerThread,
+        PaUtilTraceMode mode )
+{
+    PaUtilTrace *newTrace;
+    unsigned long ringSize = 1;
+    int i;
+
+    assert( trace != NULL );
+
+    while( ringSize < recordsPerThread )
+    {
+        if( ringSize > (unsigned long)-1 / (2 * PA_TRACE_MAX_THREADS * sizeof(PaUtilTraceRecord)) )
+            return paInsufficientMemory;
+        ringSize <<= 1;
+    }
+
+    newTrace = (PaUtilTrace*)PaUtil_AllocateMemory( sizeof(PaUtilTrace) );
+    if( newTrace == NULL )
+        return paInsufficientMemory;
+    memset( newTrace, 0, sizeof(PaUtilTrace) );
+
+    newTrace->records = (PaUtilTraceRecord*)PaUtil_AllocateMemory(
+            sizeof(PaUtilTraceRecord) * ringSize * PA_TRACE_MAX_THREADS );
+    if( newTrace->records == NULL )
+    {
+        PaUtil_FreeMemory( newTrace );
+        return paInsufficientMemory;
+    }
+    memset( newTrace->records, 0, sizeof(PaUtilTraceRecord) * ringSize * PA_TRACE_MAX_THREADS );
+
+    newTrace->mode = mode;
+    newTrace->ringSize = ringSize;
+    newTrace->timeReference = PaUtil_GetTime();
+    for( i = 0; i < PA_TRACE_MAX_THREADS; ++i )
+        newTrace->rings[i].records = newTrace->records + i * ringSize;
+
+    *trace = newTrace;
+    return paNoError;
+}
+
+
+void PaUtil_DestroyTrace( PaUtilTrace *trace )
+{
+    if( trace == NULL )
+        return;
+
+    PaUtil_FreeMemory( trace->records );
+    PaUtil_FreeMemory( trace );
+}
+
+
+void PaUtil_ResetTraceTimeReference( PaUtilTrace *trace )
+{
+    if( trace != NULL )
+        trace->timeReference = PaUtil_GetTime();
+}
+
+
+unsigned long PaUtil_GetTraceDroppedCount( PaUtilTrace *trace )
+{
+    return trace != NULL ? (unsigned long)trace->droppedCount : 0;
+}
+
+
+static void CountDroppedEvent( PaUtilTrace *trace )
+{
+    long count;
+
+    do
+    {
+        count = trace->droppedCount;
+    }
+    while( !PaUtil_AtomicCompareAndSwap( &trace->droppedCount, count, count + 1 ) );
+}
+
+
+/* Find the ring owned by the calling thread, claiming a free one on the
+   thread's first event. Returns NULL if all rings belong to other threads. */
+static PaUtilTraceRing *GetThreadRing( PaUtilTrace *trace )
+{
+    unsigned long threadId = PaUtil_GetCurrentThreadId();
+    int i;
+
+    for( i = 0; i < PA_TRACE_MAX_THREADS; ++i )
+    {
+        PaUtilTraceRing *ring = &trace->rings[i];
+        if( ring->state == PA_TRACE_RING_OWNED_ && ring->threadId == threadId )
+            return ring;
+    }
+
+    for( i = 0; i < PA_TRACE_MAX_THREADS; ++i )
+    {
+        PaUtilTraceRing *ring = &trace->rings[i];
+        if( ring->state == PA_TRACE_RING_FREE_
+                && PaUtil_AtomicCompareAndSwap( &ring->state, PA_TRACE_RING_FREE_, PA_TRACE_RING_CLAIMED_ ) )
+        {
+            ring->threadId = threadId;
+            PaUtil_WriteMemoryBarrier();
+            ring->state = PA_TRACE_RING_OWNED_;
+            return ring;
+        }
+    }
+
+    return NULL;
+}
+
+
+/* Return the record the calling thread should fill in next, or NULL if the
+   event must be dropped. Complete the record with EndRecord(). */
+static PaUtilTraceRecord *BeginRecord( PaUtilTrace *trace, PaUtilTraceRing **ring )
+{
+    PaUtilTraceRecord *record;
+    unsigned long index;
+
+    *ring = GetThreadRing( trace );
+    if( *ring == NULL )
+    {
+        CountDroppedEvent( trace );
+        return NULL;
+    }
+
+    index = (*ring)->writeIndex;
+    if( trace->mode == paUtilTraceStopWhenFull && index >= trace->ringSize )
+    {
+        CountDroppedEvent( trace );
+        return NULL;
+    }
+
+    record = &(*ring)->records[ index & (trace->ringSize - 1) ];
+    record->sequence = 0;
+    PaUtil_WriteMemoryBarrier();
+    record->timeStamp = PaUtil_GetTime();
+    record->threadId = (*ring)->threadId;
+    return record;
+}
+
+
+static void EndRecord( PaUtilTraceRing *ring, PaUtilTraceRecord *record )
+{
+    unsigned long index = ring->writeIndex;
+
+    PaUtil_WriteMemoryBarrier();
+    record->sequence = index + 1;
+    ring->writeIndex = index + 1;
+}
+
+
+void PaUtil_TraceEvent( PaUtilTrace *trace, const char *format,
+        long arg0, long arg1, long arg2, long arg3 )
+{
+    PaUtilTraceRing *ring;
+    PaUtilTraceRecord *record;
+
+    if( trace == NULL )
+        return;
+
+    record = BeginRecord( trace, &ring );
+    if( record != NULL )
+    {
+        record->format = format;
+        record->type = paUtilTraceInstant;
+        record->arguments[0].integer = arg0;
+        record->arguments[1].integer = arg1;
+        record->arguments[2].integer = arg2;
+        record->arguments[3].integer = arg3;
+        EndRecord( ring, record );
+    }
+}
+
+
+static void AddSpanEvent( PaUtilTrace *trace, PaUtilTraceEventType type, const char *name )
+{
+    PaUtilTraceRing *ring;
+    PaUtilTraceRecord *record;
+
+    if( trace == NULL )
+        return;
+
+    record = BeginRecord( trace, &ring );
+    if( record != NULL )
+    {
+        record->format = name;
+        record->type = type;
+        EndRecord( ring, record );
+    }
+}
+
+
+void PaUtil_TraceBegin( PaUtilTrace *trace, const char *name )
+{
+    AddSpanEvent( trace, paUtilTraceBegin, name );
+}
+
+
+void PaUtil_TraceEnd( PaUtilTrace *trace, const char *name )
+{
+    AddSpanEvent( trace, paUtilTraceEnd, name );
+}
+
+
+void PaUtil_ReleaseTraceThread( PaUtilTrace *trace )
+{
+    unsigned long threadId;
+    int i;
+
+    if( trace == NULL )
+        return;
+
+    threadId = PaUtil_GetCurrentThreadId();
+    for( i = 0; i < PA_TRACE_MAX_THREADS; ++i )
+    {
+        PaUtilTraceRing *ring = &trace->rings[i];
+        if( ring->state == PA_TRACE_RING_OWNED_ && ring->threadId == threadId )
+        {
+            /* make our records visible before the ring can be claimed */
+            PaUtil_WriteMemoryBarrier();
+            ring->state = PA_TRACE_RING_FREE_;
+            return;
+        }
+    }
+}
+
+
+typedef struct PaUtilTraceConversion
+{
+    const char *begin;      /* the '%' */
+    const char *modifiers;  /* the first length modifier, or the conversion if there is none */
+    const char *end;        /* one past the conversion character */
+    char type;              /* the conversion character */
+} PaUtilTraceConversion;
+
+/* Find the next conversion specification in format. "%%" is returned as a
+   conversion of type '%'. Returns 0 if there are no more conversions or the
+   next one is not supported. */
+static int FindConversion( const char *format, PaUtilTraceConversion *conversion )
+{
+    const char *p = strchr( format, '%' );
+
+    if( p == NULL )
+        return 0;
+
+    conversion->begin = p++;
+    while( *p != '\0' && strchr( "-+ #0", *p ) != NULL )
+        ++p;
+    while( isdigit( (unsigned char)*p ) || *p == '.' )
+        ++p;
+    conversion->modifiers = p;
+    while( *p != '\0' && strchr( "hlLqjzt", *p ) != NULL )
+        ++p;
+
+    conversion->type = *p;
+    if( *p == '\0' || strchr( "%diouxXcfFeEgGaAsp", *p ) == NULL )
+        return 0;
+
+    conversion->end = p + 1;
+    return 1;
+}
+
+
+static int IsSignedConversion( char type )
+{
+    return type == 'd' || type == 'i' || type == 'c';
+}
+
+
+void PaUtil_TraceEventV( PaUtilTrace *trace, const char *format, va_list args )
+{
+    PaUtilTraceRing *ring;
+    PaUtilTraceRecord *record;
+    PaUtilTraceConversion conversion;
+    const char *p = format;
+    int i = 0;
+
+    if( trace == NULL )
+        return;
+
+    record = BeginRecord( trace, &ring );
+    if( record == NULL )
+        return;
+
+    record->format = format;
+    record->type = paUtilTraceInstant;
+
+    while( i < PA_TRACE_MAX_ARGUMENTS && FindConversion( p, &conversion ) )
+    {
+        PaUtilTraceArgument *argument = &record->arguments[i];
+        const char *m = conversion.modifiers;
+        int isSigned = IsSignedConversion( conversion.type );
+
+        p = conversion.end;
+
+        switch( conversion.type )
+        {
+        case '%':
+            continue;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            if( m[0] == 'L' )
+                argument->real = (double)va_arg( args, long double );
+            else
+                argument->real = va_arg( args, double );
+            break;
+        case 's': case 'p':
+            argument->pointer = va_arg( args, const void* );
+            break;
+        default:
+            if( m[0] == 'q' || m[0] == 'j' || (m[0] == 'l' && m[1] == 'l') )
+                argument->integer = isSigned ? (long)va_arg( args, long long ) : (long)va_arg( args, unsigned long long );
+            else if( m[0] == 'z' || m[0] == 't' )
+                argument->integer = (long)va_arg( args, size_t );
+            else if( m[0] == 'l' )
+                argument->integer = isSigned ? va_arg( args, long ) : (long)va_arg( args, unsigned long );
+            else /* int, and the promoted short and char types */
+                argument->integer = isSigned ? (long)va_arg( args, int ) : (long)va_arg( args, unsigned int );
+            break;
+        }
+
+        ++i;
+    }
+
+    EndRecord( ring, record );
+}
+
+
+/* Maximum length of a formatted event, including the terminator */
+#define PA_TRACE_TEXT_SIZE_   (256)
+
+/* Append up to count characters of text to the length characters held by a
+   buffer of size bytes, truncating to fit. */
+static void AppendText( char *buffer, size_t size, size_t *length, const char *text, size_t count )
+{
+    if( count > size - 1 - *length )
+        count = size - 1 - *length;
+    memcpy( buffer + *length, text, count );
+    *length += count;
+    buffer[*length] = '\0';
+}
+
+
+/* Account for the result of snprintf() writing at buffer + *length */
+static void AppendFormatted( char *buffer, size_t size, size_t *length, int count )
+{
+    if( count > 0 )
+        *length += ( (size_t)count < size - 1 - *length ) ? (size_t)count : size - 1 - *length;
+    buffer[*length] = '\0';
+}
+
+
+/* Format the text of an event into buffer, truncating it to size - 1 characters */
+static void FormatRecord( char *buffer, size_t size, const PaUtilTraceRecord *record )
+{
+    PaUtilTraceConversion conversion;
+    const char *p = record->format;
+    size_t length = 0;
+    char spec[32];
+    int i = 0;
+
+    buffer[0] = '\0';
+
+    if( record->type != paUtilTraceInstant )
+    {
+        AppendText( buffer, size, &length, p, strlen( p ) );
+        return;
+    }
+
+    while( FindConversion( p, &conversion ) )
+    {
+        size_t prefixLength = conversion.modifiers - conversion.begin;
+        const PaUtilTraceArgument *argument = &record->arguments[i];
+        char *end;
+        size_t available;
+
+        AppendText( buffer, size, &length, p, conversion.begin - p );
+        p = conversion.end;
+        end = buffer + length;
+        available = size - length;
+
+        if( conversion.type == '%' )
+        {
+            AppendText( buffer, size, &length, "%", 1 );
+            continue;
+        }
+
+        if( i == PA_TRACE_MAX_ARGUMENTS || prefixLength + 3 > sizeof(spec) )
+        {
+            AppendText( buffer, size, &length, conversion.begin, conversion.end - conversion.begin );
+            continue;
+        }
+        ++i;
+
+        /* rebuild the specification with the modifier matching the stored type */
+        memcpy( spec, conversion.begin, prefixLength );
+        spec[prefixLength] = conversion.type;
+        spec[prefixLength + 1] = '\0';
+
+        switch( conversion.type )
+        {
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            AppendFormatted( buffer, size, &length, snprintf( end, available, spec, argument->real ) );
+            break;
+        case 's':
+            AppendFormatted( buffer, size, &length, snprintf( end, available, spec,
+                    argument->pointer != NULL ? (const char*)argument->pointer : "(null)" ) );
+            break;
+        case 'p':
+            AppendFormatted( buffer, size, &length, snprintf( end, available, spec, argument->pointer ) );
+            break;
+        case 'c':
+            AppendFormatted( buffer, size, &length, snprintf( end, available, spec, (int)argument->integer ) );
+            break;
+        default:
+            spec[prefixLength] = 'l';
+            spec[prefixLength + 1] = conversion.type;
+            spec[prefixLength + 2] = '\0';
+            if( IsSignedConversion( conversion.type ) )
+                AppendFormatted( buffer, size, &length, snprintf( end, available, spec, argument->integer ) );
+            else
+                AppendFormatted( buffer, size, &length, snprintf( end, available, spec,
+                        (unsigned long)argument->integer ) );
+            break;
+        }
+    }
+
+    AppendText( buffer, size, &length, p, strlen( p ) );
+}
+
+
+typedef struct PaUtilTraceEntry
+{
+    PaUtilTraceRecord record;
+    int thread;
+    unsigned long index;
+} PaUtilTraceEntry;
+
+static int CompareTraceEntries( const void *a, const void *b )
+{
+    const PaUtilTraceEntry *entryA = (const PaUtilTraceEntry*)a;
+    const PaUtilTraceEntry *entryB = (const PaUtilTraceEntry*)b;
+
+    if( entryA->record.timeStamp != entryB->record.timeStamp )
+        return entryA->record.timeStamp < entryB->record.timeStamp ? -1 : 1;
+    if( entryA->thread != entryB->thread )
+        return entryA->thread < entryB->thread ? -1 : 1;
+    return entryA->index < entryB->index ? -1 : (entryA->index > entryB->index);
+}
+
+
+/* Copy the complete records of all rings into a newly allocated array sorted
+   by time. Returns the number of entries, or -1 on allocation failure. */
+static long CollectTraceEntries( PaUtilTrace *trace, PaUtilTraceEntry **entries )
+{
+    long count = 0;
+    int i;
+
+    *entries = (PaUtilTraceEntry*)PaUtil_AllocateMemory(
+            sizeof(PaUtilTraceEntry) * trace->ringSize * PA_TRACE_MAX_THREADS );
+    if( *entries == NULL )
+        return -1;
+
+    for( i = 0; i < PA_TRACE_MAX_THREADS; ++i )
+    {
+        PaUtilTraceRing *ring = &trace->rings[i];
+        unsigned long end = ring->writeIndex;
+        unsigned long index = end > trace->ringSize ? end - trace->ringSize : 0;
+
+        PaUtil_ReadMemoryBarrier();
+        for( ; index != end; ++index )
+        {
+            PaUtilTraceRecord *record = &ring->records[ index & (trace->ringSize - 1) ];
+            PaUtilTraceEntry *entry = &(*entries)[count];
+            unsigned long sequence = record->sequence;
+
+            PaUtil_ReadMemoryBarrier();
+            entry->record = *record;
+            PaUtil_ReadMemoryBarrier();
+
+            /* skip records the writer has started to overwrite */
+            if( sequence == index + 1 && record->sequence == sequence )
+            {
+                entry->thread = i;
+                entry->index = index;
+                ++count;
+            }
+        }
+    }
+
+    qsort( *entries, count, sizeof(PaUtilTraceEntry), CompareTraceEntries );
+    return count;
+}
+
+
+void PaUtil_DumpTrace( PaUtilTrace *trace, const char *fileName )
+{
+    PaUtilTraceEntry *entries;
+    long count, i;
+    FILE *f;
+
+    if( trace == NULL )
+        return;
+
+    count = CollectTraceEntries( trace, &entries );
+    if( count < 0 )
+    {
+        PA_DEBUG(( "PaUtil_DumpTrace: insufficient memory\n" ));
+        return;
+    }
+
+    f = (fileName != NULL) ? fopen( fileName, "w" ) : stdout;
+    if( f != NULL )
+    {
+        static const char *typePrefixes[] = { "", "begin ", "end " };
+        char text[PA_TRACE_TEXT_SIZE_];
+
+        for( i = 0; i < count; ++i )
+        {
+            FormatRecord( text, sizeof(text), &entries[i].record );
+            /* milliseconds with microsecond resolution */
+            fprintf( f, "%09.3f [%d]: %s%s\n", (entries[i].record.timeStamp - trace->timeReference) * 1000.,
+                    entries[i].thread, typePrefixes[entries[i].record.type], text );
+        }
+
+        if( trace->droppedCount > 0 )
+            fprintf( f, "%lu events dropped\n", (unsigned long)trace->droppedCount );
+
+        if( f != stdout )
+            fclose( f );
+        else
+            fflush( f );
+    }
+
+    PaUtil_FreeMemory( entries );
+}
+
+
+static void WriteJsonString( FILE *f, const char *text )
+{
+    fputc( '"', f );
+    for( ; *text != '\0'; ++text )
+    {
+        unsigned char c = (unsigned char)*text;
+
+        if( c == '"' || c == '\\' )
+            fprintf( f, "\\%c", c );
+        else if( c < 0x20 )
+            fprintf( f, "\\u%04x", c );
+        else
+            fputc( c, f );
+    }
+    fputc( '"', f );
+}
+
+
+PaError PaUtil_ExportChromeTrace( PaUtilTrace *trace, const char *fileName )
+{
+    static const char *phases[] = { "i", "B", "E" };
+    PaUtilTraceEntry *entries;
+    char text[PA_TRACE_TEXT_SIZE_];
+    long count, i;
+    FILE *f;
+
+    if( trace == NULL )
+        return paNoError;
+
+    count = CollectTraceEntries( trace, &entries );
+    if( count < 0 )
+        return paInsufficientMemory;
+
+    f = fopen( fileName, "w" );
+    if( f == NULL )
+    {
+        PA_DEBUG(( "PaUtil_ExportChromeTrace: could not open %s\n", fileName ));
+        PaUtil_FreeMemory( entries );
+        return paInternalError;
+    }
+
+    fprintf( f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+    fprintf( f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"PortAudio\"}}" );
+
+    for( i = 0; i < count; ++i )
+    {
+        const PaUtilTraceRecord *record = &entries[i].record;
+
+        FormatRecord( text, sizeof(text), record );
+        fprintf( f, ",\n{\"name\":" );
+        WriteJsonString( f, text );
+        /* timestamps are in microseconds */
+        fprintf( f, ",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu%s}",
+                phases[record->type], (record->timeStamp - trace->timeReference) * 1000000.,
+                record->threadId, record->type == paUtilTraceInstant ? ",\"s\":\"t\"" : "" );
+    }
+
+    if( trace->droppedCount > 0 )
+    {
+        fprintf( f, ",\n{\"name\":\"%lu events dropped\",\"ph\":\"i\",\"s\":\"g\",\"ts\":0,\"pid\":1,\"tid\":0}",
+                (unsigned long)trace->droppedCount );
+    }
+
+    fprintf( f, "\n]}\n" );
+    fclose( f );
+
+    PaUtil_FreeMemory( entries );
+    return paNoError;
+}
+
+
+static PaUtilTrace *streamTrace_ = NULL;
+
+void PaUtil_InitializeStreamTrace( void )
+{
+    const char *records = getenv( "PA_TRACE_RECORDS" );
+
+    if( streamTrace_ != NULL || getenv( "PA_TRACE_FILE" ) == NULL )
+        return;
+
+    if( PaUtil_CreateTrace( &streamTrace_, records != NULL ? strtoul( records, NULL, 10 ) : PA_STREAM_TRACE_RECORDS,
+                paUtilTraceOverwrite ) != paNoError )
+    {
+        PA_DEBUG(( "%s: Failed to allocate the stream trace\n", __FUNCTION__ ));
+        streamTrace_ = NULL;
+    }
+}
+
+
+void PaUtil_TerminateStreamTrace( void )
+{
+    const char *fileName = getenv( "PA_TRACE_FILE" );
+
+    if( streamTrace_ == NULL )
+        return;
+
+    if( fileName != NULL )
+        PaUtil_ExportChromeTrace( streamTrace_, fileName );
+    PaUtil_DestroyTrace( streamTrace_ );
+    streamTrace_ = NULL;
+}
+
+
+PaUtilTrace *PaUtil_GetStreamTrace( void )
+{
+    return streamTrace_;
+}
+
 
 #if PA_TRACE_REALTIME_EVENTS
 
@@ -102,129 +798,46 @@ void PaUtil_AddTraceMessage( const char *msg, int data )
 /* High performance log alternative                                     */
 /************************************************************************/
 
-typedef unsigned long long  PaUint64;
-
-typedef struct __PaHighPerformanceLog
-{
-    unsigned    magik;
-    int         writePtr;
-    int         readPtr;
-    int         size;
-    double      refTime;
-    char*       data;
-} PaHighPerformanceLog;
-
-static const unsigned kMagik = 0xcafebabe;
-
-#define USEC_PER_SEC    (1000000ULL)
+/* The high speed log is a PaUtilTrace which stops when full. The size is
+   shared between the maximum number of writing threads. */
 
 int PaUtil_InitializeHighSpeedLog( LogHandle* phLog, unsigned maxSizeInBytes )
 {
-    PaHighPerformanceLog* pLog = (PaHighPerformanceLog*)PaUtil_AllocateMemory(sizeof(PaHighPerformanceLog));
-    if (pLog == 0)
-    {
-        return paInsufficientMemory;
-    }
-    assert(phLog != 0);
-    *phLog = pLog;
+    PaUtilTrace *trace;
+    PaError result;
 
-    pLog->data = (char*)PaUtil_AllocateMemory(maxSizeInBytes);
-    if (pLog->data == 0)
-    {
-        PaUtil_FreeMemory(pLog);
-        return paInsufficientMemory;
-    }
-    pLog->magik = kMagik;
-    pLog->size = maxSizeInBytes;
-    pLog->refTime = PaUtil_GetTime();
-    return paNoError;
+    assert(phLog != 0);
+    result = PaUtil_CreateTrace( &trace,
+            maxSizeInBytes / (sizeof(PaUtilTraceRecord) * PA_TRACE_MAX_THREADS),
+            paUtilTraceStopWhenFull );
+    if( result == paNoError )
+        *phLog = trace;
+    return result;
 }
 
 void PaUtil_ResetHighSpeedLogTimeRef( LogHandle hLog )
 {
-    PaHighPerformanceLog* pLog = (PaHighPerformanceLog*)hLog;
-    assert(pLog->magik == kMagik);
-    pLog->refTime = PaUtil_GetTime();
+    PaUtil_ResetTraceTimeReference( (PaUtilTrace*)hLog );
 }
 
-typedef struct __PaLogEntryHeader
-{
-    int    size;
-    double timeStamp;
-} PaLogEntryHeader;
-
-#ifdef __APPLE__
-#define _vsnprintf vsnprintf
-#define min(a,b) ((a)<(b)?(a):(b))
-#endif
-
-
 int PaUtil_AddHighSpeedLogMessage( LogHandle hLog, const char* fmt, ... )
 {
     va_list l;
-    int n = 0;
-    PaHighPerformanceLog* pLog = (PaHighPerformanceLog*)hLog;
-    if (pLog != 0)
-    {
-        PaLogEntryHeader* pHeader;
-        char* p;
-        int maxN;
-        assert(pLog->magik == kMagik);
-        pHeader = (PaLogEntryHeader*)( pLog->data + pLog->writePtr );
-        p = (char*)( pHeader + 1 );
-        maxN = pLog->size - pLog->writePtr - 2 * sizeof(PaLogEntryHeader);
-
-        pHeader->timeStamp = PaUtil_GetTime() - pLog->refTime;
-        if (maxN > 0)
-        {
-            if (maxN > 32)
-            {
-                va_start(l, fmt);
-                n = _vsnprintf(p, min(1024, maxN), fmt, l);
-                va_end(l);
-            }
-            else {
-                n = sprintf(p, "End of log...");
-            }
-            n = ((n + sizeof(unsigned)) & ~(sizeof(unsigned)-1)) + sizeof(PaLogEntryHeader);
-            pHeader->size = n;
-#if 0
-            PaUtil_DebugPrint("%05u.%03u: %s\n", pHeader->timeStamp/1000, pHeader->timeStamp%1000, p);
-#endif
-            pLog->writePtr += n;
-        }
-    }
-    return n;
+
+    va_start(l, fmt);
+    PaUtil_TraceEventV( (PaUtilTrace*)hLog, fmt, l );
+    va_end(l);
+    return 0;
 }
 
 void PaUtil_DumpHighSpeedLog( LogHandle hLog, const char* fileName )
 {
-    FILE* f = (fileName != NULL) ? fopen(fileName, "w") : stdout;
-    unsigned localWritePtr;
-    PaHighPerformanceLog* pLog = (PaHighPerformanceLog*)hLog;
-    assert(pLog->magik == kMagik);
-    localWritePtr = pLog->writePtr;
-    while (pLog->readPtr != localWritePtr)
-    {
-        const PaLogEntryHeader* pHeader = (const PaLogEntryHeader*)( pLog->data + pLog->readPtr );
-        const char* p = (const char*)( pHeader + 1 );
-        const PaUint64 ts = (const PaUint64)( pHeader->timeStamp * USEC_PER_SEC );
-        assert(pHeader->size < (1024+sizeof(unsigned)+sizeof(PaLogEntryHeader)));
-        fprintf(f, "%05u.%03u: %s\n", (unsigned)(ts/1000), (unsigned)(ts%1000), p);
-        pLog->readPtr += pHeader->size;
-    }
-    if (f != stdout)
-    {
-        fclose(f);
-    }
+    PaUtil_DumpTrace( (PaUtilTrace*)hLog, fileName );
 }
 
 void PaUtil_DiscardHighSpeedLog( LogHandle hLog )
 {
-    PaHighPerformanceLog* pLog = (PaHighPerformanceLog*)hLog;
-    assert(pLog->magik == kMagik);
-    PaUtil_FreeMemory(pLog->data);
-    PaUtil_FreeMemory(pLog);
+    PaUtil_DestroyTrace( (PaUtilTrace*)hLog );
 }
 
 #endif /* TRACE_REALTIME_EVENTS */
@@ -44,13 +44,33 @@
 
  @brief Real-time safe event trace logging facility for debugging.
 
- Allows data to be logged to a fixed size trace buffer in a real-time
- execution context (such as at interrupt time). Each log entry consists 
- of a message comprising a string pointer and an int.  The trace buffer 
- may be dumped to stdout later.
+ Allows events to be logged to fixed size trace buffers in a real-time
+ execution context (such as an audio callback) and printed later.
 
- This facility is only active if PA_TRACE_REALTIME_EVENTS is set to 1,
- otherwise the trace functions expand to no-ops.
+ A PaUtilTrace holds one ring of fixed-size binary records per thread that
+ writes to it, so writers never contend with each other or take locks.
+ Each record stores a format string pointer (which identifies the event),
+ a timestamp and a few arguments. Nothing is formatted until the trace is
+ dumped, so adding an event costs a clock read and a handful of stores.
+ When a ring fills it either stops accepting events or, in
+ paUtilTraceOverwrite mode, overwrites its oldest records so the trace
+ always holds the most recent history (flight recorder use).
+
+ The trace functions are always compiled in. All of them accept a NULL
+ trace and return immediately, so code can trace unconditionally and only
+ pay for a branch when tracing is not enabled.
+
+ Streams are traced to the trace returned by PaUtil_GetStreamTrace(). It is
+ only created if the PA_TRACE_FILE environment variable is set when
+ PortAudio is initialized. Pa_Terminate() then writes the events, in Chrome
+ Trace Event JSON format, to the file it names; the file can be opened in
+ Perfetto (ui.perfetto.dev) or chrome://tracing. PA_TRACE_RECORDS may be set
+ to the number of events retained per thread (PA_STREAM_TRACE_RECORDS by
+ default); older events are overwritten.
+
+ The older PaUtil_AddTraceMessage() and high speed log interfaces are only
+ active if PA_TRACE_REALTIME_EVENTS is set to 1, otherwise they expand to
+ no-ops. The high speed log is implemented on top of PaUtilTrace.
 
  @fn PaUtil_ResetTraceMessages
  @brief Clear the trace buffer.
@@ -65,6 +85,10 @@
  @brief Print all messages in the trace buffer to stdout and clear the trace buffer.
 */
 
+#include <stdarg.h>
+
+#include "portaudio.h"
+
 #ifndef PA_TRACE_REALTIME_EVENTS
 #define PA_TRACE_REALTIME_EVENTS     (0)   /**< Set to 1 to enable logging using the trace functions defined below */
 #endif
@@ -73,12 +97,148 @@
 #define PA_MAX_TRACE_RECORDS      (2048)   /**< Maximum number of records stored in trace buffer */   
 #endif
 
+#ifndef PA_TRACE_MAX_THREADS
+#define PA_TRACE_MAX_THREADS         (8)   /**< Maximum number of threads which may write to one PaUtilTrace */
+#endif
+
+#define PA_TRACE_MAX_ARGUMENTS       (4)   /**< Maximum number of arguments stored with each trace event */
+
+#ifndef PA_STREAM_TRACE_RECORDS
+#define PA_STREAM_TRACE_RECORDS  (16384)   /**< Default number of events retained per thread by the stream trace */
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif /* __cplusplus */
 
 
+/** Selects what happens when a thread's trace ring is full. */
+typedef enum PaUtilTraceMode
+{
+    paUtilTraceStopWhenFull, /**< discard new events, keeping the oldest ones */
+    paUtilTraceOverwrite     /**< overwrite the oldest events, keeping the newest ones */
+} PaUtilTraceMode;
+
+
+typedef struct PaUtilTrace PaUtilTrace;
+
+
+/** The kind of an event, which determines how it is exported. */
+typedef enum PaUtilTraceEventType
+{
+    paUtilTraceInstant, /**< a point in time */
+    paUtilTraceBegin,   /**< the start of a span on the calling thread */
+    paUtilTraceEnd      /**< the end of the innermost open span on the calling thread */
+} PaUtilTraceEventType;
+
+
+/** Allocate a trace.
+
+ @param trace Receives the new trace.
+
+ @param recordsPerThread The number of events retained for each thread. It is
+ rounded up to a power of two.
+
+ @param mode What to do when a thread's ring is full.
+
+ Storage for PA_TRACE_MAX_THREADS threads is allocated up front; no memory
+ is allocated when events are added.
+*/
+PaError PaUtil_CreateTrace( PaUtilTrace **trace, unsigned long recordsPerThread,
+        PaUtilTraceMode mode );
+
+
+/** Free a trace allocated by PaUtil_CreateTrace(). No thread may add
+ events to the trace during or after this call. Passing NULL does nothing.
+*/
+void PaUtil_DestroyTrace( PaUtilTrace *trace );
+
+
+/** Make subsequent dumps report times relative to the current time. Dumps
+ report times relative to the creation of the trace by default.
+*/
+void PaUtil_ResetTraceTimeReference( PaUtilTrace *trace );
+
+
+/** Add an event with up to PA_TRACE_MAX_ARGUMENTS integer arguments to the
+ calling thread's ring. Lock free, does not allocate and does not format.
+
+ @param format A printf style format string identifying the event. The
+ pointer must remain valid until the trace is dumped, so it should usually
+ be a string literal. Integer conversions are always passed a long, so any
+ length modifier may be used with d, i, u, x, X, o and c. Arguments which
+ the format does not refer to are ignored.
+*/
+void PaUtil_TraceEvent( PaUtilTrace *trace, const char *format,
+        long arg0, long arg1, long arg2, long arg3 );
+
+
+/** Add events marking the beginning and end of a span of time, such as a
+ callback invocation. Spans on one thread must nest. name must remain valid
+ until the trace is dumped; it is not used as a format.
+*/
+void PaUtil_TraceBegin( PaUtilTrace *trace, const char *name );
+void PaUtil_TraceEnd( PaUtilTrace *trace, const char *name );
+
+
+/** Add an event taking its arguments from a variable argument list, as
+ described by format. Up to PA_TRACE_MAX_ARGUMENTS integer, floating point,
+ pointer or string (%s) arguments are recorded. Strings are recorded by
+ pointer and must remain valid until the trace is dumped. The * width and
+ precision specifiers are not supported.
+*/
+void PaUtil_TraceEventV( PaUtilTrace *trace, const char *format, va_list args );
+
+
+/** Return the number of events which were discarded because a ring was full
+ (paUtilTraceStopWhenFull only) or more than PA_TRACE_MAX_THREADS threads
+ added events.
+*/
+unsigned long PaUtil_GetTraceDroppedCount( PaUtilTrace *trace );
+
+
+/** Give up the calling thread's ring so that a thread created later may
+ reuse it. Events already in the ring are kept. Threads which exit while a
+ trace is in use should call this, otherwise a trace can only ever serve
+ PA_TRACE_MAX_THREADS threads.
+*/
+void PaUtil_ReleaseTraceThread( PaUtilTrace *trace );
+
+
+/** Format the events held by a trace, merged from all threads in timestamp
+ order, and write them to the named file, or to stdout if fileName is NULL.
+ May be called while other threads add events; records overwritten during
+ the dump are skipped.
+*/
+void PaUtil_DumpTrace( PaUtilTrace *trace, const char *fileName );
+
+
+/** Write the events held by a trace to the named file as Chrome Trace Event
+ JSON, with one track per thread. Instant events are named by their
+ formatted text.
+*/
+PaError PaUtil_ExportChromeTrace( PaUtilTrace *trace, const char *fileName );
+
+
+/** Create the stream trace if the PA_TRACE_FILE environment variable is
+ set. Called by Pa_Initialize().
+*/
+void PaUtil_InitializeStreamTrace( void );
+
+
+/** Export the stream trace to PA_TRACE_FILE and free it. Called by
+ Pa_Terminate() once all streams are closed.
+*/
+void PaUtil_TerminateStreamTrace( void );
+
+
+/** Return the trace streams should add their events to, or NULL if stream
+ tracing is not enabled.
+*/
+PaUtilTrace *PaUtil_GetStreamTrace( void );
+
+
 #if PA_TRACE_REALTIME_EVENTS
 
 void PaUtil_ResetTraceMessages();
@@ -92,6 +92,17 @@ PaError PaUtil_DeviceIndexToHostApiDeviceIndex(
         struct PaUtilHostApiRepresentation *hostApi );
 
 
+/** Notify pa_front.c that the device count of a host API has changed after
+ initialization, e.g. because devices were hot-plugged. The base device index
+ and the default devices of every host API, and the total device count, are
+ recomputed. Devices of host APIs following the changed one are renumbered,
+ so host API implementations should prefer reusing indices they have
+ reserved, and must only append devices, so that the indices of their
+ existing devices remain valid.
+*/
+void PaUtil_HostApiDeviceCountChanged( void );
+
+
 /** Set the host error information returned by Pa_GetLastHostErrorInfo. This
  function and the paUnanticipatedHostError error code should be used as a
  last resort.  Implementors should use existing PA error codes where possible,
@@ -117,23 +128,84 @@ void PaUtil_SetLastHostErrorInfo( PaHostApiTypeId hostApiType, long errorCode,
  .c file
 */
 
-/** Allocate size bytes, guaranteed to be aligned to a FIXME byte boundary */
+/** Allocate size bytes, guaranteed to be aligned to a FIXME byte boundary.
+ The memory is accounted for as paMemoryGeneral.
+*/
 void *PaUtil_AllocateMemory( long size );
 
 
+/** Allocate size bytes like PaUtil_AllocateMemory, accounting for them in
+ category. Free the block with PaUtil_FreeMemory.
+
+ @see Pa_GetMemoryUsage
+*/
+void *PaUtil_AllocateTaggedMemory( long size, PaMemoryCategory category );
+
+
 /** Realease block if non-NULL. block may be NULL */
 void PaUtil_FreeMemory( void *block );
 
 
 /** Return the number of currently allocated blocks. This function can be
  used for detecting memory leaks.
-
- @note Allocations will only be tracked if PA_TRACK_MEMORY is #defined. If
- it isn't, this function will always return 0.
 */
 int PaUtil_CountCurrentlyAllocatedBlocks( void );
 
 
+/** Retrieve the memory accounted for in category, which may be
+ paMemoryTotal. category must be valid.
+*/
+void PaUtil_GetMemoryUsage( PaMemoryCategory category, PaMemoryUsage *usage );
+
+
+/** Prefault the pages spanned by block and lock them into physical memory
+ so that touching them from a real-time thread never causes a page fault.
+ Returns the number of bytes locked, which is 0 if the platform doesn't
+ support memory locking or the locked memory limit has been reached. In the
+ latter case the pages are still prefaulted. Prefaulting writes to every
+ page, so block must be writable.
+
+ @note Page locks do not nest, and allocations made with
+ PaUtil_AllocateMemory may share pages with unrelated data, so locked
+ memory is never explicitly unlocked. Pages are unlocked when the process
+ exits, and freed pages are reused by later allocations.
+*/
+long PaUtil_LockMemory( void *block, long size );
+
+
+/** Lock all current and future pages of the process into physical memory if
+ the PA_MLOCKALL environment variable is set to a nonzero value. Called by
+ Pa_Initialize.
+*/
+void PaUtil_InitializeMemoryLocking( void );
+
+
+/** Touch size bytes of the calling thread's stack so that the pages are
+ mapped before the thread enters its real-time loop.
+
+ @see PA_PREFAULT_STACK_SIZE
+*/
+void PaUtil_PrefaultStack( unsigned long size );
+
+/** The amount of stack pre-grown by host API callback threads of streams
+ opened with paLockStreamMemory.
+*/
+#define PA_PREFAULT_STACK_SIZE  (64 * 1024)
+
+
+/** Atomically replace *target with value if it currently equals expected.
+
+ @return Non-zero if the swap took place.
+*/
+int PaUtil_AtomicCompareAndSwap( volatile long *target, long expected, long value );
+
+
+/** Return an identifier for the calling thread which is unique among the
+ threads currently running in the process.
+*/
+unsigned long PaUtil_GetCurrentThreadId( void );
+
+
 /** Initialize the clock used by PaUtil_GetTime(). Call this before calling
  PaUtil_GetTime.
 
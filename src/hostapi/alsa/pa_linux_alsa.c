@@ -54,7 +54,13 @@
 #undef ALSA_PCM_NEW_SW_PARAMS_API
 
 #include <sys/poll.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/inotify.h>
+#include <unistd.h> /* close(), read() */
+#include <stdint.h>
 #include <string.h> /* strlen() */
+#include <stddef.h> /* offsetof() */
 #include <limits.h>
 #include <math.h>
 #include <pthread.h>
@@ -62,6 +68,7 @@
 #include <time.h>
 #include <sys/mman.h>
 #include <signal.h> /* For sig_atomic_t */
+#include <errno.h>
 #ifdef PA_ALSA_DYNAMIC
     #include <dlfcn.h> /* For dlXXX functions */
 #endif
@@ -76,6 +83,8 @@
 #include "pa_process.h"
 #include "pa_endianness.h"
 #include "pa_debugprint.h"
+#include "pa_memorybarrier.h"
+#include "pa_trace.h"
 
 #include "pa_linux_alsa.h"
 
@@ -87,6 +96,13 @@
 /* Combine version elements into a single (unsigned) integer */
 #define ALSA_VERSION_INT(major, minor, subminor)  ((major << 16) | (minor << 8) | subminor)
 
+/* The number of cards whose presence is tracked by PaAlsa_RefreshDeviceList, as in the default kernel configuration */
+#define PA_ALSA_MAX_CARDS 32
+/* Room for a card id (snd_ctl_card_info_get_id), which the kernel limits to 16 characters */
+#define PA_ALSA_CARD_ID_SIZE 32
+/* The directory holding the ALSA device nodes, watched for cards being added or removed */
+#define PA_ALSA_DEVICE_DIR "/dev/snd"
+
 /* The acceptable tolerance of sample rate set, to that requested (as a ratio, eg 50 is 2%, 100 is 1%) */
 #define RATE_MAX_DEVIATE_RATIO 100
 
@@ -123,6 +139,9 @@ _PA_DEFINE_FUNC(snd_pcm_poll_descriptors_revents);
 _PA_DEFINE_FUNC(snd_pcm_format_size);
 _PA_DEFINE_FUNC(snd_pcm_link);
 _PA_DEFINE_FUNC(snd_pcm_delay);
+_PA_DEFINE_FUNC(snd_pcm_rewind);
+_PA_DEFINE_FUNC(snd_pcm_rewindable);
+_PA_DEFINE_FUNC(snd_pcm_forward);
 
 _PA_DEFINE_FUNC(snd_pcm_hw_params_sizeof);
 _PA_DEFINE_FUNC(snd_pcm_hw_params_malloc);
@@ -182,6 +201,9 @@ _PA_DEFINE_FUNC(snd_pcm_sw_params_set_silence_threshold);
 _PA_DEFINE_FUNC(snd_pcm_sw_params_set_silence_size);
 _PA_DEFINE_FUNC(snd_pcm_sw_params_set_xfer_align);
 _PA_DEFINE_FUNC(snd_pcm_sw_params_set_tstamp_mode);
+#if SND_LIB_VERSION >= 0x01001d
+_PA_DEFINE_FUNC(snd_pcm_sw_params_set_tstamp_type);
+#endif
 #define alsa_snd_pcm_sw_params_alloca(ptr) __alsa_snd_alloca(ptr, snd_pcm_sw_params)
 
 _PA_DEFINE_FUNC(snd_pcm_info);
@@ -204,6 +226,7 @@ _PA_DEFINE_FUNC(snd_ctl_card_info_free);
 _PA_DEFINE_FUNC(snd_ctl_card_info);
 _PA_DEFINE_FUNC(snd_ctl_card_info_sizeof);
 _PA_DEFINE_FUNC(snd_ctl_card_info_get_name);
+_PA_DEFINE_FUNC(snd_ctl_card_info_get_id);
 #define alsa_snd_ctl_card_info_alloca(ptr) __alsa_snd_alloca(ptr, snd_ctl_card_info)
 
 _PA_DEFINE_FUNC(snd_config);
@@ -216,6 +239,12 @@ _PA_DEFINE_FUNC(snd_config_iterator_next);
 _PA_DEFINE_FUNC(snd_config_get_string);
 _PA_DEFINE_FUNC(snd_config_get_id);
 _PA_DEFINE_FUNC(snd_config_update_free_global);
+_PA_DEFINE_FUNC(snd_config_top);
+_PA_DEFINE_FUNC(snd_config_load);
+_PA_DEFINE_FUNC(snd_config_delete);
+_PA_DEFINE_FUNC(snd_input_buffer_open);
+_PA_DEFINE_FUNC(snd_input_close);
+_PA_DEFINE_FUNC(snd_pcm_open_lconf);
 
 _PA_DEFINE_FUNC(snd_pcm_status);
 _PA_DEFINE_FUNC(snd_pcm_status_sizeof);
@@ -404,6 +433,9 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_pcm_format_size);
     _PA_LOAD_FUNC(snd_pcm_link);
     _PA_LOAD_FUNC(snd_pcm_delay);
+    _PA_LOAD_FUNC(snd_pcm_rewind);
+    _PA_LOAD_FUNC(snd_pcm_rewindable);
+    _PA_LOAD_FUNC(snd_pcm_forward);
 
     _PA_LOAD_FUNC(snd_pcm_hw_params_sizeof);
     _PA_LOAD_FUNC(snd_pcm_hw_params_malloc);
@@ -462,6 +494,9 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_pcm_sw_params_set_silence_size);
     _PA_LOAD_FUNC(snd_pcm_sw_params_set_xfer_align);
     _PA_LOAD_FUNC(snd_pcm_sw_params_set_tstamp_mode);
+#if SND_LIB_VERSION >= 0x01001d
+    _PA_LOAD_FUNC(snd_pcm_sw_params_set_tstamp_type);
+#endif
 
     _PA_LOAD_FUNC(snd_pcm_info);
     _PA_LOAD_FUNC(snd_pcm_info_sizeof);
@@ -482,6 +517,7 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_ctl_card_info);
     _PA_LOAD_FUNC(snd_ctl_card_info_sizeof);
     _PA_LOAD_FUNC(snd_ctl_card_info_get_name);
+    _PA_LOAD_FUNC(snd_ctl_card_info_get_id);
 
     _PA_LOAD_FUNC(snd_config);
     _PA_LOAD_FUNC(snd_config_update);
@@ -493,6 +529,12 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_config_get_string);
     _PA_LOAD_FUNC(snd_config_get_id);
     _PA_LOAD_FUNC(snd_config_update_free_global);
+    _PA_LOAD_FUNC(snd_config_top);
+    _PA_LOAD_FUNC(snd_config_load);
+    _PA_LOAD_FUNC(snd_config_delete);
+    _PA_LOAD_FUNC(snd_input_buffer_open);
+    _PA_LOAD_FUNC(snd_input_close);
+    _PA_LOAD_FUNC(snd_pcm_open_lconf);
 
     _PA_LOAD_FUNC(snd_pcm_status);
     _PA_LOAD_FUNC(snd_pcm_status_sizeof);
@@ -586,6 +628,7 @@ static void PaAlsa_CloseLibrary()
 
 static int numPeriods_ = 4;
 static int busyRetries_ = 100;
+static int pcmPoolSize_ = 0;
 
 int PaAlsa_SetNumPeriods( int numPeriods )
 {
@@ -622,8 +665,36 @@ typedef struct
     StreamDirection streamDir;
 
     snd_pcm_channel_area_t *channelAreas;  /* Needed for channel adaption */
+    /* The number of frames preceding the application pointer whose unused channels are known to be silent in the
+     * mmap buffer. Once it reaches bufferSize, channel adaption no longer needs to silence them. */
+    snd_pcm_uframes_t silencedFrames;
+    int clockTimestamps;    /* Are status timestamps on the clock of PaUtil_GetTime, rather than the wall clock? */
 } PaAlsaStreamComponent;
 
+/* An entry in the pool of configured pcms that are kept open after closing a stream, see PaAlsa_SetPcmPoolSize.
+ * The entry is keyed on the parameters the stream was opened with, since these determine the configuration.
+ */
+typedef struct PaAlsaPcmPoolEntry
+{
+    int hasInput, hasOutput;
+    PaStreamParameters inParams, outParams;
+    double sampleRate;
+    unsigned long framesPerUserBuffer;
+    int numPeriods;
+    int callbackMode;
+    int primeBuffers;
+
+    int configured;     /* Have the pcms been configured according to the above */
+    PaAlsaStreamComponent capture, playback;
+    double realSampleRate;
+    PaTime inputLatency, outputLatency;
+    unsigned long maxFramesPerHostBuffer;
+    PaUtilHostBufferSizeMode hostBufferSizeMode;
+    int pcmsSynced;
+
+    struct PaAlsaPcmPoolEntry *next;
+} PaAlsaPcmPoolEntry;
+
 /* Implementation specific stream structure */
 typedef struct PaAlsaStream
 {
@@ -638,11 +709,21 @@ typedef struct PaAlsaStream
     int callbackMode;              /* bool: are we running in callback mode? */
     int pcmsSynced;                /* Have we successfully synced pcms */
     int rtSched;
+    int customScheduling;          /* Has PaAlsa_SetStreamScheduling been called? */
+    PaAlsaThreadScheduling scheduling;
 
     /* the callback thread uses these to poll the sound device(s), waiting
      * for data to be ready/available */
     struct pollfd* pfds;
-    int pollTimeout;
+    unsigned long pollTimeout;  /* In frames */
+
+    /* Unless epollFd is -1 the pcms' poll descriptors are registered with it for the lifetime of the stream,
+     * see PaAlsaStream_SetUpEpoll. The timer descriptor implements the poll timeout. */
+    int epollFd;
+    int timerFd;
+    struct epoll_event *epollEvents;
+    int captureArmed, playbackArmed;    /* Are the components' descriptors enabled in the epoll set */
+    int epollStale;                     /* Set when a pcm is prepared, its descriptors must be queried again */
 
     /* Used in communication between threads */
     volatile sig_atomic_t callback_finished; /* bool: are we in the "callback finished" state? */
@@ -651,11 +732,29 @@ typedef struct PaAlsaStream
     PaUnixMutex stateMtx;                   /* Used to synchronize access to stream state */
 
     int neverDropInput;
+    int lockMemory;                 /* bool: was the stream opened with paLockStreamMemory? */
 
     PaTime underrun;
     PaTime overrun;
 
+    /* Xrun statistics, only written by the thread handling xruns. The sequence number is odd while an update is in
+     * progress, so that PaAlsa_GetStreamXrunInfo can read consistently without locking. */
+    volatile unsigned long xrunInfoSequence;
+    PaAlsaXrunInfo xrunInfo;
+
+    /* Clock drift compensation for unlinked full-duplex, see PaAlsaStream_CompensateDrift */
+    int driftSettleCount;
+    double driftBaseline, driftLevel;
+    unsigned long driftFramesSkipped, driftFramesRepeated;
+
+    /* Set by PaAlsa_InvalidateStreamOutput, for the callback thread to rewind output */
+    volatile sig_atomic_t rewindRequested;
+    volatile unsigned long rewindSafetyFrames;
+
     PaAlsaStreamComponent capture, playback;
+
+    PaAlsaPcmPoolEntry *poolEntry;  /* Non-NULL if the pcms are to be returned to the pool when closing */
+    int pooled;                     /* Are the pcms taken from the pool, i.e. already configured */
 }
 PaAlsaStream;
 
@@ -671,6 +770,19 @@ typedef struct PaAlsaHostApiRepresentation
 
     PaHostApiIndex hostApiIndex;
     PaUint32 alsaLibVersion; /* Retrieved from the library at run-time */
+
+    /* The ids of the cards present when the device list was last built or refreshed, empty for absent cards */
+    char cardIds[PA_ALSA_MAX_CARDS][PA_ALSA_CARD_ID_SIZE];
+    /* Placeholder devices left at the end of the device list, see PA_ALSA_RESERVED_DEVICES */
+    int reservedDevices;
+
+    /* Device change monitoring, see PaAlsa_SetDeviceChangeCallback */
+    PaAlsaDeviceChangeCallback *deviceChangeCallback;
+    void *deviceChangeUserData;
+    int monitorRunning;
+    pthread_t monitorThread;
+    int monitorInotifyFd;
+    int monitorWakeFds[2];  /* Written to in order to stop the monitor thread */
 }
 PaAlsaHostApiRepresentation;
 
@@ -709,6 +821,8 @@ static PaError IsStreamActive( PaStream *stream );
 static PaTime GetStreamTime( PaStream *stream );
 static double GetStreamCpuLoad( PaStream* stream );
 static PaError BuildDeviceList( PaAlsaHostApiRepresentation *hostApi );
+static void TrimPcmPool( int maxEntries );
+static void StopDeviceMonitor( PaAlsaHostApiRepresentation *alsaApi );
 static int SetApproximateSampleRate( snd_pcm_t *pcm, snd_pcm_hw_params_t *hwParams, double sampleRate );
 static int GetExactSampleRate( snd_pcm_hw_params_t *hwParams, double *sampleRate );
 static PaUint32 PaAlsaVersionNum(void);
@@ -744,11 +858,14 @@ PaError PaAlsa_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
     if (!PaAlsa_LoadLibrary())
         return paHostApiNotFound;
 
-    PA_UNLESS( alsaHostApi = (PaAlsaHostApiRepresentation*) PaUtil_AllocateMemory(
-                sizeof(PaAlsaHostApiRepresentation) ), paInsufficientMemory );
-    PA_UNLESS( alsaHostApi->allocations = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+    PA_UNLESS( alsaHostApi = (PaAlsaHostApiRepresentation*) PaUtil_AllocateTaggedMemory(
+                sizeof(PaAlsaHostApiRepresentation), paMemoryDeviceInfo ), paInsufficientMemory );
+    memset( alsaHostApi, 0, sizeof (PaAlsaHostApiRepresentation) );
+    PA_UNLESS( alsaHostApi->allocations = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo ), paInsufficientMemory );
     alsaHostApi->hostApiIndex = hostApiIndex;
     alsaHostApi->alsaLibVersion = PaAlsaVersionNum();
+    alsaHostApi->monitorInotifyFd = -1;
+    alsaHostApi->monitorWakeFds[0] = alsaHostApi->monitorWakeFds[1] = -1;
 
     *hostApi = (PaUtilHostApiRepresentation*)alsaHostApi;
     (*hostApi)->info.structVersion = 1;
@@ -813,12 +930,17 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
     */
     /*snd_lib_error_set_handler(NULL);*/
 
+    StopDeviceMonitor( alsaHostApi );
+
     if( alsaHostApi->allocations )
     {
         PaUtil_FreeAllAllocations( alsaHostApi->allocations );
         PaUtil_DestroyAllocationGroup( alsaHostApi->allocations );
     }
 
+    /* Device indices are invalidated, close any pooled pcms */
+    TrimPcmPool( 0 );
+
     PaUtil_FreeMemory( alsaHostApi );
     alsa_snd_config_update_free_global();
 
@@ -1114,6 +1236,85 @@ static int OpenPcm( snd_pcm_t **pcmp, const char *name, snd_pcm_stream_t stream,
     return ret;
 }
 
+/** Does the host API specific stream info describe an aggregate device.
+ *
+ */
+static int IsAggregateStreamInfo( const PaAlsaStreamInfo *streamInfo )
+{
+    return streamInfo->version >= 2 && streamInfo->aggregateDeviceCount > 0;
+}
+
+/** Open several PCM devices as one, with their channels laid out contiguously.
+ *
+ * A configuration is composed for ALSA's multi plugin, which links the member devices so that they start and stop
+ * in sync, wrapped in a plug so that the members may differ in their native formats.
+ * @return The same as snd_pcm_open.
+ */
+static int OpenAggregatePcm( snd_pcm_t **pcmp, const PaAlsaStreamInfo *streamInfo, snd_pcm_stream_t stream, int mode )
+{
+    int ret = 0;
+    unsigned long i;
+    int j, channel = 0, totalChannels = 0;
+    size_t configSize = 256, len = 0;
+    char *config = NULL;
+    snd_input_t *input = NULL;
+    snd_config_t *top = NULL;
+
+    *pcmp = NULL;
+
+    for( i = 0; i < streamInfo->aggregateDeviceCount; ++i )
+    {
+        const char *member = streamInfo->aggregateDeviceStrings[i];
+        /* Device strings are quoted in the configuration */
+        if( strchr( member, '"' ) || strchr( member, '\\' ) )
+            return -EINVAL;
+        configSize += strlen( member ) + 64;
+        totalChannels += streamInfo->aggregateChannelCounts[i];
+    }
+    configSize += totalChannels * 48;
+
+    if( !(config = (char *)PaUtil_AllocateMemory( configSize )) )
+        return -ENOMEM;
+
+    len += snprintf( config + len, configSize - len, "pcm.paAggregate { type plug slave.pcm { type multi slaves {" );
+    for( i = 0; i < streamInfo->aggregateDeviceCount; ++i )
+    {
+        len += snprintf( config + len, configSize - len, " s%lu { pcm \"%s\" channels %d }", i,
+                streamInfo->aggregateDeviceStrings[i], streamInfo->aggregateChannelCounts[i] );
+    }
+    len += snprintf( config + len, configSize - len, " } bindings {" );
+    for( i = 0; i < streamInfo->aggregateDeviceCount; ++i )
+    {
+        for( j = 0; j < streamInfo->aggregateChannelCounts[i]; ++j )
+            len += snprintf( config + len, configSize - len, " %d { slave s%lu channel %d }", channel++, i, j );
+    }
+    len += snprintf( config + len, configSize - len, " } } }" );
+    assert( len < configSize );
+    PA_DEBUG(( "%s: Aggregate configuration: %s\n", __FUNCTION__, config ));
+
+    if( (ret = alsa_snd_config_top( &top )) < 0 )
+        goto end;
+    if( (ret = alsa_snd_input_buffer_open( &input, config, len )) < 0 )
+        goto end;
+    if( (ret = alsa_snd_config_load( top, input )) < 0 )
+        goto end;
+    ret = alsa_snd_pcm_open_lconf( pcmp, "paAggregate", stream, mode, top );
+
+end:
+    if( input )
+        alsa_snd_input_close( input );
+    if( top )
+        alsa_snd_config_delete( top );
+    PaUtil_FreeMemory( config );
+
+    if( ret < 0 )
+    {
+        PA_DEBUG(( "%s: Failed to open aggregate device: %s\n", __FUNCTION__, alsa_snd_strerror( ret ) ));
+    }
+
+    return ret;
+}
+
 static PaError FillInDevInfo( PaAlsaHostApiRepresentation *alsaApi, HwDevInfo* deviceName, int blocking,
         PaAlsaDeviceInfo* devInfo, int* devIdx )
 {
@@ -1191,21 +1392,139 @@ end:
     return result;
 }
 
+/* Make devInfo a placeholder, taking up a device index for a device that may be added later */
+static void InitializeReservedDevice( PaAlsaHostApiRepresentation *alsaApi, PaAlsaDeviceInfo *devInfo )
+{
+    InitializeDeviceInfo( &devInfo->baseDeviceInfo );
+    devInfo->baseDeviceInfo.structVersion = 2;
+    devInfo->baseDeviceInfo.hostApi = alsaApi->hostApiIndex;
+    devInfo->baseDeviceInfo.name = "(reserved)";
+    devInfo->alsaName = "";
+    devInfo->isPlug = 1;
+    devInfo->minInputChannels = devInfo->minOutputChannels = 0;
+}
+
+/* Obtain the id of card cardIdx, cardId is left empty if the card can't be opened */
+static void GetCardId( int cardIdx, char cardId[PA_ALSA_CARD_ID_SIZE] )
+{
+    snd_ctl_t *ctl;
+    snd_ctl_card_info_t *cardInfo;
+    char alsaCardName[50];
+
+    cardId[0] = '\0';
+    snprintf( alsaCardName, sizeof (alsaCardName), "hw:%d", cardIdx );
+    if( alsa_snd_ctl_open( &ctl, alsaCardName, 0 ) < 0 )
+        return;
+
+    alsa_snd_ctl_card_info_alloca( &cardInfo );
+    if( alsa_snd_ctl_card_info( ctl, cardInfo ) >= 0 )
+    {
+        snprintf( cardId, PA_ALSA_CARD_ID_SIZE, "%s", alsa_snd_ctl_card_info_get_id( cardInfo ) );
+    }
+    alsa_snd_ctl_close( ctl );
+}
+
+/* Append the pcm devices of card cardIdx to hwDevInfos, which is grown as needed */
+static PaError GatherCardDevices( PaAlsaHostApiRepresentation *alsaApi, int cardIdx, HwDevInfo **hwDevInfos,
+        size_t *numDeviceNames, size_t *maxDeviceNames )
+{
+    PaError result = paNoError;
+    snd_ctl_card_info_t *cardInfo;
+    snd_pcm_info_t *pcmInfo;
+    char *cardName;
+    int devIdx = -1;
+    snd_ctl_t *ctl = NULL;
+    char alsaCardName[50];
+    char buf[50];
+
+    alsa_snd_ctl_card_info_alloca( &cardInfo );
+    alsa_snd_pcm_info_alloca( &pcmInfo );
+
+    snprintf( alsaCardName, sizeof (alsaCardName), "hw:%d", cardIdx );
+
+    /* Acquire name of card */
+    if( alsa_snd_ctl_open( &ctl, alsaCardName, 0 ) < 0 )
+    {
+        /* Unable to open card :( */
+        PA_DEBUG(( "%s: Unable to open device %s\n", __FUNCTION__, alsaCardName ));
+        return paNoError;
+    }
+    alsa_snd_ctl_card_info( ctl, cardInfo );
+
+    PA_ENSURE( PaAlsa_StrDup( alsaApi, &cardName, alsa_snd_ctl_card_info_get_name( cardInfo )) );
+
+    while( alsa_snd_ctl_pcm_next_device( ctl, &devIdx ) == 0 && devIdx >= 0 )
+    {
+        char *alsaDeviceName, *deviceName;
+        size_t len;
+        int hasPlayback = 0, hasCapture = 0;
+        snprintf( buf, sizeof (buf), "hw:%d,%d", cardIdx, devIdx );
+
+        /* Obtain info about this particular device */
+        alsa_snd_pcm_info_set_device( pcmInfo, devIdx );
+        alsa_snd_pcm_info_set_subdevice( pcmInfo, 0 );
+        alsa_snd_pcm_info_set_stream( pcmInfo, SND_PCM_STREAM_CAPTURE );
+        if( alsa_snd_ctl_pcm_info( ctl, pcmInfo ) >= 0 )
+        {
+            hasCapture = 1;
+        }
+
+        alsa_snd_pcm_info_set_stream( pcmInfo, SND_PCM_STREAM_PLAYBACK );
+        if( alsa_snd_ctl_pcm_info( ctl, pcmInfo ) >= 0 )
+        {
+            hasPlayback = 1;
+        }
+
+        if( !hasPlayback && !hasCapture )
+        {
+            /* Error */
+            continue;
+        }
+
+        /* The length of the string written by snprintf plus terminating 0 */
+        len = snprintf( NULL, 0, "%s: %s (%s)", cardName, alsa_snd_pcm_info_get_name( pcmInfo ), buf ) + 1;
+        PA_UNLESS( deviceName = (char *)PaUtil_GroupAllocateMemory( alsaApi->allocations, len ),
+                paInsufficientMemory );
+        snprintf( deviceName, len, "%s: %s (%s)", cardName,
+                alsa_snd_pcm_info_get_name( pcmInfo ), buf );
+
+        ++(*numDeviceNames);
+        if( !*hwDevInfos || *numDeviceNames > *maxDeviceNames )
+        {
+            *maxDeviceNames *= 2;
+            PA_UNLESS( *hwDevInfos = (HwDevInfo *) realloc( *hwDevInfos, *maxDeviceNames * sizeof (HwDevInfo) ),
+                    paInsufficientMemory );
+        }
+
+        PA_ENSURE( PaAlsa_StrDup( alsaApi, &alsaDeviceName, buf ) );
+
+        (*hwDevInfos)[ *numDeviceNames - 1 ].alsaName = alsaDeviceName;
+        (*hwDevInfos)[ *numDeviceNames - 1 ].name = deviceName;
+        (*hwDevInfos)[ *numDeviceNames - 1 ].isPlug = 0;
+        (*hwDevInfos)[ *numDeviceNames - 1 ].hasPlayback = hasPlayback;
+        (*hwDevInfos)[ *numDeviceNames - 1 ].hasCapture = hasCapture;
+    }
+
+end:
+    alsa_snd_ctl_close( ctl );
+    return result;
+
+error:
+    goto end;
+}
+
 /* Build PaDeviceInfo list, ignore devices for which we cannot determine capabilities (possibly busy, sigh) */
 static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi )
 {
     PaUtilHostApiRepresentation *baseApi = &alsaApi->baseHostApiRep;
     PaAlsaDeviceInfo *deviceInfoArray;
     int cardIdx = -1, devIdx = 0;
-    snd_ctl_card_info_t *cardInfo;
     PaError result = paNoError;
     size_t numDeviceNames = 0, maxDeviceNames = 1, i;
     HwDevInfo *hwDevInfos = NULL;
     snd_config_t *topNode = NULL;
-    snd_pcm_info_t *pcmInfo;
-    int res;
+    int res, reservedDevices = 0;
     int blocking = SND_PCM_NONBLOCK;
-    char alsaCardName[50];
 #ifdef PA_ENABLE_DEBUG_OUTPUT
     PaTime startTime = PaUtil_GetTime();
 #endif
@@ -1226,80 +1545,11 @@ static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi )
      *
      * The function itself returns 0 if it succeeded. */
     cardIdx = -1;
-    alsa_snd_ctl_card_info_alloca( &cardInfo );
-    alsa_snd_pcm_info_alloca( &pcmInfo );
     while( alsa_snd_card_next( &cardIdx ) == 0 && cardIdx >= 0 )
     {
-        char *cardName;
-        int devIdx = -1;
-        snd_ctl_t *ctl;
-        char buf[50];
-
-        snprintf( alsaCardName, sizeof (alsaCardName), "hw:%d", cardIdx );
-
-        /* Acquire name of card */
-        if( alsa_snd_ctl_open( &ctl, alsaCardName, 0 ) < 0 )
-        {
-            /* Unable to open card :( */
-            PA_DEBUG(( "%s: Unable to open device %s\n", __FUNCTION__, alsaCardName ));
-            continue;
-        }
-        alsa_snd_ctl_card_info( ctl, cardInfo );
-
-        PA_ENSURE( PaAlsa_StrDup( alsaApi, &cardName, alsa_snd_ctl_card_info_get_name( cardInfo )) );
-
-        while( alsa_snd_ctl_pcm_next_device( ctl, &devIdx ) == 0 && devIdx >= 0 )
-        {
-            char *alsaDeviceName, *deviceName;
-            size_t len;
-            int hasPlayback = 0, hasCapture = 0;
-            snprintf( buf, sizeof (buf), "hw:%d,%d", cardIdx, devIdx );
-
-            /* Obtain info about this particular device */
-            alsa_snd_pcm_info_set_device( pcmInfo, devIdx );
-            alsa_snd_pcm_info_set_subdevice( pcmInfo, 0 );
-            alsa_snd_pcm_info_set_stream( pcmInfo, SND_PCM_STREAM_CAPTURE );
-            if( alsa_snd_ctl_pcm_info( ctl, pcmInfo ) >= 0 )
-            {
-                hasCapture = 1;
-            }
-
-            alsa_snd_pcm_info_set_stream( pcmInfo, SND_PCM_STREAM_PLAYBACK );
-            if( alsa_snd_ctl_pcm_info( ctl, pcmInfo ) >= 0 )
-            {
-                hasPlayback = 1;
-            }
-
-            if( !hasPlayback && !hasCapture )
-            {
-                /* Error */
-                continue;
-            }
-
-            /* The length of the string written by snprintf plus terminating 0 */
-            len = snprintf( NULL, 0, "%s: %s (%s)", cardName, alsa_snd_pcm_info_get_name( pcmInfo ), buf ) + 1;
-            PA_UNLESS( deviceName = (char *)PaUtil_GroupAllocateMemory( alsaApi->allocations, len ),
-                    paInsufficientMemory );
-            snprintf( deviceName, len, "%s: %s (%s)", cardName,
-                    alsa_snd_pcm_info_get_name( pcmInfo ), buf );
-
-            ++numDeviceNames;
-            if( !hwDevInfos || numDeviceNames > maxDeviceNames )
-            {
-                maxDeviceNames *= 2;
-                PA_UNLESS( hwDevInfos = (HwDevInfo *) realloc( hwDevInfos, maxDeviceNames * sizeof (HwDevInfo) ),
-                        paInsufficientMemory );
-            }
-
-            PA_ENSURE( PaAlsa_StrDup( alsaApi, &alsaDeviceName, buf ) );
-
-            hwDevInfos[ numDeviceNames - 1 ].alsaName = alsaDeviceName;
-            hwDevInfos[ numDeviceNames - 1 ].name = deviceName;
-            hwDevInfos[ numDeviceNames - 1 ].isPlug = 0;
-            hwDevInfos[ numDeviceNames - 1 ].hasPlayback = hasPlayback;
-            hwDevInfos[ numDeviceNames - 1 ].hasCapture = hasCapture;
-        }
-        alsa_snd_ctl_close( ctl );
+        if( cardIdx < PA_ALSA_MAX_CARDS )
+            GetCardId( cardIdx, alsaApi->cardIds[cardIdx] );
+        PA_ENSURE( GatherCardDevices( alsaApi, cardIdx, &hwDevInfos, &numDeviceNames, &maxDeviceNames ) );
     }
 
     /* Iterate over plugin devices */
@@ -1378,9 +1628,12 @@ static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi )
     else
         PA_DEBUG(( "%s: Iterating over ALSA plugins failed: %s\n", __FUNCTION__, alsa_snd_strerror( res ) ));
 
+    if( getenv( "PA_ALSA_RESERVED_DEVICES" ) )
+        reservedDevices = PA_MAX( atoi( getenv( "PA_ALSA_RESERVED_DEVICES" ) ), 0 );
+
     /* allocate deviceInfo memory based on the number of devices */
     PA_UNLESS( baseApi->deviceInfos = (PaDeviceInfo**)PaUtil_GroupAllocateMemory(
-            alsaApi->allocations, sizeof(PaDeviceInfo*) * (numDeviceNames) ), paInsufficientMemory );
+            alsaApi->allocations, sizeof(PaDeviceInfo*) * (numDeviceNames + reservedDevices) ), paInsufficientMemory );
 
     /* allocate all device info structs in a contiguous block */
     PA_UNLESS( deviceInfoArray = (PaAlsaDeviceInfo*)PaUtil_GroupAllocateMemory(
@@ -1421,6 +1674,21 @@ static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi )
     }
     free( hwDevInfos );
 
+    /* Keep index space for devices added by PaAlsa_RefreshDeviceList, so that the indices of other host APIs'
+     * devices don't change */
+    if( reservedDevices > 0 )
+    {
+        PaAlsaDeviceInfo *reservedArray;
+        PA_UNLESS( reservedArray = (PaAlsaDeviceInfo*)PaUtil_GroupAllocateMemory(
+                alsaApi->allocations, sizeof(PaAlsaDeviceInfo) * reservedDevices ), paInsufficientMemory );
+        for( i = 0; i < (size_t)reservedDevices; ++i )
+        {
+            InitializeReservedDevice( alsaApi, &reservedArray[i] );
+            baseApi->deviceInfos[devIdx++] = (PaDeviceInfo *) &reservedArray[i];
+        }
+        alsaApi->reservedDevices = reservedDevices;
+    }
+
     baseApi->info.deviceCount = devIdx;   /* Number of successfully queried devices */
 
 #ifdef PA_ENABLE_DEBUG_OUTPUT
@@ -1435,6 +1703,338 @@ error:
     goto end;
 }
 
+/* Is devInfo a hw device of card cardIdx */
+static int IsCardDevice( const PaAlsaDeviceInfo *devInfo, int cardIdx )
+{
+    int card, device;
+
+    if( devInfo->isPlug || sscanf( devInfo->alsaName, "hw:%d,%d", &card, &device ) != 2 )
+        return 0;
+    return card == cardIdx;
+}
+
+/* The card of hw device devInfo, or -1 if it isn't one */
+static int GetDeviceCard( const PaAlsaDeviceInfo *devInfo )
+{
+    int card, device;
+
+    if( devInfo->isPlug || sscanf( devInfo->alsaName, "hw:%d,%d", &card, &device ) != 2 )
+        return -1;
+    return card;
+}
+
+/* Copy the device list into alsaApi->allocations, leaving room for extraDevices more, so that the group it was
+ * built in can be freed */
+static PaError CopyDeviceList( PaAlsaHostApiRepresentation *alsaApi, size_t extraDevices )
+{
+    PaUtilHostApiRepresentation *baseApi = &alsaApi->baseHostApiRep;
+    PaError result = paNoError;
+    PaDeviceInfo **deviceInfos;
+    PaAlsaDeviceInfo *deviceInfoArray = NULL;
+    int i, numDevices = baseApi->info.deviceCount;
+    char *name;
+
+    PA_UNLESS( deviceInfos = (PaDeviceInfo **)PaUtil_GroupAllocateMemory( alsaApi->allocations,
+                sizeof(PaDeviceInfo *) * (numDevices + extraDevices + 1) ), paInsufficientMemory );
+    if( numDevices > 0 )
+    {
+        PA_UNLESS( deviceInfoArray = (PaAlsaDeviceInfo *)PaUtil_GroupAllocateMemory( alsaApi->allocations,
+                    sizeof(PaAlsaDeviceInfo) * numDevices ), paInsufficientMemory );
+    }
+
+    for( i = 0; i < numDevices; ++i )
+    {
+        PaAlsaDeviceInfo *devInfo = &deviceInfoArray[i];
+
+        *devInfo = *(PaAlsaDeviceInfo *)baseApi->deviceInfos[i];
+        PA_ENSURE( PaAlsa_StrDup( alsaApi, &name, devInfo->baseDeviceInfo.name ) );
+        devInfo->baseDeviceInfo.name = name;
+        PA_ENSURE( PaAlsa_StrDup( alsaApi, &devInfo->alsaName, devInfo->alsaName ) );
+        deviceInfos[i] = (PaDeviceInfo *)devInfo;
+    }
+    baseApi->deviceInfos = deviceInfos;
+
+error:
+    return result;
+}
+
+/* Pick the default devices among the first numDevices of the list by the rule FillInDevInfo applies while
+ * building it: the first device with channels in that direction, unless the ALSA "default" device has some */
+static void SelectDefaultDevices( PaAlsaHostApiRepresentation *alsaApi, int numDevices )
+{
+    PaUtilHostApiRepresentation *baseApi = &alsaApi->baseHostApiRep;
+    PaDeviceIndex baseDeviceIndex = baseApi->privatePaFrontInfo.baseDeviceIndex;
+    int devIdx;
+
+    baseApi->info.defaultInputDevice = paNoDevice;
+    baseApi->info.defaultOutputDevice = paNoDevice;
+    for( devIdx = 0; devIdx < numDevices; ++devIdx )
+    {
+        const PaAlsaDeviceInfo *devInfo = (const PaAlsaDeviceInfo *)baseApi->deviceInfos[devIdx];
+        int isDefault = !strcmp( devInfo->alsaName, "default" );
+
+        if( ( baseApi->info.defaultInputDevice == paNoDevice || isDefault ) &&
+                devInfo->baseDeviceInfo.maxInputChannels > 0 )
+            baseApi->info.defaultInputDevice = baseDeviceIndex + devIdx;
+        if( ( baseApi->info.defaultOutputDevice == paNoDevice || isDefault ) &&
+                devInfo->baseDeviceInfo.maxOutputChannels > 0 )
+            baseApi->info.defaultOutputDevice = baseDeviceIndex + devIdx;
+    }
+    PA_DEBUG(( "%s: Default input device: %d, default output device: %d\n", __FUNCTION__,
+                baseApi->info.defaultInputDevice, baseApi->info.defaultOutputDevice ));
+}
+
+/* Re-probe the cards that were added, removed or replaced since the device list was last built or refreshed.
+ *
+ * Existing device indices remain valid: the devices of removed cards are kept with zero channels, a device
+ * reappearing under the same name is probed in place and new devices take the place of reserved devices (see
+ * PA_ALSA_RESERVED_DEVICES), or are appended once none are left. The list is rebuilt in a new allocation group and
+ * the previous group is freed, so memory doesn't grow with every change.
+ */
+static PaError RefreshDeviceList( PaAlsaHostApiRepresentation *alsaApi, int *devicesChanged )
+{
+    PaUtilHostApiRepresentation *baseApi = &alsaApi->baseHostApiRep;
+    PaError result = paNoError;
+    char cardIds[PA_ALSA_MAX_CARDS][PA_ALSA_CARD_ID_SIZE];
+    int cardChanged[PA_ALSA_MAX_CARDS];
+    HwDevInfo *hwDevInfos = NULL;
+    PaUtilAllocationGroup *previousAllocations = alsaApi->allocations;
+    PaDeviceInfo **previousDeviceInfos = baseApi->deviceInfos;
+    int previousReservedDevices = alsaApi->reservedDevices;
+    size_t numDeviceNames = 0, maxDeviceNames = 1, i;
+    int cardIdx = -1, devIdx, numDevices = baseApi->info.deviceCount, changed = 0;
+    PaDeviceIndex defaultInputDevice = baseApi->info.defaultInputDevice;
+    PaDeviceIndex defaultOutputDevice = baseApi->info.defaultOutputDevice;
+    int blocking = SND_PCM_NONBLOCK;
+
+    if( getenv( "PA_ALSA_INITIALIZE_BLOCK" ) && atoi( getenv( "PA_ALSA_INITIALIZE_BLOCK" ) ) )
+        blocking = 0;
+
+    memset( cardIds, 0, sizeof (cardIds) );
+    while( alsa_snd_card_next( &cardIdx ) == 0 && cardIdx >= 0 && cardIdx < PA_ALSA_MAX_CARDS )
+    {
+        GetCardId( cardIdx, cardIds[cardIdx] );
+    }
+
+    for( cardIdx = 0; cardIdx < PA_ALSA_MAX_CARDS; ++cardIdx )
+    {
+        cardChanged[cardIdx] = strcmp( cardIds[cardIdx], alsaApi->cardIds[cardIdx] ) != 0;
+        if( cardChanged[cardIdx] )
+        {
+            PA_DEBUG(( "%s: Card %d changed from '%s' to '%s'\n", __FUNCTION__, cardIdx, alsaApi->cardIds[cardIdx],
+                        cardIds[cardIdx] ));
+            changed = 1;
+        }
+    }
+    if( !changed )
+        goto end;
+
+    /* Pooled pcms may refer to removed devices */
+    TrimPcmPool( 0 );
+
+    /* Build the new list in a group of its own */
+    PA_UNLESS( alsaApi->allocations = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo ), paInsufficientMemory );
+
+    for( cardIdx = 0; cardIdx < PA_ALSA_MAX_CARDS; ++cardIdx )
+    {
+        if( cardChanged[cardIdx] && cardIds[cardIdx][0] )
+            PA_ENSURE( GatherCardDevices( alsaApi, cardIdx, &hwDevInfos, &numDeviceNames, &maxDeviceNames ) );
+    }
+
+    PA_ENSURE( CopyDeviceList( alsaApi, numDeviceNames ) );
+
+    /* The devices of the cards that were there before are gone */
+    for( devIdx = 0; devIdx < numDevices; ++devIdx )
+    {
+        PaAlsaDeviceInfo *devInfo = (PaAlsaDeviceInfo *)baseApi->deviceInfos[devIdx];
+        int card = GetDeviceCard( devInfo );
+
+        if( card >= 0 && card < PA_ALSA_MAX_CARDS && cardChanged[card] )
+        {
+            devInfo->baseDeviceInfo.maxInputChannels = devInfo->baseDeviceInfo.maxOutputChannels = 0;
+            devInfo->minInputChannels = devInfo->minOutputChannels = 0;
+        }
+    }
+
+    for( i = 0; i < numDeviceNames; ++i )
+    {
+        HwDevInfo *hwInfo = &hwDevInfos[i];
+        PaAlsaDeviceInfo *devInfo = NULL;
+
+        for( devIdx = 0; devIdx < numDevices; ++devIdx )
+        {
+            if( !strcmp( baseApi->deviceInfos[devIdx]->name, hwInfo->name ) )
+            {
+                devInfo = (PaAlsaDeviceInfo *)baseApi->deviceInfos[devIdx];
+                break;
+            }
+        }
+
+        if( devInfo )
+        {
+            PA_DEBUG(( "%s: Reprobing device %s: %d\n", __FUNCTION__, hwInfo->name, devIdx ));
+            PA_ENSURE( FillInDevInfo( alsaApi, hwInfo, blocking, devInfo, &devIdx ) );
+            /* The device keeps its place even without channels, as do those of removed cards */
+            devInfo->baseDeviceInfo.structVersion = 2;
+            devInfo->baseDeviceInfo.hostApi = alsaApi->hostApiIndex;
+            devInfo->baseDeviceInfo.name = hwInfo->name;
+            devInfo->alsaName = hwInfo->alsaName;
+            devInfo->isPlug = hwInfo->isPlug;
+        }
+        else
+        {
+            /* Reserved devices are at the end of the list, take the first of them if there are any left */
+            int slot = numDevices - alsaApi->reservedDevices, filledSlot = slot;
+
+            PA_UNLESS( devInfo = (PaAlsaDeviceInfo *)PaUtil_GroupAllocateMemory( alsaApi->allocations,
+                        sizeof(PaAlsaDeviceInfo) ), paInsufficientMemory );
+            PA_ENSURE( FillInDevInfo( alsaApi, hwInfo, blocking, devInfo, &filledSlot ) );
+            if( filledSlot == slot )
+            {
+                /* Without channels the device isn't listed, as in BuildDeviceList */
+                continue;
+            }
+
+            if( alsaApi->reservedDevices > 0 )
+                --alsaApi->reservedDevices;
+            else
+                ++numDevices;
+        }
+    }
+
+    /* The previous defaults may have lost their channels and FillInDevInfo only considered the probed devices,
+     * choose among the whole list again (as global indices, which pa_front.c converted the initial ones to) */
+    SelectDefaultDevices( alsaApi, numDevices );
+
+    memcpy( alsaApi->cardIds, cardIds, sizeof (cardIds) );
+
+    PaUtil_FreeAllAllocations( previousAllocations );
+    PaUtil_DestroyAllocationGroup( previousAllocations );
+
+    if( numDevices != baseApi->info.deviceCount )
+    {
+        PA_DEBUG(( "%s: Appended %d devices\n", __FUNCTION__, numDevices - baseApi->info.deviceCount ));
+        baseApi->info.deviceCount = numDevices;
+        PaUtil_HostApiDeviceCountChanged();
+    }
+
+end:
+    free( hwDevInfos );
+    if( devicesChanged )
+        *devicesChanged = changed;
+    return result;
+
+error:
+    /* Keep the previous list */
+    if( alsaApi->allocations != previousAllocations )
+    {
+        if( alsaApi->allocations )
+        {
+            PaUtil_FreeAllAllocations( alsaApi->allocations );
+            PaUtil_DestroyAllocationGroup( alsaApi->allocations );
+        }
+        alsaApi->allocations = previousAllocations;
+    }
+    baseApi->deviceInfos = previousDeviceInfos;
+    alsaApi->reservedDevices = previousReservedDevices;
+    baseApi->info.defaultInputDevice = defaultInputDevice;
+    baseApi->info.defaultOutputDevice = defaultOutputDevice;
+    changed = 0;
+    goto end;
+}
+
+static void *DeviceMonitorThreadFunc( void *userData )
+{
+    PaAlsaHostApiRepresentation *alsaApi = (PaAlsaHostApiRepresentation *)userData;
+    struct pollfd pfds[2];
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    pfds[0].fd = alsaApi->monitorInotifyFd;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = alsaApi->monitorWakeFds[0];
+    pfds[1].events = POLLIN;
+
+    for( ;; )
+    {
+        ssize_t len;
+        char *p;
+
+        if( poll( pfds, 2, -1 ) < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            PA_DEBUG(( "%s: poll failed: %s\n", __FUNCTION__, strerror( errno ) ));
+            break;
+        }
+        if( pfds[1].revents )
+            break;
+        if( !(pfds[0].revents & POLLIN) || (len = read( pfds[0].fd, buf, sizeof (buf) )) <= 0 )
+            continue;
+
+        for( p = buf; p < buf + len; p += sizeof (struct inotify_event) + ((struct inotify_event *)p)->len )
+        {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            int card;
+
+            /* Every card has exactly one control device, the pcm nodes come and go with it */
+            if( event->len > 0 && sscanf( event->name, "controlC%d", &card ) == 1 )
+            {
+                int added = (event->mask & (IN_CREATE | IN_MOVED_TO)) != 0;
+                PA_DEBUG(( "%s: Card %d %s\n", __FUNCTION__, card, added ? "added" : "removed" ));
+                alsaApi->deviceChangeCallback( card, added, alsaApi->deviceChangeUserData );
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static PaError StartDeviceMonitor( PaAlsaHostApiRepresentation *alsaApi )
+{
+    PaError result = paNoError;
+    const char *deviceDir = PA_ALSA_DEVICE_DIR;
+
+    /* Allows monitoring a simulated device tree */
+    if( getenv( "PA_ALSA_DEVICE_DIR" ) )
+        deviceDir = getenv( "PA_ALSA_DEVICE_DIR" );
+
+    PA_UNLESS( (alsaApi->monitorInotifyFd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC )) >= 0, paUnanticipatedHostError );
+    PA_UNLESS( inotify_add_watch( alsaApi->monitorInotifyFd, deviceDir,
+                IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM ) >= 0, paUnanticipatedHostError );
+    PA_UNLESS( pipe( alsaApi->monitorWakeFds ) == 0, paUnanticipatedHostError );
+    PA_ENSURE_SYSTEM( pthread_create( &alsaApi->monitorThread, NULL, DeviceMonitorThreadFunc, alsaApi ), 0 );
+    alsaApi->monitorRunning = 1;
+
+end:
+    return result;
+
+error:
+    StopDeviceMonitor( alsaApi );
+    goto end;
+}
+
+static void StopDeviceMonitor( PaAlsaHostApiRepresentation *alsaApi )
+{
+    if( alsaApi->monitorRunning )
+    {
+        char c = 0;
+        if( write( alsaApi->monitorWakeFds[1], &c, 1 ) != 1 )
+        {
+            PA_DEBUG(( "%s: Failed waking monitor thread\n", __FUNCTION__ ));
+        }
+        pthread_join( alsaApi->monitorThread, NULL );
+        alsaApi->monitorRunning = 0;
+    }
+
+    if( alsaApi->monitorInotifyFd >= 0 )
+        close( alsaApi->monitorInotifyFd );
+    if( alsaApi->monitorWakeFds[0] >= 0 )
+        close( alsaApi->monitorWakeFds[0] );
+    if( alsaApi->monitorWakeFds[1] >= 0 )
+        close( alsaApi->monitorWakeFds[1] );
+    alsaApi->monitorInotifyFd = alsaApi->monitorWakeFds[0] = alsaApi->monitorWakeFds[1] = -1;
+}
+
 /* Check against known device capabilities */
 static PaError ValidateParameters( const PaStreamParameters *parameters, PaUtilHostApiRepresentation *hostApi, StreamDirection mode )
 {
@@ -1454,9 +2054,26 @@ static PaError ValidateParameters( const PaStreamParameters *parameters, PaUtilH
         const PaAlsaStreamInfo *streamInfo = parameters->hostApiSpecificStreamInfo;
 
         PA_UNLESS( parameters->device == paUseHostApiSpecificDeviceSpecification, paInvalidDevice );
-        PA_UNLESS( streamInfo->size == sizeof (PaAlsaStreamInfo) && streamInfo->version == 1,
+        /* Version 1 of the structure ends before the aggregate device description */
+        PA_UNLESS( (streamInfo->size == sizeof (PaAlsaStreamInfo) && streamInfo->version == 2) ||
+                (streamInfo->size == offsetof( PaAlsaStreamInfo, aggregateDeviceCount ) && streamInfo->version == 1),
                 paIncompatibleHostApiSpecificStreamInfo );
-        PA_UNLESS( streamInfo->deviceString != NULL, paInvalidDevice );
+        if( IsAggregateStreamInfo( streamInfo ) )
+        {
+            unsigned long i;
+            int totalChannels = 0;
+
+            PA_UNLESS( streamInfo->aggregateDeviceStrings && streamInfo->aggregateChannelCounts, paInvalidDevice );
+            for( i = 0; i < streamInfo->aggregateDeviceCount; ++i )
+            {
+                PA_UNLESS( streamInfo->aggregateDeviceStrings[i] != NULL, paInvalidDevice );
+                PA_UNLESS( streamInfo->aggregateChannelCounts[i] > 0, paInvalidChannelCount );
+                totalChannels += streamInfo->aggregateChannelCounts[i];
+            }
+            PA_UNLESS( parameters->channelCount <= totalChannels, paInvalidChannelCount );
+        }
+        else
+            PA_UNLESS( streamInfo->deviceString != NULL, paInvalidDevice );
 
         /* Skip further checking */
         return paNoError;
@@ -1692,9 +2309,18 @@ static PaError AlsaOpen( const PaUtilHostApiRepresentation *hostApi, const PaStr
     else
         deviceName = streamInfo->deviceString;
 
-    PA_DEBUG(( "%s: Opening device %s\n", __FUNCTION__, deviceName ));
-    if( (ret = OpenPcm( pcm, deviceName, streamDir == StreamDirection_In ? SND_PCM_STREAM_CAPTURE : SND_PCM_STREAM_PLAYBACK,
-                    SND_PCM_NONBLOCK, 1 )) < 0 )
+    if( streamInfo && IsAggregateStreamInfo( streamInfo ) )
+    {
+        ret = OpenAggregatePcm( pcm, streamInfo, streamDir == StreamDirection_In ? SND_PCM_STREAM_CAPTURE :
+                SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK );
+    }
+    else
+    {
+        PA_DEBUG(( "%s: Opening device %s\n", __FUNCTION__, deviceName ));
+        ret = OpenPcm( pcm, deviceName, streamDir == StreamDirection_In ? SND_PCM_STREAM_CAPTURE : SND_PCM_STREAM_PLAYBACK,
+                SND_PCM_NONBLOCK, 1 );
+    }
+    if( ret < 0 )
     {
         /* Not to be closed */
         *pcm = NULL;
@@ -1853,10 +2479,11 @@ static PaError PaAlsaStreamComponent_Initialize( PaAlsaStreamComponent *self, Pa
     }
     else
     {
+        const PaAlsaStreamInfo *streamInfo = (const PaAlsaStreamInfo *)params->hostApiSpecificStreamInfo;
         /* We're blissfully unaware of the minimum channelCount */
         self->numHostChannels = params->channelCount;
         /* Check if device name does not start with hw: to determine if it is a 'plug' device */
-        if( strncmp( "hw:", ((PaAlsaStreamInfo *)params->hostApiSpecificStreamInfo)->deviceString, 3 ) != 0  )
+        if( IsAggregateStreamInfo( streamInfo ) || strncmp( "hw:", streamInfo->deviceString, 3 ) != 0  )
             self->deviceIsPlug = 1; /* An Alsa plug device, not a direct hw device */
     }
     if( self->deviceIsPlug && alsaApi->alsaLibVersion < ALSA_VERSION_INT( 1, 0, 16 ) )
@@ -1881,7 +2508,7 @@ static PaError PaAlsaStreamComponent_Initialize( PaAlsaStreamComponent *self, Pa
     if( !callbackMode && !self->userInterleaved )
     {
         /* Pre-allocate non-interleaved user provided buffers */
-        PA_UNLESS( self->userBuffers = PaUtil_AllocateMemory( sizeof (void *) * self->numUserChannels ),
+        PA_UNLESS( self->userBuffers = PaUtil_AllocateTaggedMemory( sizeof (void *) * self->numUserChannels, paMemoryHostApiStream ),
                 paInsufficientMemory );
     }
 
@@ -2071,7 +2698,9 @@ static PaError PaAlsaStreamComponent_FinishConfigure( PaAlsaStreamComponent *sel
     /* Now software parameters... */
     ENSURE_( alsa_snd_pcm_sw_params_current( self->pcm, swParams ), paUnanticipatedHostError );
 
-    ENSURE_( alsa_snd_pcm_sw_params_set_start_threshold( self->pcm, swParams, self->framesPerBuffer ), paUnanticipatedHostError );
+    /* When priming, playback must not start before the buffer has been filled, it is started explicitly afterwards */
+    ENSURE_( alsa_snd_pcm_sw_params_set_start_threshold( self->pcm, swParams, primeBuffers && StreamDirection_Out ==
+                self->streamDir ? self->bufferSize : self->framesPerBuffer ), paUnanticipatedHostError );
     ENSURE_( alsa_snd_pcm_sw_params_set_stop_threshold( self->pcm, swParams, self->bufferSize ), paUnanticipatedHostError );
 
     /* Silence buffer in the case of underrun */
@@ -2087,6 +2716,20 @@ static PaError PaAlsaStreamComponent_FinishConfigure( PaAlsaStreamComponent *sel
     ENSURE_( alsa_snd_pcm_sw_params_set_xfer_align( self->pcm, swParams, 1 ), paUnanticipatedHostError );
     ENSURE_( alsa_snd_pcm_sw_params_set_tstamp_mode( self->pcm, swParams, SND_PCM_TSTAMP_ENABLE ), paUnanticipatedHostError );
 
+    /* Stream times and callback time info are derived from the timestamps, put them on the clock of PaUtil_GetTime
+     * so that they don't jump with the wall clock. Older ALSA can only timestamp with gettimeofday. */
+    self->clockTimestamps = 0;
+#if SND_LIB_VERSION >= 0x01001d
+    if( alsa_snd_pcm_sw_params_set_tstamp_type )
+        self->clockTimestamps = alsa_snd_pcm_sw_params_set_tstamp_type( self->pcm, swParams,
+                PaUnixClock_GetSource() == paUnixClockMonotonicRaw ? SND_PCM_TSTAMP_TYPE_MONOTONIC_RAW
+                : SND_PCM_TSTAMP_TYPE_MONOTONIC ) >= 0;
+#endif
+    if( !self->clockTimestamps )
+    {
+        PA_DEBUG(( "%s: Timestamps are on the wall clock\n", __FUNCTION__ ));
+    }
+
     /* Set the parameters! */
     ENSURE_( alsa_snd_pcm_sw_params( self->pcm, swParams ), paUnanticipatedHostError );
 
@@ -2094,6 +2737,137 @@ error:
     return result;
 }
 
+/* Pooled pcms, most recently released first */
+static PaAlsaPcmPoolEntry *pcmPool_ = NULL;
+
+static int PoolParametersMatch( const PaStreamParameters *a, const PaStreamParameters *b )
+{
+    return a->device == b->device && a->channelCount == b->channelCount && a->sampleFormat == b->sampleFormat &&
+        a->suggestedLatency == b->suggestedLatency;
+}
+
+static void PaAlsaPcmPoolEntry_Free( PaAlsaPcmPoolEntry *entry )
+{
+    if( entry->configured )
+    {
+        if( entry->capture.pcm )
+            PaAlsaStreamComponent_Terminate( &entry->capture );
+        if( entry->playback.pcm )
+            PaAlsaStreamComponent_Terminate( &entry->playback );
+    }
+    PaUtil_FreeMemory( entry );
+}
+
+/** Close pooled pcms until at most maxEntries remain, the least recently used are closed first.
+ *
+ */
+static void TrimPcmPool( int maxEntries )
+{
+    PaAlsaPcmPoolEntry **link = &pcmPool_;
+    int i = 0;
+
+    while( *link && i < maxEntries )
+    {
+        link = &(*link)->next;
+        ++i;
+    }
+    while( *link )
+    {
+        PaAlsaPcmPoolEntry *entry = *link;
+        *link = entry->next;
+        PA_DEBUG(( "%s: Closing pooled pcms\n", __FUNCTION__ ));
+        PaAlsaPcmPoolEntry_Free( entry );
+    }
+}
+
+/** Look for pooled pcms matching the stream parameters.
+ *
+ * If a matching entry is found it is removed from the pool and its configured components are handed to the stream.
+ * Otherwise a new entry is allocated for the stream so that its pcms can be returned to the pool when closing.
+ * Streams opened on a device specified through PaAlsaStreamInfo are not pooled.
+ */
+static PaError PaAlsaStream_AcquirePooledPcms( PaAlsaStream *self, const PaStreamParameters *inParams,
+        const PaStreamParameters *outParams, double sampleRate, unsigned long framesPerUserBuffer )
+{
+    PaError result = paNoError;
+    PaAlsaPcmPoolEntry **link;
+    PaAlsaPcmPoolEntry *entry = NULL;
+
+    if( (inParams && inParams->hostApiSpecificStreamInfo) || (outParams && outParams->hostApiSpecificStreamInfo) )
+        goto end;
+
+    for( link = &pcmPool_; *link; link = &(*link)->next )
+    {
+        entry = *link;
+        if( entry->hasInput == (inParams != NULL) && entry->hasOutput == (outParams != NULL) &&
+                (!inParams || PoolParametersMatch( &entry->inParams, inParams )) &&
+                (!outParams || PoolParametersMatch( &entry->outParams, outParams )) &&
+                entry->sampleRate == sampleRate && entry->framesPerUserBuffer == framesPerUserBuffer &&
+                entry->numPeriods == numPeriods_ && entry->callbackMode == self->callbackMode &&
+                entry->primeBuffers == self->primeBuffers )
+        {
+            *link = entry->next;
+            entry->next = NULL;
+
+            PA_DEBUG(( "%s: Reusing pooled pcms\n", __FUNCTION__ ));
+            self->capture = entry->capture;
+            self->playback = entry->playback;
+            self->capture.ready = self->playback.ready = 0;
+            self->poolEntry = entry;
+            self->pooled = 1;
+            goto end;
+        }
+    }
+
+    PA_UNLESS( entry = (PaAlsaPcmPoolEntry*)PaUtil_AllocateTaggedMemory( sizeof (PaAlsaPcmPoolEntry), paMemoryHostApiStream ), paInsufficientMemory );
+    memset( entry, 0, sizeof (PaAlsaPcmPoolEntry) );
+    if( inParams )
+    {
+        entry->hasInput = 1;
+        entry->inParams = *inParams;
+    }
+    if( outParams )
+    {
+        entry->hasOutput = 1;
+        entry->outParams = *outParams;
+    }
+    entry->sampleRate = sampleRate;
+    entry->framesPerUserBuffer = framesPerUserBuffer;
+    entry->numPeriods = numPeriods_;
+    entry->callbackMode = self->callbackMode;
+    entry->primeBuffers = self->primeBuffers;
+    self->poolEntry = entry;
+
+end:
+    return result;
+error:
+    goto end;
+}
+
+/** Hand the stream's pcms back to the pool, instead of closing them.
+ *
+ * The pcms are stopped, but keep their hardware and software parameters.
+ */
+static void PaAlsaStream_ReleasePooledPcms( PaAlsaStream *self )
+{
+    PaAlsaPcmPoolEntry *entry = self->poolEntry;
+
+    assert( entry && entry->configured );
+
+    if( self->capture.pcm )
+        alsa_snd_pcm_drop( self->capture.pcm );
+    if( self->playback.pcm )
+        alsa_snd_pcm_drop( self->playback.pcm );
+
+    entry->capture = self->capture;
+    entry->playback = self->playback;
+    entry->next = pcmPool_;
+    pcmPool_ = entry;
+    self->poolEntry = NULL;
+
+    TrimPcmPool( pcmPoolSize_ );
+}
+
 static PaError PaAlsaStream_Initialize( PaAlsaStream *self, PaAlsaHostApiRepresentation *alsaApi, const PaStreamParameters *inParams,
         const PaStreamParameters *outParams, double sampleRate, unsigned long framesPerUserBuffer, PaStreamCallback callback,
         PaStreamFlags streamFlags, void *userData )
@@ -2102,6 +2876,7 @@ static PaError PaAlsaStream_Initialize( PaAlsaStream *self, PaAlsaHostApiReprese
     assert( self );
 
     memset( self, 0, sizeof( PaAlsaStream ) );
+    self->epollFd = self->timerFd = -1;
 
     if( NULL != callback )
     {
@@ -2119,34 +2894,230 @@ static PaError PaAlsaStream_Initialize( PaAlsaStream *self, PaAlsaHostApiReprese
 
     self->framesPerUserBuffer = framesPerUserBuffer;
     self->neverDropInput = streamFlags & paNeverDropInput;
-    /* XXX: Ignore paPrimeOutputBuffersUsingStreamCallback untill buffer priming is fully supported in pa_process.c */
-    /*
-    if( outParams & streamFlags & paPrimeOutputBuffersUsingStreamCallback )
+    self->lockMemory = (streamFlags & paLockStreamMemory) != 0;
+    /* Output priming is only meaningful when there is a callback to produce the initial output */
+    if( outParams && callback && (streamFlags & paPrimeOutputBuffersUsingStreamCallback) )
         self->primeBuffers = 1;
-        */
     memset( &self->capture, 0, sizeof (PaAlsaStreamComponent) );
     memset( &self->playback, 0, sizeof (PaAlsaStreamComponent) );
-    if( inParams )
+    if( pcmPoolSize_ > 0 )
+        PA_ENSURE( PaAlsaStream_AcquirePooledPcms( self, inParams, outParams, sampleRate, framesPerUserBuffer ) );
+    if( inParams && !self->pooled )
     {
         PA_ENSURE( PaAlsaStreamComponent_Initialize( &self->capture, alsaApi, inParams, StreamDirection_In, NULL != callback ) );
     }
-    if( outParams )
+    if( outParams && !self->pooled )
     {
         PA_ENSURE( PaAlsaStreamComponent_Initialize( &self->playback, alsaApi, outParams, StreamDirection_Out, NULL != callback ) );
     }
 
     assert( self->capture.nfds || self->playback.nfds );
 
-    PA_UNLESS( self->pfds = (struct pollfd*)PaUtil_AllocateMemory( ( self->capture.nfds +
-                    self->playback.nfds ) * sizeof( struct pollfd ) ), paInsufficientMemory );
+    PA_UNLESS( self->pfds = (struct pollfd*)PaUtil_AllocateTaggedMemory( ( self->capture.nfds +
+                    self->playback.nfds ) * sizeof( struct pollfd ), paMemoryHostApiStream ), paInsufficientMemory );
 
     PaUtil_InitializeCpuLoadMeasurer( &self->cpuLoadMeasurer, sampleRate );
+    self->streamRepresentation.cpuLoadMeasurer = &self->cpuLoadMeasurer;
+    self->streamRepresentation.bufferProcessor = &self->bufferProcessor;
     ASSERT_CALL_( PaUnixMutex_Initialize( &self->stateMtx ), paNoError );
 
 error:
     return result;
 }
 
+/** Release the epoll and timer descriptors, after which poll() is used for waiting.
+ *
+ */
+static void PaAlsaStream_TearDownEpoll( PaAlsaStream *self )
+{
+    if( self->epollFd >= 0 )
+        close( self->epollFd );
+    if( self->timerFd >= 0 )
+        close( self->timerFd );
+    self->epollFd = self->timerFd = -1;
+
+    if( self->epollEvents )
+        PaUtil_FreeMemory( self->epollEvents );
+    self->epollEvents = NULL;
+}
+
+/** Register the pcms' poll descriptors with an epoll instance, for the lifetime of the stream.
+ *
+ * Calling poll() makes the kernel set up and tear down the wait on every descriptor for each call, with epoll the
+ * registration persists. The poll timeout is implemented with a timerfd in the same set, which unlike the timeout
+ * of poll() isn't rounded to milliseconds. This is not fatal upon failure, we then fall back to poll().
+ */
+static void PaAlsaStream_SetUpEpoll( PaAlsaStream *self )
+{
+    unsigned int i, totalFds = self->capture.nfds + self->playback.nfds;
+    struct epoll_event event;
+
+    memset( &event, 0, sizeof (event) );
+
+    if( (self->epollFd = epoll_create( totalFds + 1 )) < 0 )
+        goto error;
+    if( (self->timerFd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK )) < 0 )
+        goto error;
+    if( !(self->epollEvents = (struct epoll_event *)PaUtil_AllocateTaggedMemory( (totalFds + 1) * sizeof (struct epoll_event), paMemoryHostApiStream )) )
+        goto error;
+
+    /* Descriptors are laid out in pfds as for poll(), capture first, and identified by their index */
+    if( self->capture.pcm )
+        alsa_snd_pcm_poll_descriptors( self->capture.pcm, self->pfds, self->capture.nfds );
+    if( self->playback.pcm )
+        alsa_snd_pcm_poll_descriptors( self->playback.pcm, self->pfds + self->capture.nfds, self->playback.nfds );
+
+    for( i = 0; i < totalFds; ++i )
+    {
+        event.events = self->pfds[i].events;
+        event.data.u32 = i;
+        if( epoll_ctl( self->epollFd, EPOLL_CTL_ADD, self->pfds[i].fd, &event ) < 0 )
+            goto error;
+    }
+    event.events = EPOLLIN;
+    event.data.u32 = totalFds;
+    if( epoll_ctl( self->epollFd, EPOLL_CTL_ADD, self->timerFd, &event ) < 0 )
+        goto error;
+
+    self->captureArmed = self->capture.pcm != NULL;
+    self->playbackArmed = self->playback.pcm != NULL;
+    self->epollStale = 0;
+
+    return;
+
+error:
+    PA_DEBUG(( "%s: Failed to set up epoll (%s), falling back to poll()\n", __FUNCTION__, strerror( errno ) ));
+    PaAlsaStream_TearDownEpoll( self );
+}
+
+/** Add a component's descriptors to the epoll set or remove them from it.
+ *
+ * The set is level triggered, so the descriptors of a component that is ready but no longer polled must be removed
+ * to avoid spinning while waiting for the other component. Clearing their events wouldn't do, since EPOLLERR and
+ * EPOLLHUP are reported regardless.
+ */
+static int PaAlsaStream_ArmEpoll( PaAlsaStream *self, struct pollfd *pfds, unsigned int nfds, int arm )
+{
+    unsigned int i;
+    struct epoll_event event;
+
+    memset( &event, 0, sizeof (event) );
+
+    for( i = 0; i < nfds; ++i )
+    {
+        event.events = pfds[i].events;
+        event.data.u32 = (pfds - self->pfds) + i;
+        if( epoll_ctl( self->epollFd, arm ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, pfds[i].fd, &event ) < 0 )
+            return -1;
+    }
+
+    return 0;
+}
+
+/** Query the pcms' poll descriptors again and update their registrations in the epoll set.
+ *
+ * A pcm's descriptors, or the events to wait for, can change when it is prepared, i.e. when the stream is started or
+ * recovers from an xrun. This is done only then, rather than before every wait as with poll().
+ */
+static int PaAlsaStream_RefreshEpoll( PaAlsaStream *self )
+{
+    unsigned int i, totalFds = self->capture.nfds + self->playback.nfds;
+    struct pollfd *previous = (struct pollfd *)alloca( totalFds * sizeof (struct pollfd) );
+    struct epoll_event event;
+
+    memcpy( previous, self->pfds, totalFds * sizeof (struct pollfd) );
+    if( self->capture.pcm )
+        alsa_snd_pcm_poll_descriptors( self->capture.pcm, self->pfds, self->capture.nfds );
+    if( self->playback.pcm )
+        alsa_snd_pcm_poll_descriptors( self->playback.pcm, self->pfds + self->capture.nfds, self->playback.nfds );
+
+    memset( &event, 0, sizeof (event) );
+    for( i = 0; i < totalFds; ++i )
+    {
+        int armed = i < self->capture.nfds ? self->captureArmed : self->playbackArmed;
+
+        /* Descriptors of a component that isn't polled aren't in the set, they are added when it is armed again */
+        if( !armed || (self->pfds[i].fd == previous[i].fd && self->pfds[i].events == previous[i].events) )
+            continue;
+
+        event.events = self->pfds[i].events;
+        event.data.u32 = i;
+        if( self->pfds[i].fd != previous[i].fd )
+        {
+            epoll_ctl( self->epollFd, EPOLL_CTL_DEL, previous[i].fd, &event );
+            if( epoll_ctl( self->epollFd, EPOLL_CTL_ADD, self->pfds[i].fd, &event ) < 0 )
+                return -1;
+        }
+        else if( epoll_ctl( self->epollFd, EPOLL_CTL_MOD, self->pfds[i].fd, &event ) < 0 )
+            return -1;
+    }
+
+    self->epollStale = 0;
+    return 0;
+}
+
+/** Wait for events on the pcms being polled, the equivalent of poll() on their descriptors.
+ *
+ * The revents of the stream's pollfds are filled in, for the pcms' interpretation.
+ * @param timeout The time to wait, in frames.
+ * @return The number of descriptors with events, 0 upon timeout, or -1 with errno set.
+ */
+static int PaAlsaStream_EpollWait( PaAlsaStream *self, int pollCapture, int pollPlayback, unsigned long timeout )
+{
+    unsigned int i, totalFds = self->capture.nfds + self->playback.nfds;
+    struct itimerspec timerSpec;
+    double ns = timeout * 1000000000. / self->streamRepresentation.streamInfo.sampleRate;
+    int numEvents, ready = 0;
+
+    if( self->epollStale && PaAlsaStream_RefreshEpoll( self ) < 0 )
+        return -1;
+
+    if( pollCapture != self->captureArmed )
+    {
+        if( PaAlsaStream_ArmEpoll( self, self->pfds, self->capture.nfds, pollCapture ) < 0 )
+            return -1;
+        self->captureArmed = pollCapture;
+    }
+    if( pollPlayback != self->playbackArmed )
+    {
+        if( PaAlsaStream_ArmEpoll( self, self->pfds + self->capture.nfds, self->playback.nfds, pollPlayback ) < 0 )
+            return -1;
+        self->playbackArmed = pollPlayback;
+    }
+
+    /* A zero timer value would disarm the timer rather than expire immediately */
+    memset( &timerSpec, 0, sizeof (timerSpec) );
+    timerSpec.it_value.tv_sec = (time_t)(ns / 1000000000.);
+    timerSpec.it_value.tv_nsec = PA_MAX( (long)(ns - timerSpec.it_value.tv_sec * 1000000000.), 1 );
+    if( timerfd_settime( self->timerFd, 0, &timerSpec, NULL ) < 0 )
+        return -1;
+
+    for( i = 0; i < totalFds; ++i )
+        self->pfds[i].revents = 0;
+
+    if( (numEvents = epoll_wait( self->epollFd, self->epollEvents, totalFds + 1, -1 )) < 0 )
+        return -1;
+
+    for( i = 0; i < (unsigned int)numEvents; ++i )
+    {
+        unsigned int index = self->epollEvents[i].data.u32;
+        if( index == totalFds )
+        {
+            /* Timer expired, consume the expiration */
+            uint64_t expirations;
+            ssize_t ret = read( self->timerFd, &expirations, sizeof (expirations) );
+            (void)ret;
+        }
+        else
+        {
+            self->pfds[index].revents = self->epollEvents[i].events;
+            ++ready;
+        }
+    }
+
+    return ready;
+}
+
 /** Free resources associated with stream, and eventually stream itself.
  *
  * Frees allocated memory, and terminates individual StreamComponents.
@@ -2155,13 +3126,26 @@ static void PaAlsaStream_Terminate( PaAlsaStream *self )
 {
     assert( self );
 
-    if( self->capture.pcm )
+    PaAlsaStream_TearDownEpoll( self );
+
+    if( self->poolEntry && self->poolEntry->configured && pcmPoolSize_ > 0 )
     {
-        PaAlsaStreamComponent_Terminate( &self->capture );
+        PaAlsaStream_ReleasePooledPcms( self );
     }
-    if( self->playback.pcm )
+    else
     {
-        PaAlsaStreamComponent_Terminate( &self->playback );
+        if( self->capture.pcm )
+        {
+            PaAlsaStreamComponent_Terminate( &self->capture );
+        }
+        if( self->playback.pcm )
+        {
+            PaAlsaStreamComponent_Terminate( &self->playback );
+        }
+        if( self->poolEntry )
+        {
+            PaUtil_FreeMemory( self->poolEntry );
+        }
     }
 
     PaUtil_FreeMemory( self->pfds );
@@ -2674,56 +3658,90 @@ static PaError PaAlsaStream_Configure( PaAlsaStream *self, const PaStreamParamet
     alsa_snd_pcm_hw_params_alloca( &hwParamsCapture );
     alsa_snd_pcm_hw_params_alloca( &hwParamsPlayback );
 
-    if( self->capture.pcm )
-        PA_ENSURE( PaAlsaStreamComponent_InitialConfigure( &self->capture, inParams, self->primeBuffers, hwParamsCapture,
-                    &realSr ) );
-    if( self->playback.pcm )
-        PA_ENSURE( PaAlsaStreamComponent_InitialConfigure( &self->playback, outParams, self->primeBuffers, hwParamsPlayback,
-                    &realSr ) );
-
-    PA_ENSURE( PaAlsaStream_DetermineFramesPerBuffer( self, realSr, inParams, outParams, framesPerUserBuffer,
-                hwParamsCapture, hwParamsPlayback, hostBufferSizeMode ) );
-
-    if( self->capture.pcm )
+    if( self->pooled )
     {
-        assert( self->capture.framesPerBuffer != 0 );
-        PA_ENSURE( PaAlsaStreamComponent_FinishConfigure( &self->capture, hwParamsCapture, inParams, self->primeBuffers, realSr,
-                    inputLatency ) );
-        PA_DEBUG(( "%s: Capture period size: %lu, latency: %f\n", __FUNCTION__, self->capture.framesPerBuffer, *inputLatency ));
+        /* The pooled pcms still have their hardware and software parameters set */
+        PaAlsaPcmPoolEntry *entry = self->poolEntry;
+
+        realSr = entry->realSampleRate;
+        *inputLatency = entry->inputLatency;
+        *outputLatency = entry->outputLatency;
+        self->maxFramesPerHostBuffer = entry->maxFramesPerHostBuffer;
+        *hostBufferSizeMode = entry->hostBufferSizeMode;
+        self->pcmsSynced = entry->pcmsSynced;
+        self->streamRepresentation.streamInfo.sampleRate = realSr;
     }
-    if( self->playback.pcm )
+    else
     {
-        assert( self->playback.framesPerBuffer != 0 );
-        PA_ENSURE( PaAlsaStreamComponent_FinishConfigure( &self->playback, hwParamsPlayback, outParams, self->primeBuffers, realSr,
-                    outputLatency ) );
-        PA_DEBUG(( "%s: Playback period size: %lu, latency: %f\n", __FUNCTION__, self->playback.framesPerBuffer, *outputLatency ));
-    }
+        if( self->capture.pcm )
+            PA_ENSURE( PaAlsaStreamComponent_InitialConfigure( &self->capture, inParams, self->primeBuffers, hwParamsCapture,
+                        &realSr ) );
+        if( self->playback.pcm )
+            PA_ENSURE( PaAlsaStreamComponent_InitialConfigure( &self->playback, outParams, self->primeBuffers, hwParamsPlayback,
+                        &realSr ) );
 
-    /* Should be exact now */
-    self->streamRepresentation.streamInfo.sampleRate = realSr;
+        PA_ENSURE( PaAlsaStream_DetermineFramesPerBuffer( self, realSr, inParams, outParams, framesPerUserBuffer,
+                    hwParamsCapture, hwParamsPlayback, hostBufferSizeMode ) );
 
-    /* this will cause the two streams to automatically start/stop/prepare in sync.
-     * We only need to execute these operations on one of the pair.
-     * A: We don't want to do this on a blocking stream.
-     */
-    if( self->callbackMode && self->capture.pcm && self->playback.pcm )
-    {
-        int err = alsa_snd_pcm_link( self->capture.pcm, self->playback.pcm );
-        if( err == 0 )
-            self->pcmsSynced = 1;
-        else
-            PA_DEBUG(( "%s: Unable to sync pcms: %s\n", __FUNCTION__, alsa_snd_strerror( err ) ));
+        if( self->capture.pcm )
+        {
+            assert( self->capture.framesPerBuffer != 0 );
+            PA_ENSURE( PaAlsaStreamComponent_FinishConfigure( &self->capture, hwParamsCapture, inParams, self->primeBuffers, realSr,
+                        inputLatency ) );
+            PA_DEBUG(( "%s: Capture period size: %lu, latency: %f\n", __FUNCTION__, self->capture.framesPerBuffer, *inputLatency ));
+        }
+        if( self->playback.pcm )
+        {
+            assert( self->playback.framesPerBuffer != 0 );
+            PA_ENSURE( PaAlsaStreamComponent_FinishConfigure( &self->playback, hwParamsPlayback, outParams, self->primeBuffers, realSr,
+                        outputLatency ) );
+            PA_DEBUG(( "%s: Playback period size: %lu, latency: %f\n", __FUNCTION__, self->playback.framesPerBuffer, *outputLatency ));
+        }
+
+        /* Should be exact now */
+        self->streamRepresentation.streamInfo.sampleRate = realSr;
+
+        /* this will cause the two streams to automatically start/stop/prepare in sync.
+         * We only need to execute these operations on one of the pair.
+         * A: We don't want to do this on a blocking stream.
+         */
+        if( self->callbackMode && self->capture.pcm && self->playback.pcm )
+        {
+            int err = alsa_snd_pcm_link( self->capture.pcm, self->playback.pcm );
+            if( err == 0 )
+                self->pcmsSynced = 1;
+            else
+            {
+                PA_DEBUG(( "%s: Unable to sync pcms: %s\n", __FUNCTION__, alsa_snd_strerror( err ) ));
+            }
+        }
+
+        if( self->poolEntry )
+        {
+            /* Remember the configuration, so that the pcms may be reused */
+            PaAlsaPcmPoolEntry *entry = self->poolEntry;
+
+            entry->realSampleRate = realSr;
+            entry->inputLatency = *inputLatency;
+            entry->outputLatency = *outputLatency;
+            entry->maxFramesPerHostBuffer = self->maxFramesPerHostBuffer;
+            entry->hostBufferSizeMode = *hostBufferSizeMode;
+            entry->pcmsSynced = self->pcmsSynced;
+            entry->configured = 1;
+        }
     }
 
     {
         unsigned long minFramesPerHostBuffer = PA_MIN( self->capture.pcm ? self->capture.framesPerBuffer : ULONG_MAX,
             self->playback.pcm ? self->playback.framesPerBuffer : ULONG_MAX );
-        self->pollTimeout = CalculatePollTimeout( self, minFramesPerHostBuffer );    /* Period in msecs, rounded up */
+        self->pollTimeout = minFramesPerHostBuffer;
 
         /* Time before watchdog unthrottles realtime thread == 1/4 of period time in msecs */
         /* self->threading.throttledSleepTime = (unsigned long) (minFramesPerHostBuffer / sampleRate / 4 * 1000); */
     }
 
+    PaAlsaStream_SetUpEpoll( self );
+
     if( self->callbackMode )
     {
         /* If the user expects a certain number of frames per callback we will either have to rely on block adaption
@@ -2749,6 +3767,58 @@ error:
     return result;
 }
 
+/** Prefault and lock the memory used by the callback thread, for paLockStreamMemory.
+ *
+ * The non-mmap buffers are otherwise grown on demand from the audio thread, so they are allocated up front for the
+ * whole host buffer.
+ */
+static PaError PaAlsaStreamComponent_LockMemory( PaAlsaStreamComponent *self, unsigned long *lockedSize )
+{
+    PaError result = paNoError;
+
+    if( !self->pcm )
+        goto error;
+
+    if( !self->canMmap )
+    {
+        unsigned int bufferSize = self->numHostChannels * alsa_snd_pcm_format_size( self->nativeFormat, self->bufferSize );
+        if( bufferSize > self->nonMmapBufferSize )
+        {
+            void *buffer;
+            PA_UNLESS( buffer = realloc( self->nonMmapBuffer, bufferSize ), paInsufficientMemory );
+            self->nonMmapBuffer = buffer;
+            self->nonMmapBufferSize = bufferSize;
+        }
+        *lockedSize += PaUtil_LockMemory( self->nonMmapBuffer, self->nonMmapBufferSize );
+    }
+    if( self->userBuffers )
+        *lockedSize += PaUtil_LockMemory( self->userBuffers, sizeof (void *) * self->numUserChannels );
+
+error:
+    return result;
+}
+
+static PaError PaAlsaStream_LockMemory( PaAlsaStream *self )
+{
+    PaError result = paNoError;
+    unsigned long lockedSize = self->bufferProcessor.lockedMemorySize;
+    unsigned int totalFds = self->capture.nfds + self->playback.nfds;
+
+    lockedSize += PaUtil_LockMemory( self, sizeof (PaAlsaStream) );
+    lockedSize += PaUtil_LockMemory( self->pfds, totalFds * sizeof (struct pollfd) );
+    if( self->epollEvents )
+        lockedSize += PaUtil_LockMemory( self->epollEvents, (totalFds + 1) * sizeof (struct epoll_event) );
+
+    PA_ENSURE( PaAlsaStreamComponent_LockMemory( &self->capture, &lockedSize ) );
+    PA_ENSURE( PaAlsaStreamComponent_LockMemory( &self->playback, &lockedSize ) );
+
+    PA_DEBUG(( "%s: Locked %lu bytes of stream memory\n", __FUNCTION__, lockedSize ));
+
+error:
+    self->streamRepresentation.streamInfo.lockedMemorySize = lockedSize;
+    return result;
+}
+
 static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                            PaStream** s,
                            const PaStreamParameters *inputParameters,
@@ -2795,7 +3865,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         framesPerBuffer = atoi( getenv("PA_ALSA_PERIODSIZE") );
     }
 
-    PA_UNLESS( stream = (PaAlsaStream*)PaUtil_AllocateMemory( sizeof(PaAlsaStream) ), paInsufficientMemory );
+    PA_UNLESS( stream = (PaAlsaStream*)PaUtil_AllocateTaggedMemory( sizeof(PaAlsaStream), paMemoryHostApiStream ), paInsufficientMemory );
     PA_ENSURE( PaAlsaStream_Initialize( stream, alsaHostApi, inputParameters, outputParameters, sampleRate,
                 framesPerBuffer, callback, streamFlags, userData ) );
 
@@ -2820,6 +3890,9 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 
     PA_DEBUG(( "%s: Stream: framesPerBuffer = %lu, maxFramesPerHostBuffer = %lu, latency = i(%f)/o(%f), \n", __FUNCTION__, framesPerBuffer, stream->maxFramesPerHostBuffer, stream->streamRepresentation.streamInfo.inputLatency, stream->streamRepresentation.streamInfo.outputLatency));
 
+    if( stream->lockMemory )
+        PA_ENSURE( PaAlsaStream_LockMemory( stream ) );
+
     *s = (PaStream*)stream;
 
     return result;
@@ -2861,8 +3934,9 @@ static void SilenceBuffer( PaAlsaStream *stream )
  *
  * Depending on wether the stream is in callback or blocking mode, we will respectively start or simply
  * prepare the playback pcm. If the buffer has _not_ been primed, we will in callback mode prepare and
- * silence the buffer before starting playback. In blocking mode we simply prepare, as the playback will
- * be started automatically as the user writes to output.
+ * silence the buffer before starting playback. If it has been primed (see PaAlsaStream_PrimeOutput) the
+ * pcm is already prepared and filled, so it is only started. In blocking mode we simply prepare, as the
+ * playback will be started automatically as the user writes to output.
  *
  * The capture pcm, however, will simply be prepared and started.
  */
@@ -2870,6 +3944,13 @@ static PaError AlsaStart( PaAlsaStream *stream, int priming )
 {
     PaError result = paNoError;
 
+    /* Drift is measured relative to the fill level after starting */
+    stream->driftSettleCount = 0;
+    /* The pcms are prepared below */
+    stream->epollStale = 1;
+    /* The application pointer may have been moved by dropping or preparing */
+    stream->playback.silencedFrames = 0;
+
     if( stream->playback.pcm )
     {
         if( stream->callbackMode )
@@ -2880,9 +3961,14 @@ static PaError AlsaStart( PaAlsaStream *stream, int priming )
                 ENSURE_( alsa_snd_pcm_prepare( stream->playback.pcm ), paUnanticipatedHostError );
                 if( stream->playback.canMmap )
                     SilenceBuffer( stream );
+                if( stream->playback.canMmap )
+                    ENSURE_( alsa_snd_pcm_start( stream->playback.pcm ), paUnanticipatedHostError );
             }
-            if( stream->playback.canMmap )
+            else if( alsa_snd_pcm_state( stream->playback.pcm ) == SND_PCM_STATE_PREPARED )
+            {
+                /* The primed buffer is written in full, start playing it */
                 ENSURE_( alsa_snd_pcm_start( stream->playback.pcm ), paUnanticipatedHostError );
+            }
         }
         else
             ENSURE_( alsa_snd_pcm_prepare( stream->playback.pcm ), paUnanticipatedHostError );
@@ -2941,21 +4027,51 @@ error:
 }
 #endif
 
+/* Translate the callback thread scheduling requested by the user */
+static const PaUnixThreadScheduling* GetThreadScheduling( PaAlsaStream* stream, PaUnixThreadScheduling* scheduling )
+{
+    const double sampleRate = stream->streamRepresentation.streamInfo.sampleRate;
+
+    if( !stream->rtSched )
+        return NULL;
+
+    memset( scheduling, 0, sizeof (PaUnixThreadScheduling) );
+    if( !stream->customScheduling )
+    {
+        scheduling->policy = SCHED_FIFO;
+        scheduling->priority = 1;
+        return scheduling;
+    }
+
+    scheduling->policy = stream->scheduling.policy;
+    scheduling->priority = stream->scheduling.priority;
+    scheduling->cpuMask = stream->scheduling.cpuMask;
+    if( scheduling->policy == paAlsaSchedDeadline )
+    {
+        scheduling->period = (unsigned long long)(stream->maxFramesPerHostBuffer * 1e9 / sampleRate);
+        scheduling->runtime = (unsigned long long)(scheduling->period * stream->scheduling.deadlineUtilization);
+    }
+    return scheduling;
+}
+
 static PaError StartStream( PaStream *s )
 {
     PaError result = paNoError;
     PaAlsaStream* stream = (PaAlsaStream*)s;
+    PaUnixThreadScheduling scheduling;
     int streamStarted = 0;  /* So we can know wether we need to take the stream down */
 
     /* Ready the processor */
     PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    PaUtil_ResetBufferProcessorStatistics( &stream->bufferProcessor );
 
     /* Set now, so we can test for activity further down */
     stream->isActive = 1;
 
     if( stream->callbackMode )
     {
-        PA_ENSURE( PaUnixThread_New( &stream->thread, &CallbackThreadFunc, stream, 1., stream->rtSched ) );
+        PA_ENSURE( PaUnixThread_New( &stream->thread, &CallbackThreadFunc, stream, 1.,
+                    GetThreadScheduling( stream, &scheduling ) ) );
     }
     else
     {
@@ -3205,12 +4321,62 @@ static PaError AlsaRestart( PaAlsaStream *stream )
     PA_ENSURE( AlsaStop( stream, 0 ) );
     PA_ENSURE( AlsaStart( stream, 0 ) );
 
-    PA_DEBUG(( "%s: Restarted audio\n", __FUNCTION__ ));
+    PA_DEBUG(( "%s: Restarted audio\n", __FUNCTION__ ));
+
+error:
+    PA_ENSURE( PaUnixMutex_Unlock( &stream->stateMtx ) );
+
+    return result;
+}
+
+/* Start and finish updating the xrun statistics, see PaAlsa_GetStreamXrunInfo */
+static void BeginXrunInfoUpdate( PaAlsaStream *self )
+{
+    ++self->xrunInfoSequence;
+    PaUtil_WriteMemoryBarrier();
+}
+
+static void EndXrunInfoUpdate( PaAlsaStream *self )
+{
+    PaUtil_WriteMemoryBarrier();
+    ++self->xrunInfoSequence;
+}
+
+/* The current time on the clock of a component's status timestamps. That is the wall clock unless clockTimestamps
+ * is set, so the timestamps must be compared with this rather than with PaUtil_GetTime */
+static PaTime PaAlsaStreamComponent_GetTimestampClockTime( const PaAlsaStreamComponent *self )
+{
+    struct timespec now;
+    clockid_t clockId = CLOCK_REALTIME;
+
+    if( self->clockTimestamps )
+    {
+        clockId = CLOCK_MONOTONIC;
+#ifdef CLOCK_MONOTONIC_RAW
+        if( PaUnixClock_GetSource() == paUnixClockMonotonicRaw )
+            clockId = CLOCK_MONOTONIC_RAW;
+#endif
+    }
+    clock_gettime( clockId, &now );
+    return now.tv_sec + (PaTime)now.tv_nsec / 1e9;
+}
 
-error:
-    PA_ENSURE( PaUnixMutex_Unlock( &stream->stateMtx ) );
+/* Account for an xrun in one direction, given the pcm status at detection and the time on the clock of its
+ * timestamps */
+static void RecordXrun( PaAlsaStream *self, PaAlsaXrunDirectionInfo *info, snd_pcm_status_t *st, PaTime now )
+{
+    snd_timestamp_t t;
+    PaTime xrunTime, lost;
 
-    return result;
+    alsa_snd_pcm_status_get_trigger_tstamp( st, &t );
+    xrunTime = t.tv_sec + (PaTime)t.tv_usec / 1e6;
+    lost = ( now - xrunTime ) * self->streamRepresentation.streamInfo.sampleRate;
+
+    ++info->xrunCount;
+    info->lastXrunTime = xrunTime;
+    if( lost > 0 )
+        info->framesLost += (unsigned long)lost;
+    info->lastXrunState = alsa_snd_pcm_status_get_state( st );
 }
 
 /** Recover from xrun state.
@@ -3220,19 +4386,31 @@ static PaError PaAlsaStream_HandleXrun( PaAlsaStream *self )
 {
     PaError result = paNoError;
     snd_pcm_status_t *st;
-    PaTime now = PaUtil_GetTime();
+    PaTime now, restartStart, restartDuration;
     snd_timestamp_t t;
     int restartAlsa = 0; /* do not restart Alsa by default */
 
     alsa_snd_pcm_status_alloca( &st );
 
+    /* Recovery prepares the pcms */
+    self->epollStale = 1;
+    /* The fill level jumps whether or not the pcms are restarted, measure drift from the new one */
+    self->driftSettleCount = 0;
+
+    BeginXrunInfoUpdate( self );
+
     if( self->playback.pcm )
     {
+        self->playback.silencedFrames = 0;
         alsa_snd_pcm_status( self->playback.pcm, st );
         if( alsa_snd_pcm_status_get_state( st ) == SND_PCM_STATE_XRUN )
         {
+            now = PaAlsaStreamComponent_GetTimestampClockTime( &self->playback );
             alsa_snd_pcm_status_get_trigger_tstamp( st, &t );
             self->underrun = now * 1000 - ( (PaTime)t.tv_sec * 1000 + (PaTime)t.tv_usec / 1000 );
+            RecordXrun( self, &self->xrunInfo.output, st, now );
+            PaUtil_TraceEvent( self->bufferProcessor.trace, "playback xrun, %ld us ago",
+                    (long)(self->underrun * 1000), 0, 0, 0 );
 
             if( !self->playback.canMmap )
             {
@@ -3251,8 +4429,12 @@ static PaError PaAlsaStream_HandleXrun( PaAlsaStream *self )
         alsa_snd_pcm_status( self->capture.pcm, st );
         if( alsa_snd_pcm_status_get_state( st ) == SND_PCM_STATE_XRUN )
         {
+            now = PaAlsaStreamComponent_GetTimestampClockTime( &self->capture );
             alsa_snd_pcm_status_get_trigger_tstamp( st, &t );
             self->overrun = now * 1000 - ((PaTime) t.tv_sec * 1000 + (PaTime) t.tv_usec / 1000);
+            RecordXrun( self, &self->xrunInfo.input, st, now );
+            PaUtil_TraceEvent( self->bufferProcessor.trace, "capture xrun, %ld us ago",
+                    (long)(self->overrun * 1000), 0, 0, 0 );
 
             if (!self->capture.canMmap)
             {
@@ -3267,10 +4449,24 @@ static PaError PaAlsaStream_HandleXrun( PaAlsaStream *self )
         }
     }
 
+    /* Restarting may take a while, readers mustn't spin on the sequence meanwhile */
+    EndXrunInfoUpdate( self );
+
     if( restartAlsa )
     {
         PA_DEBUG(( "%s: restarting Alsa to recover from XRUN\n", __FUNCTION__ ));
-        PA_ENSURE( AlsaRestart( self ) );
+        restartStart = PaUtil_GetTime();
+        PaUtil_TraceBegin( self->bufferProcessor.trace, "xrun restart" );
+        result = AlsaRestart( self );
+        PaUtil_TraceEnd( self->bufferProcessor.trace, "xrun restart" );
+        restartDuration = PaUtil_GetTime() - restartStart;
+
+        BeginXrunInfoUpdate( self );
+        ++self->xrunInfo.restartCount;
+        self->xrunInfo.lastRestartDuration = restartDuration;
+        self->xrunInfo.restartTime += restartDuration;
+        EndXrunInfoUpdate( self );
+        PA_ENSURE( result );
     }
 
 end:
@@ -3282,7 +4478,7 @@ error:
 /** Decide if we should continue polling for specified direction, eventually adjust the poll timeout.
  *
  */
-static PaError ContinuePoll( const PaAlsaStream *stream, StreamDirection streamDir, int *pollTimeout, int *continuePoll )
+static PaError ContinuePoll( const PaAlsaStream *stream, StreamDirection streamDir, unsigned long *pollTimeout, int *continuePoll )
 {
     PaError result = paNoError;
     snd_pcm_sframes_t delay, margin;
@@ -3329,8 +4525,8 @@ static PaError ContinuePoll( const PaAlsaStream *stream, StreamDirection streamD
     }
     else if( margin < otherComponent->framesPerBuffer )
     {
-        *pollTimeout = CalculatePollTimeout( stream, margin );
-        PA_DEBUG(( "%s: Trying to poll again for %s frames, pollTimeout: %d\n",
+        *pollTimeout = margin;
+        PA_DEBUG(( "%s: Trying to poll again for %s frames, pollTimeout: %lu\n",
                     __FUNCTION__, StreamDirection_In == streamDir ? "capture" : "playback", *pollTimeout ));
     }
 
@@ -3347,6 +4543,7 @@ static void OnExit( void *data )
     assert( data );
 
     PaUtil_ResetCpuLoadMeasurer( &stream->cpuLoadMeasurer );
+    PaUtil_ReleaseTraceThread( stream->bufferProcessor.trace );
 
     stream->callback_finished = 1;  /* Let the outside world know stream was stopped in callback */
     PA_DEBUG(( "%s: Stopping ALSA handles\n", __FUNCTION__ ));
@@ -3480,54 +4677,105 @@ static unsigned char *ExtractAddress( const snd_pcm_channel_area_t *area, snd_pc
     return (unsigned char *) area->addr + ( area->first + offset * area->step ) / 8;
 }
 
+/* Copy the sample of each frame at src into the following channel. Dedicated loops for the common sample widths
+ * avoid a memcpy call per frame and can be vectorized by the compiler. */
+static void DuplicateInterleavedChannel( unsigned char *src, int swidth, int numHostChannels, int numFrames )
+{
+    int i;
+
+    switch( swidth )
+    {
+    case 2:
+        {
+            PaInt16 *p = (PaInt16 *)src;
+            for( i = 0; i < numFrames; ++i, p += numHostChannels )
+                p[1] = p[0];
+        }
+        break;
+    case 4:
+        {
+            PaInt32 *p = (PaInt32 *)src;
+            for( i = 0; i < numFrames; ++i, p += numHostChannels )
+                p[1] = p[0];
+        }
+        break;
+    default:
+        for( i = 0; i < numFrames; ++i, src += numHostChannels * swidth )
+            memcpy( src + swidth, src, swidth );
+        break;
+    }
+}
+
+/* Zero numChannels consecutive channels of each frame starting at dst, see DuplicateInterleavedChannel */
+static void SilenceInterleavedChannels( unsigned char *dst, int swidth, int numHostChannels, int numChannels,
+        int numFrames )
+{
+    int i, j;
+
+    switch( swidth )
+    {
+    case 2:
+        {
+            PaInt16 *p = (PaInt16 *)dst;
+            for( i = 0; i < numFrames; ++i, p += numHostChannels )
+                for( j = 0; j < numChannels; ++j )
+                    p[j] = 0;
+        }
+        break;
+    case 4:
+        {
+            PaInt32 *p = (PaInt32 *)dst;
+            for( i = 0; i < numFrames; ++i, p += numHostChannels )
+                for( j = 0; j < numChannels; ++j )
+                    p[j] = 0;
+        }
+        break;
+    default:
+        for( i = 0; i < numFrames; ++i, dst += numHostChannels * swidth )
+            memset( dst, 0, swidth * numChannels );
+        break;
+    }
+}
+
 /** Do necessary adaption between user and host channels.
  *
     @concern ChannelAdaption Adapting between user and host channels can involve silencing unused channels and
     duplicating mono information if host outputs come in pairs.
+
+    The buffer processor writes the user channels directly into the mmap area. Nothing else writes the unused
+    channels there, so once every frame of the mmap buffer has been silenced they are left alone and only the mono
+    duplication touches the buffer a second time.
  */
 static PaError PaAlsaStreamComponent_DoChannelAdaption( PaAlsaStreamComponent *self, PaUtilBufferProcessor *bp, int numFrames )
 {
     PaError result = paNoError;
-    unsigned char *p;
-    int i;
     int unusedChans = self->numHostChannels - self->numUserChannels;
-    unsigned char *src, *dst;
     int convertMono = ( self->numHostChannels % 2 ) == 0 && ( self->numUserChannels % 2 ) != 0;
+    int silence;
 
     assert( StreamDirection_Out == self->streamDir );
 
+    if( convertMono )
+        --unusedChans;
+    silence = unusedChans > 0 && !( self->canMmap && self->silencedFrames >= self->bufferSize );
+
     if( self->hostInterleaved )
     {
         int swidth = alsa_snd_pcm_format_size( self->nativeFormat, 1 );
         unsigned char *buffer = self->canMmap ? ExtractAddress( self->channelAreas, self->offset ) : self->nonMmapBuffer;
 
-        /* Start after the last user channel */
-        p = buffer + self->numUserChannels * swidth;
-
         if( convertMono )
         {
             /* Convert the last user channel into stereo pair */
-            src = buffer + ( self->numUserChannels - 1 ) * swidth;
-            for( i = 0; i < numFrames; ++i )
-            {
-                dst = src + swidth;
-                memcpy( dst, src, swidth );
-                src += self->numHostChannels * swidth;
-            }
-
-            /* Don't touch the channel we just wrote to */
-            p += swidth;
-            --unusedChans;
+            DuplicateInterleavedChannel( buffer + ( self->numUserChannels - 1 ) * swidth, swidth,
+                    self->numHostChannels, numFrames );
         }
 
-        if( unusedChans > 0 )
+        if( silence )
         {
-            /* Silence unused output channels */
-            for( i = 0; i < numFrames; ++i )
-            {
-                memset( p, 0, swidth * unusedChans );
-                p += self->numHostChannels * swidth;
-            }
+            /* Silence unused output channels, not touching the channel written by mono conversion */
+            SilenceInterleavedChannels( buffer + ( self->numHostChannels - unusedChans ) * swidth, swidth,
+                    self->numHostChannels, unusedChans, numFrames );
         }
     }
     else
@@ -3537,15 +4785,17 @@ static PaError PaAlsaStreamComponent_DoChannelAdaption( PaAlsaStreamComponent *s
         {
             ENSURE_( alsa_snd_pcm_area_copy( self->channelAreas + self->numUserChannels, self->offset, self->channelAreas +
                     ( self->numUserChannels - 1 ), self->offset, numFrames, self->nativeFormat ), paUnanticipatedHostError );
-            --unusedChans;
         }
-        if( unusedChans > 0 )
+        if( silence )
         {
             alsa_snd_pcm_areas_silence( self->channelAreas + ( self->numHostChannels - unusedChans ), self->offset, unusedChans, numFrames,
                     self->nativeFormat );
         }
     }
 
+    if( silence && self->canMmap )
+        self->silencedFrames = PA_MIN( self->silencedFrames + numFrames, self->bufferSize );
+
 error:
     return result;
 }
@@ -3726,7 +4976,7 @@ static PaError PaAlsaStream_WaitForFrames( PaAlsaStream *self, unsigned long *fr
 {
     PaError result = paNoError;
     int pollPlayback = self->playback.pcm != NULL, pollCapture = self->capture.pcm != NULL;
-    int pollTimeout = self->pollTimeout;
+    unsigned long pollTimeout = self->pollTimeout;
     int xrun = 0, timeouts = 0;
     int pollResults;
 
@@ -3766,17 +5016,33 @@ static PaError PaAlsaStream_WaitForFrames( PaAlsaStream *self, unsigned long *fr
         if( pollCapture )
         {
             capturePfds = self->pfds;
-            PA_ENSURE( PaAlsaStreamComponent_BeginPolling( &self->capture, capturePfds ) );
             totalFds += self->capture.nfds;
         }
         if( pollPlayback )
         {
             playbackPfds = self->pfds + (self->capture.pcm ? self->capture.nfds : 0);
-            PA_ENSURE( PaAlsaStreamComponent_BeginPolling( &self->playback, playbackPfds ) );
             totalFds += self->playback.nfds;
         }
 
-        pollResults = poll( self->pfds, totalFds, pollTimeout );
+        if( self->epollFd >= 0 )
+        {
+            /* The descriptors stay registered, PaAlsaStream_EpollWait only queries them again after a prepare */
+            if( pollCapture )
+                self->capture.ready = 0;
+            if( pollPlayback )
+                self->playback.ready = 0;
+            pollResults = PaAlsaStream_EpollWait( self, pollCapture, pollPlayback, pollTimeout );
+        }
+        else
+        {
+            if( pollCapture )
+                PA_ENSURE( PaAlsaStreamComponent_BeginPolling( &self->capture, capturePfds ) );
+            if( pollPlayback )
+                PA_ENSURE( PaAlsaStreamComponent_BeginPolling( &self->playback, playbackPfds ) );
+            /* The descriptors being polled are contiguous, starting with capture's if it is polled */
+            pollResults = poll( pollCapture ? capturePfds : playbackPfds, totalFds,
+                    CalculatePollTimeout( self, pollTimeout ) );
+        }
 
         if( pollResults < 0 )
         {
@@ -4127,6 +5393,179 @@ error:
     return result;
 }
 
+/** Fill the playback buffer with output from the stream callback before starting the stream.
+ *
+ * This implements paPrimeOutputBuffersUsingStreamCallback. The playback pcm is prepared and as many whole periods
+ * as are available are requested from the callback, flagged with paPrimingOutput. Since the capture pcm isn't
+ * running yet the callback receives zeroed input, flagged with paInputUnderflow.
+ *
+ * @param callbackResult The result of the last callback invocation, priming stops early if it is not paContinue.
+ */
+static PaError PaAlsaStream_PrimeOutput( PaAlsaStream *self, int *callbackResult )
+{
+    PaError result = paNoError;
+    PaStreamCallbackTimeInfo timeInfo = {0, 0, 0};
+    PaStreamCallbackFlags cbFlags = paPrimingOutput | (self->capture.pcm ? paInputUnderflow : 0);
+    snd_pcm_sframes_t avail;
+    unsigned long framesToPrime, framesPrimed = 0;
+    double sampleRate = self->streamRepresentation.streamInfo.sampleRate;
+
+    assert( self->playback.pcm );
+
+    ENSURE_( alsa_snd_pcm_prepare( self->playback.pcm ), paUnanticipatedHostError );
+    self->epollStale = 1;
+
+    /* We can't be certain that the whole ring buffer is available for priming, but there should be
+     * at least one period */
+    ENSURE_( avail = alsa_snd_pcm_avail_update( self->playback.pcm ), paUnanticipatedHostError );
+    framesToPrime = PaAlsa_AlignBackward( avail, self->playback.framesPerBuffer );
+    PA_UNLESS( framesToPrime >= self->playback.framesPerBuffer, paInternalError );
+    PA_DEBUG(( "%s: Priming %lu frames of output\n", __FUNCTION__, framesToPrime ));
+
+    /* Only output is processed, input will be zeroed by the buffer processor */
+    self->capture.ready = 0;
+    self->playback.ready = 1;
+
+    while( framesPrimed < framesToPrime && paContinue == *callbackResult )
+    {
+        unsigned long framesGot = framesToPrime - framesPrimed;
+        int xrun = 0;
+
+        /* Nothing is playing yet, the first primed frame will be heard once the stream starts. The time must be on
+         * the clock of the timestamps that the time info of later callbacks is derived from */
+        timeInfo.currentTime = PaAlsaStreamComponent_GetTimestampClockTime( &self->playback );
+        timeInfo.outputBufferDacTime = timeInfo.currentTime + framesPrimed / sampleRate;
+        timeInfo.inputBufferAdcTime = timeInfo.currentTime;
+
+        PaUtil_BeginBufferProcessing( &self->bufferProcessor, &timeInfo, cbFlags );
+
+        if( paUtilFixedHostBufferSize == self->bufferProcessor.hostBufferSizeMode )
+        {
+            framesGot = framesGot >= self->maxFramesPerHostBuffer ? self->maxFramesPerHostBuffer : 0;
+        }
+        else
+        {
+            framesGot = PA_MIN( framesGot, self->maxFramesPerHostBuffer );
+        }
+        if( 0 == framesGot )
+            break;
+
+        PA_ENSURE( PaAlsaStream_SetUpBuffers( self, &framesGot, &xrun ) );
+        if( xrun || 0 == framesGot )
+            break;
+
+        PaUtil_EndBufferProcessing( &self->bufferProcessor, callbackResult );
+        PA_ENSURE( PaAlsaStream_EndProcessing( self, framesGot, &xrun ) );
+        if( xrun )
+            break;
+
+        framesPrimed += framesGot;
+    }
+
+end:
+    return result;
+error:
+    goto end;
+}
+
+/** Rewind queued output that has not been played yet, so that it will be rendered again.
+ *
+ * @param safetyFrames The number of queued frames to leave in place.
+ * @param rewound The number of frames rewound.
+ */
+static PaError PaAlsaStreamComponent_Rewind( PaAlsaStreamComponent *self, unsigned long safetyFrames,
+        unsigned long *rewound )
+{
+    PaError result = paNoError;
+    snd_pcm_sframes_t rewindable;
+
+    *rewound = 0;
+
+    if( alsa_snd_pcm_rewindable )
+    {
+        ENSURE_( rewindable = alsa_snd_pcm_rewindable( self->pcm ), paUnanticipatedHostError );
+    }
+    else
+    {
+        /* Prior to Alsa 1.0.18, assume everything queued can be rewound */
+        snd_pcm_sframes_t avail;
+        ENSURE_( avail = alsa_snd_pcm_avail_update( self->pcm ), paUnanticipatedHostError );
+        rewindable = self->bufferSize - avail;
+    }
+
+    if( rewindable > (snd_pcm_sframes_t)safetyFrames )
+    {
+        snd_pcm_sframes_t frames;
+        ENSURE_( frames = alsa_snd_pcm_rewind( self->pcm, rewindable - safetyFrames ), paUnanticipatedHostError );
+        *rewound = frames;
+        self->silencedFrames -= PA_MIN( self->silencedFrames, (snd_pcm_uframes_t)frames );
+    }
+
+end:
+    return result;
+error:
+    goto end;
+}
+
+/* Number of periods to measure the reference fill level over, after starting */
+#define DRIFT_SETTLE_PERIODS 64
+/* Coefficient of the low-pass filter applied to the fill level */
+#define DRIFT_FILTER_COEFF 0.01
+
+/** Compensate for clock drift between unlinked capture and playback pcms.
+ *
+ * The number of frames in transit, i.e. captured but not yet read plus written but not yet played, stays constant as
+ * long as the two clocks agree. When its filtered level departs from the level measured once the stream has settled,
+ * a capture frame is skipped (snd_pcm_forward) or repeated (snd_pcm_rewind). Correcting at most one frame per period
+ * this keeps up with drift of up to one frame per period, instead of eventually running into an xrun and a restart.
+ * Wherever the pointers jump otherwise (starting, xrun recovery, rewinding output) driftSettleCount is reset so that
+ * the level is measured again.
+ */
+static void PaAlsaStream_CompensateDrift( PaAlsaStream *self )
+{
+    snd_pcm_sframes_t captureAvail, playbackDelay;
+    double level, threshold = self->capture.framesPerBuffer / 4.;
+
+    if( (captureAvail = alsa_snd_pcm_avail_update( self->capture.pcm )) < 0 ||
+            alsa_snd_pcm_delay( self->playback.pcm, &playbackDelay ) < 0 )
+    {
+        /* Xruns are dealt with when waiting for frames */
+        return;
+    }
+    level = captureAvail + playbackDelay;
+
+    if( self->driftSettleCount < DRIFT_SETTLE_PERIODS )
+    {
+        /* Running average */
+        if( 0 == self->driftSettleCount )
+            self->driftBaseline = 0.;
+        self->driftBaseline += (level - self->driftBaseline) / ++self->driftSettleCount;
+        self->driftLevel = self->driftBaseline;
+        return;
+    }
+
+    self->driftLevel += DRIFT_FILTER_COEFF * (level - self->driftLevel);
+
+    if( self->driftLevel - self->driftBaseline > threshold )
+    {
+        /* Capture runs fast */
+        if( alsa_snd_pcm_forward( self->capture.pcm, 1 ) == 1 )
+        {
+            self->driftLevel -= 1.;
+            ++self->driftFramesSkipped;
+        }
+    }
+    else if( self->driftBaseline - self->driftLevel > threshold )
+    {
+        /* Playback runs fast */
+        if( alsa_snd_pcm_rewind( self->capture.pcm, 1 ) == 1 )
+        {
+            self->driftLevel += 1.;
+            ++self->driftFramesRepeated;
+        }
+    }
+}
+
 /** Callback thread's function.
  *
  * Roughly, the workflow can be described in the following way: The number of available frames that can be processed
@@ -4140,46 +5579,36 @@ static void *CallbackThreadFunc( void *userData )
     PaError result = paNoError;
     PaAlsaStream *stream = (PaAlsaStream*) userData;
     PaStreamCallbackTimeInfo timeInfo = {0, 0, 0};
-    snd_pcm_sframes_t startThreshold = 0;
     int callbackResult = paContinue;
     PaStreamCallbackFlags cbFlags = 0;  /* We might want to keep state across iterations */
     int streamStarted = 0;
 
     assert( stream );
 
+    if( stream->lockMemory )
+        PaUtil_PrefaultStack( PA_PREFAULT_STACK_SIZE );
+
     /* Execute OnExit when exiting */
     pthread_cleanup_push( &OnExit, stream );
 
-    /* Not implemented */
-    assert( !stream->primeBuffers );
-
-    /* @concern StreamStart If the output is being primed the output pcm needs to be prepared, otherwise the
-     * stream is started immediately. The latter involves signaling the waiting main thread.
+    /* @concern StreamStart If the output is being primed the output pcm is filled from the callback before
+     * starting, otherwise the buffer is zeroed. Either way the stream is started before we signal the waiting
+     * main thread.
      */
+    PA_ENSURE( PaUnixThread_PrepareNotify( &stream->thread ) );
     if( stream->primeBuffers )
     {
-        snd_pcm_sframes_t avail;
-
-        if( stream->playback.pcm )
-            ENSURE_( alsa_snd_pcm_prepare( stream->playback.pcm ), paUnanticipatedHostError );
-        if( stream->capture.pcm && !stream->pcmsSynced )
-            ENSURE_( alsa_snd_pcm_prepare( stream->capture.pcm ), paUnanticipatedHostError );
-
-        /* We can't be certain that the whole ring buffer is available for priming, but there should be
-         * at least one period */
-        avail = alsa_snd_pcm_avail_update( stream->playback.pcm );
-        startThreshold = avail - (avail % stream->playback.framesPerBuffer);
-        assert( startThreshold >= stream->playback.framesPerBuffer );
+        PA_ENSURE( PaAlsaStream_PrimeOutput( stream, &callbackResult ) );
+        PA_ENSURE( AlsaStart( stream, 1 ) );
     }
     else
     {
-        PA_ENSURE( PaUnixThread_PrepareNotify( &stream->thread ) );
         /* Buffer will be zeroed */
         PA_ENSURE( AlsaStart( stream, 0 ) );
-        PA_ENSURE( PaUnixThread_NotifyParent( &stream->thread ) );
-
-        streamStarted = 1;
     }
+    PA_ENSURE( PaUnixThread_NotifyParent( &stream->thread ) );
+
+    streamStarted = 1;
 
     while( 1 )
     {
@@ -4213,10 +5642,28 @@ static void *CallbackThreadFunc( void *userData )
             /* There is still buffered output that needs to be processed */
         }
 
+        /* @concern Rewind Output invalidated by the user is rewound here, it is then reported available again */
+        if( stream->rewindRequested )
+        {
+            unsigned long rewound;
+
+            /* Pairs with the barrier in PaAlsa_InvalidateStreamOutput, rewindSafetyFrames is set before the request */
+            PaUtil_ReadMemoryBarrier();
+            stream->rewindRequested = 0;
+            PA_ENSURE( PaAlsaStreamComponent_Rewind( &stream->playback, stream->rewindSafetyFrames, &rewound ) );
+            /* Output held back by the buffer processor comes after the queued output, so it is invalid too */
+            PaUtil_ResetBufferProcessorOutput( &stream->bufferProcessor );
+            /* The playback delay dropped by the rewound frames, which isn't drift */
+            if( rewound > 0 )
+                stream->driftSettleCount = 0;
+            PA_DEBUG(( "%s: Rewound %lu frames of output\n", __FUNCTION__, rewound ));
+        }
+
         /* Wait for data to become available, this comes down to polling the ALSA file descriptors untill we have
          * a number of available frames.
          */
         PA_ENSURE( PaAlsaStream_WaitForFrames( stream, &framesAvail, &xrun ) );
+        PaUtil_TraceEvent( stream->bufferProcessor.trace, "wakeup, %lu frames available", framesAvail, 0, 0, 0 );
         if( xrun )
         {
             assert( 0 == framesAvail );
@@ -4297,7 +5744,9 @@ static void *CallbackThreadFunc( void *userData )
             {
                 assert( !xrun );
                 PaUtil_EndBufferProcessing( &stream->bufferProcessor, &callbackResult );
+                PaUtil_TraceBegin( stream->bufferProcessor.trace, "commit host buffer" );
                 PA_ENSURE( PaAlsaStream_EndProcessing( stream, framesGot, &xrun ) );
+                PaUtil_TraceEnd( stream->bufferProcessor.trace, "commit host buffer" );
             }
             PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesGot );
 
@@ -4311,6 +5760,12 @@ static void *CallbackThreadFunc( void *userData )
             if( paContinue != callbackResult )
                 break;
         }
+
+        /* @concern FullDuplex Unlinked pcms are driven by separate clocks */
+        if( stream->capture.pcm && stream->playback.pcm && !stream->pcmsSynced )
+        {
+            PaAlsaStream_CompensateDrift( stream );
+        }
     }
 
 end:
@@ -4318,6 +5773,11 @@ end:
     /* Match pthread_cleanup_push */
     pthread_cleanup_pop( 1 );
 
+    if( stream->driftFramesSkipped || stream->driftFramesRepeated )
+    {
+        PA_DEBUG(( "%s: Compensated clock drift by skipping %lu and repeating %lu capture frames\n", __FUNCTION__,
+                    stream->driftFramesSkipped, stream->driftFramesRepeated ));
+    }
     PA_DEBUG(( "%s: Thread %d exiting\n ", __FUNCTION__, pthread_self() ));
     PaUnixThreading_EXIT( result );
 
@@ -4511,8 +5971,11 @@ void PaAlsa_InitializeStreamInfo( PaAlsaStreamInfo *info )
 {
     info->size = sizeof (PaAlsaStreamInfo);
     info->hostApiType = paALSA;
-    info->version = 1;
+    info->version = 2;
     info->deviceString = NULL;
+    info->aggregateDeviceCount = 0;
+    info->aggregateDeviceStrings = NULL;
+    info->aggregateChannelCounts = NULL;
 }
 
 void PaAlsa_EnableRealtimeScheduling( PaStream *s, int enable )
@@ -4545,7 +6008,7 @@ static PaError GetAlsaStreamPointer( PaStream* s, PaAlsaStream** stream )
 
     *stream = (PaAlsaStream*)s;
 error:
-    return paNoError;
+    return result;
 }
 
 PaError PaAlsa_GetStreamInputCard( PaStream* s, int* card )
@@ -4586,8 +6049,165 @@ error:
     return result;
 }
 
+PaError PaAlsa_InvalidateStreamOutput( PaStream* s, unsigned long safetyFrames, unsigned long* framesRewound )
+{
+    PaAlsaStream *stream;
+    PaError result = paNoError;
+    unsigned long rewound = 0;
+
+    PA_ENSURE( GetAlsaStreamPointer( s, &stream ) );
+
+    PA_UNLESS( stream->playback.pcm, paCanNotWriteToAnInputOnlyStream );
+
+    if( stream->callbackMode )
+    {
+        /* The callback thread owns the pcm, leave it to rewind before waiting for the device again */
+        stream->rewindSafetyFrames = safetyFrames;
+        PaUtil_WriteMemoryBarrier();
+        stream->rewindRequested = 1;
+    }
+    else
+    {
+        PA_ENSURE( PaAlsaStreamComponent_Rewind( &stream->playback, safetyFrames, &rewound ) );
+    }
+
+error:
+    if( framesRewound )
+        *framesRewound = rewound;
+    return result;
+}
+
+PaError PaAlsa_GetStreamXrunInfo( PaStream* s, PaAlsaXrunInfo* info )
+{
+    PaAlsaStream *stream;
+    PaError result = paNoError;
+    unsigned long sequence;
+
+    PA_ENSURE( GetAlsaStreamPointer( s, &stream ) );
+
+    /* Retry until no update overlapped copying */
+    do
+    {
+        while( (sequence = stream->xrunInfoSequence) & 1 )
+            ;
+        PaUtil_ReadMemoryBarrier();
+        *info = stream->xrunInfo;
+        PaUtil_ReadMemoryBarrier();
+    }
+    while( sequence != stream->xrunInfoSequence );
+
+error:
+    return result;
+}
+
+PaError PaAlsa_SetStreamScheduling( PaStream* s, const PaAlsaThreadScheduling* scheduling )
+{
+    PaAlsaStream *stream;
+    PaError result = paNoError;
+
+    PA_ENSURE( GetAlsaStreamPointer( s, &stream ) );
+
+    if( scheduling->policy == SCHED_FIFO || scheduling->policy == SCHED_RR )
+    {
+        PA_UNLESS( scheduling->priority >= sched_get_priority_min( scheduling->policy ) &&
+                scheduling->priority <= sched_get_priority_max( scheduling->policy ), paInvalidFlag );
+    }
+    else if( scheduling->policy == paAlsaSchedDeadline )
+    {
+        PA_UNLESS( scheduling->deadlineUtilization > 0. && scheduling->deadlineUtilization <= 1., paInvalidFlag );
+        PA_UNLESS( !scheduling->cpuMask, paInvalidFlag );
+    }
+    else
+        PA_UNLESS( scheduling->policy == SCHED_OTHER, paInvalidFlag );
+
+    stream->scheduling = *scheduling;
+    stream->customScheduling = 1;
+    stream->rtSched = 1;
+
+error:
+    return result;
+}
+
+PaError PaAlsa_GetStreamScheduling( PaStream* s, PaAlsaThreadScheduling* scheduling )
+{
+    PaAlsaStream *stream;
+    PaError result = paNoError;
+    PaUnixThreadScheduling effective;
+
+    PA_ENSURE( GetAlsaStreamPointer( s, &stream ) );
+    PA_UNLESS( stream->callbackMode && stream->isActive, paStreamIsStopped );
+
+    memset( scheduling, 0, sizeof (PaAlsaThreadScheduling) );
+    scheduling->granted = PaUnixThread_GetScheduling( &stream->thread, &effective );
+    scheduling->policy = effective.policy;
+    scheduling->priority = effective.priority;
+    scheduling->cpuMask = effective.cpuMask;
+    if( effective.period > 0 )
+    {
+        scheduling->deadlineUtilization = (double)effective.runtime / effective.period;
+        scheduling->deadlinePeriod = effective.period / 1e9;
+    }
+
+error:
+    return result;
+}
+
+PaError PaAlsa_StreamTimeToRealtime( PaStream* s, PaTime streamTime, PaTime* realtime )
+{
+    PaAlsaStream *stream;
+    PaError result = paNoError;
+    const PaAlsaStreamComponent *component;
+
+    PA_ENSURE( GetAlsaStreamPointer( s, &stream ) );
+
+    /* GetStreamTime prefers the capture timestamps as well */
+    component = stream->capture.pcm ? &stream->capture : &stream->playback;
+    *realtime = component->clockTimestamps ? PaUnixClock_ToRealtime( streamTime ) : streamTime;
+
+error:
+    return result;
+}
+
 PaError PaAlsa_SetRetriesBusy( int retries )
 {
     busyRetries_ = retries;
     return paNoError;
 }
+
+PaError PaAlsa_SetPcmPoolSize( int maxPooledStreams )
+{
+    pcmPoolSize_ = maxPooledStreams;
+    TrimPcmPool( pcmPoolSize_ );
+    return paNoError;
+}
+
+PaError PaAlsa_SetDeviceChangeCallback( PaAlsaDeviceChangeCallback *callback, void *userData )
+{
+    PaError result = paNoError;
+    PaUtilHostApiRepresentation* hostApi;
+    PaAlsaHostApiRepresentation* alsaHostApi;
+
+    PA_ENSURE( PaUtil_GetHostApiRepresentation( &hostApi, paALSA ) );
+    alsaHostApi = (PaAlsaHostApiRepresentation*)hostApi;
+
+    StopDeviceMonitor( alsaHostApi );
+    alsaHostApi->deviceChangeCallback = callback;
+    alsaHostApi->deviceChangeUserData = userData;
+    if( callback )
+        PA_ENSURE( StartDeviceMonitor( alsaHostApi ) );
+
+error:
+    return result;
+}
+
+PaError PaAlsa_RefreshDeviceList( int *devicesChanged )
+{
+    PaError result = paNoError;
+    PaUtilHostApiRepresentation* hostApi;
+
+    PA_ENSURE( PaUtil_GetHostApiRepresentation( &hostApi, paALSA ) );
+    PA_ENSURE( RefreshDeviceList( (PaAlsaHostApiRepresentation*)hostApi, devicesChanged ) );
+
+error:
+    return result;
+}
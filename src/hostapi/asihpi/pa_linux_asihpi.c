@@ -750,9 +750,9 @@ PaError PaAsiHpi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
     }
 
     /* Allocate host API structure */
-    PA_UNLESS_( hpiHostApi = (PaAsiHpiHostApiRepresentation*) PaUtil_AllocateMemory(
-                                 sizeof(PaAsiHpiHostApiRepresentation) ), paInsufficientMemory );
-    PA_UNLESS_( hpiHostApi->allocations = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+    PA_UNLESS_( hpiHostApi = (PaAsiHpiHostApiRepresentation*) PaUtil_AllocateTaggedMemory(
+                                 sizeof(PaAsiHpiHostApiRepresentation), paMemoryDeviceInfo ), paInsufficientMemory );
+    PA_UNLESS_( hpiHostApi->allocations = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo ), paInsufficientMemory );
 
     hpiHostApi->hostApiIndex = hostApiIndex;
 
@@ -1622,7 +1622,7 @@ static PaError PaAsiHpi_SetupBuffers( PaAsiHpiStreamComponent *streamComp, uint3
     /* Temp buffer size should be multiple of PA host buffer size (or 1x, if using fixed blocks) */
     streamComp->tempBufferSize = paHostBufferSize;
     /* Allocate temp buffer */
-    PA_UNLESS_( streamComp->tempBuffer = (uint8_t *)PaUtil_AllocateMemory( streamComp->tempBufferSize ),
+    PA_UNLESS_( streamComp->tempBuffer = (uint8_t *)PaUtil_AllocateTaggedMemory( streamComp->tempBufferSize, paMemoryHostApiStream ),
                 paInsufficientMemory );
 error:
     return result;
@@ -1682,7 +1682,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         return paInvalidFlag; /* unexpected platform-specific flag */
 
     /* Create blank stream structure */
-    PA_UNLESS_( stream = (PaAsiHpiStream *)PaUtil_AllocateMemory( sizeof(PaAsiHpiStream) ),
+    PA_UNLESS_( stream = (PaAsiHpiStream *)PaUtil_AllocateTaggedMemory( sizeof(PaAsiHpiStream), paMemoryHostApiStream ),
                 paInsufficientMemory );
     memset( stream, 0, sizeof(PaAsiHpiStream) );
 
@@ -1719,7 +1719,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     if( inputParameters )
     {
         /* Create blank stream component structure */
-        PA_UNLESS_( stream->input = (PaAsiHpiStreamComponent *)PaUtil_AllocateMemory( sizeof(PaAsiHpiStreamComponent) ),
+        PA_UNLESS_( stream->input = (PaAsiHpiStreamComponent *)PaUtil_AllocateTaggedMemory( sizeof(PaAsiHpiStreamComponent), paMemoryHostApiStream ),
                     paInsufficientMemory );
         memset( stream->input, 0, sizeof(PaAsiHpiStreamComponent) );
         /* Create/validate format */
@@ -1740,7 +1740,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     if( outputParameters )
     {
         /* Create blank stream component structure */
-        PA_UNLESS_( stream->output = (PaAsiHpiStreamComponent *)PaUtil_AllocateMemory( sizeof(PaAsiHpiStreamComponent) ),
+        PA_UNLESS_( stream->output = (PaAsiHpiStreamComponent *)PaUtil_AllocateTaggedMemory( sizeof(PaAsiHpiStreamComponent), paMemoryHostApiStream ),
                     paInsufficientMemory );
         memset( stream->output, 0, sizeof(PaAsiHpiStreamComponent) );
         /* Create/validate format */
@@ -1790,11 +1790,13 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                                                streamCallback, userData );
         /* Pre-allocate non-interleaved user buffer pointers for blocking interface */
         PA_UNLESS_( stream->blockingUserBufferCopy =
-                        PaUtil_AllocateMemory( sizeof(void *) * PA_MAX( inputChannelCount, outputChannelCount ) ),
+                        PaUtil_AllocateTaggedMemory( sizeof(void *) * PA_MAX( inputChannelCount, outputChannelCount ), paMemoryHostApiStream ),
                     paInsufficientMemory );
         stream->callbackMode = 0;
     }
     PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+    stream->baseStreamRep.cpuLoadMeasurer = &stream->cpuLoadMeasurer;
+    stream->baseStreamRep.bufferProcessor = &stream->bufferProcessor;
 
     /* Following pa_linux_alsa's lead, we operate with fixed host buffer size by default, */
     /* since other modes will invariably lead to block adaption (maybe Bounded better?) */
@@ -2007,12 +2009,13 @@ static PaError StartStream( PaStream *s )
 
     /* Ready the processor */
     PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    PaUtil_ResetBufferProcessorStatistics( &stream->bufferProcessor );
 
     if( stream->callbackMode )
     {
         /* Create and start callback engine thread */
         /* Also waits 1 second for stream to be started by engine thread (otherwise aborts) */
-        PA_ENSURE_( PaUnixThread_New( &stream->thread, &CallbackThreadFunc, stream, 1., 0 /*rtSched*/ ) );
+        PA_ENSURE_( PaUnixThread_New( &stream->thread, &CallbackThreadFunc, stream, 1., NULL /* default scheduling */ ) );
     }
     else
     {
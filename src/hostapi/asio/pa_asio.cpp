@@ -1060,7 +1060,7 @@ PaError PaAsio_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
 
     asioHostApi->asioDrivers = 0; /* avoid surprises in our error handler below */
 
-    asioHostApi->allocations = PaUtil_CreateAllocationGroup();
+    asioHostApi->allocations = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo );
     if( !asioHostApi->allocations )
     {
         result = paInsufficientMemory;
@@ -2187,6 +2187,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 
 
     PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+    stream->streamRepresentation.cpuLoadMeasurer = &stream->cpuLoadMeasurer;
+    stream->streamRepresentation.bufferProcessor = &stream->bufferProcessor;
 
 
     stream->asioBufferInfos = (ASIOBufferInfo*)PaUtil_AllocateMemory(
@@ -3272,6 +3274,7 @@ static PaError StartStream( PaStream *s )
     }
 
     PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    PaUtil_ResetBufferProcessorStatistics( &stream->bufferProcessor );
     stream->stopProcessing = false;
     stream->zeroOutput = false;
 
@@ -354,7 +354,7 @@ static PaError gatherDeviceInfo(PaMacAUHAL *auhalHostApi)
     VVDBUG(("gatherDeviceInfo()\n"));
     /* -- free any previous allocations -- */
     if( auhalHostApi->devIds )
-        PaUtil_GroupFreeMemory(auhalHostApi->allocations, auhalHostApi->devIds);
+        PaUtil_FreeMemory(auhalHostApi->devIds);
     auhalHostApi->devIds = NULL;
 
     /* -- figure out how many devices there are -- */
@@ -366,9 +366,10 @@ static PaError gatherDeviceInfo(PaMacAUHAL *auhalHostApi)
     VDBUG( ( "Found %ld device(s).\n", auhalHostApi->devCount ) );
 
     /* -- copy the device IDs -- */
-    auhalHostApi->devIds = (AudioDeviceID *)PaUtil_GroupAllocateMemory(
-                             auhalHostApi->allocations,
-                             propsize );
+    /* not in the allocation group, since it is freed when the list changes */
+    auhalHostApi->devIds = (AudioDeviceID *)PaUtil_AllocateTaggedMemory(
+                             propsize,
+                             paMemoryDeviceInfo );
     if( !auhalHostApi->devIds )
         return paInsufficientMemory;
     AudioHardwareGetProperty( kAudioHardwarePropertyDevices,
@@ -737,7 +738,7 @@ PaError PaMacCore_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIn
         goto error;
     }
 
-    auhalHostApi->allocations = PaUtil_CreateAllocationGroup();
+    auhalHostApi->allocations = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo );
     if( !auhalHostApi->allocations )
     {
         result = paInsufficientMemory;
@@ -834,6 +835,9 @@ PaError PaMacCore_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIn
 error:
     if( auhalHostApi )
     {
+        if( auhalHostApi->devIds )
+            PaUtil_FreeMemory( auhalHostApi->devIds );
+
         if( auhalHostApi->allocations )
         {
             PaUtil_FreeAllAllocations( auhalHostApi->allocations );
@@ -864,6 +868,9 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
         TODO: Double check that everything is handled by alloc group
     */
 
+    if( auhalHostApi->devIds )
+        PaUtil_FreeMemory( auhalHostApi->devIds );
+
     if( auhalHostApi->allocations )
     {
         PaUtil_FreeAllAllocations( auhalHostApi->allocations );
@@ -1800,6 +1807,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     }
 
     PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+    stream->streamRepresentation.cpuLoadMeasurer = &stream->cpuLoadMeasurer;
+    stream->streamRepresentation.bufferProcessor = &stream->bufferProcessor;
 
     
     if( inputParameters )
@@ -2661,6 +2670,7 @@ static PaError StartStream( PaStream *s )
 
     /*FIXME: maybe want to do this on close/abort for faster start? */
     PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    PaUtil_ResetBufferProcessorStatistics( &stream->bufferProcessor );
     if(  stream->inputSRConverter )
        ERR_WRAP( AudioConverterReset( stream->inputSRConverter ) );
 
@@ -664,6 +664,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                                              : &macCoreHostApi->blockingStreamInterface ),
                                            streamCallback, userData );
     PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+    stream->streamRepresentation.cpuLoadMeasurer = &stream->cpuLoadMeasurer;
+    stream->streamRepresentation.bufferProcessor = &stream->bufferProcessor;
     
     *s = (PaStream*)stream;
     PaMacClientData *clientData = PaUtil_AllocateMemory(sizeof(PaMacClientData));
@@ -869,7 +871,7 @@ PaError PaMacCore_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIn
         goto error;
     }
     
-    macCoreHostApi->allocations = PaUtil_CreateAllocationGroup();
+    macCoreHostApi->allocations = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo );
     if( !macCoreHostApi->allocations )
     {
         result = paInsufficientMemory;
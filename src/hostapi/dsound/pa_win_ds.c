@@ -1175,7 +1175,7 @@ PaError PaWinDs_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInde
         goto error;
     }
 
-    winDsHostApi->allocations = PaUtil_CreateAllocationGroup();
+    winDsHostApi->allocations = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo );
     if( !winDsHostApi->allocations )
     {
         result = paInsufficientMemory;
@@ -2002,6 +2002,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     stream->streamFlags = streamFlags;
 
     PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+    stream->streamRepresentation.cpuLoadMeasurer = &stream->cpuLoadMeasurer;
+    stream->streamRepresentation.bufferProcessor = &stream->bufferProcessor;
 
 
     if( inputParameters )
@@ -2883,6 +2885,7 @@ static PaError StartStream( PaStream *s )
         
     stream->callbackResult = paContinue;
     PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    PaUtil_ResetBufferProcessorStatistics( &stream->bufferProcessor );
     
     ResetEvent( stream->processingCompleted );
 
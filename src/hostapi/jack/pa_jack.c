@@ -55,9 +55,11 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <errno.h>  /* EBUSY */
+#include <limits.h> /* LONG_MAX */
 #include <signal.h> /* sig_atomic_t */
 #include <math.h>
 #include <semaphore.h>
+#include <time.h>   /* clock_gettime */
 
 #include <jack/types.h>
 #include <jack/jack.h>
@@ -70,6 +72,10 @@
 #include "pa_cpuload.h"
 #include "pa_ringbuffer.h"
 #include "pa_debugprint.h"
+#include "pa_memorybarrier.h"
+#include "pa_trace.h"
+
+#include "pa_jack.h"
 
 static pthread_t mainThread_;
 static char *jackErr_ = NULL;
@@ -154,6 +160,28 @@ static double GetStreamCpuLoad( PaStream* stream );
 
 struct PaJackStream;
 
+/* Requests from the main thread(s) to the JACK process callback */
+typedef enum
+{
+    PaJackCommand_Add,
+    PaJackCommand_Remove,
+    PaJackCommand_Start,
+    PaJackCommand_Stop,
+    PaJackCommand_Abort
+}
+PaJackCommandType;
+
+typedef struct
+{
+    PaJackCommandType type;
+    struct PaJackStream *stream;
+    long id;    /* Identifies the request for withdrawing it, see SendCommand */
+}
+PaJackCommand;
+
+/* Must be a power of 2, requests are serialized so only one is ever pending in practice */
+#define PA_JACK_COMMAND_QUEUE_SIZE 8
+
 typedef struct
 {
     PaUtilHostApiRepresentation commonHostApiRep;
@@ -166,18 +194,31 @@ typedef struct
     int jack_buffer_size;
     PaHostApiIndex hostApiIndex;
 
-    pthread_mutex_t mtx;
-    pthread_cond_t cond;
+    pthread_mutex_t mtx;    /* Serializes requests to the process thread, which never takes it */
+    sem_t commandDone;      /* Posted by the process thread when it has carried out a request */
+    PaError commandResult;  /* Set by the process thread before posting commandDone if a request failed */
+    long lastCommandId;     /* Id of the last request sent, only touched with mtx held */
+    volatile long pendingCommandId; /* Id of the request the process thread hasn't taken yet, 0 if none */
     unsigned long inputBase, outputBase;
 
     /* For dealing with the process thread */
     volatile int xrun;     /* Received xrun notification from JACK? */
-    struct PaJackStream * volatile toAdd, * volatile toRemove;
-    struct PaJackStream *processQueue;
+    PaUtilRingBuffer commandQueue;  /* Lock-free queue of PaJackCommand, drained by the process thread */
+    PaJackCommand commandQueueData[PA_JACK_COMMAND_QUEUE_SIZE];
+    struct PaJackStream *processQueue;  /* Only touched by the process thread once the client is active */
     volatile sig_atomic_t jackIsDown;
+    int stackPrefaulted;    /* Has the process thread's stack been pre-grown for paLockStreamMemory, process thread only */
 }
 PaJackHostApiRepresentation;
 
+/* Wakes a thread blocked in Pa_ReadStream/Pa_WriteStream once enough of the FIFO has become available */
+typedef struct
+{
+    sem_t semaphore;
+    volatile long threshold;    /* Bytes the blocked thread is waiting for, 0 if no thread is waiting */
+}
+PaJackBlockingWakeup;
+
 /* PaJackStream - a stream data structure specifically for this implementation */
 
 typedef struct PaJackStream
@@ -205,8 +246,8 @@ typedef struct PaJackStream
      */
     volatile sig_atomic_t is_running;
     volatile sig_atomic_t is_active;
-    /* Used to signal processing thread that stream should start or stop, respectively */
-    volatile sig_atomic_t doStart, doStop, doAbort;
+    /* Set by the processing thread when asked to stop or abort the stream, respectively */
+    int doStop, doAbort;
 
     jack_nframes_t t0;
 
@@ -218,13 +259,23 @@ typedef struct PaJackStream
     int isSilenced;
     int xrun;
 
+    /* Zero-copy path: the user asked for paFloat32|paNonInterleaved at the JACK period size, so the callback is
+     * handed the port buffers directly instead of going through the buffer processor */
+    int directCallback;
+    int lockMemory;     /* Opened with paLockStreamMemory */
+    jack_nframes_t directFramesPerBuffer;   /* 0 if the user accepts any buffer size */
+    const jack_default_audio_sample_t **directInputBuffers;
+    jack_default_audio_sample_t **directOutputBuffers;
+
     /* These are useful for the blocking API */
 
     int                     isBlockingStream;
     PaUtilRingBuffer        inFIFO;
     PaUtilRingBuffer        outFIFO;
-    volatile sig_atomic_t   data_available;
-    sem_t                   data_semaphore;
+    PaJackBlockingWakeup    readWakeup;
+    PaJackBlockingWakeup    writeWakeup;
+    long                    readWakeupBytes;    /* 0 to wait for the whole remaining request */
+    long                    writeWakeupBytes;
     int                     bytesPerFrame;
     int                     samplesPerFrame;
 
@@ -254,7 +305,7 @@ static int JackCallback( jack_nframes_t frames, void *userData );
 static PaError BlockingInitFIFO( PaUtilRingBuffer *rbuf, long numFrames, long bytesPerFrame )
 {
     long numBytes = numFrames * bytesPerFrame;
-    char *buffer = (char *) malloc( numBytes );
+    char *buffer = (char *) PaUtil_AllocateTaggedMemory( numBytes, paMemoryRingBuffer );
     if( buffer == NULL ) return paInsufficientMemory;
     memset( buffer, 0, numBytes );
     return (PaError) PaUtil_InitializeRingBuffer( rbuf, 1, numBytes, buffer );
@@ -263,11 +314,61 @@ static PaError BlockingInitFIFO( PaUtilRingBuffer *rbuf, long numFrames, long by
 /* Free buffer. */
 static PaError BlockingTermFIFO( PaUtilRingBuffer *rbuf )
 {
-    if( rbuf->buffer ) free( rbuf->buffer );
+    PaUtil_FreeMemory( rbuf->buffer );
     rbuf->buffer = NULL;
     return paNoError;
 }
 
+static long BlockingGetAvailable( PaUtilRingBuffer *rbuf, int readable )
+{
+    return readable ? PaUtil_GetRingBufferReadAvailable( rbuf ) : PaUtil_GetRingBufferWriteAvailable( rbuf );
+}
+
+/* Called from the process callback after it has transferred data, to wake a blocked reader/writer if its threshold
+ * has been reached.
+ *
+ * The barrier orders the ring buffer update before the threshold load. Together with the barrier in BlockingWait,
+ * either the waiter sees the new data or this sees its threshold; without it both could miss each other. */
+static void BlockingNotify( PaJackBlockingWakeup *wakeup, PaUtilRingBuffer *rbuf, int readable )
+{
+    long threshold;
+
+    PaUtil_FullMemoryBarrier();
+    threshold = wakeup->threshold;
+    if( threshold > 0 && BlockingGetAvailable( rbuf, readable ) >= threshold )
+    {
+        wakeup->threshold = 0;
+        sem_post( &wakeup->semaphore );
+    }
+}
+
+/* Block until at least numBytes can be read from/written to rbuf.
+ *
+ * The threshold is published before availability is re-checked, so the process callback can't miss it. A stale post
+ * (from a notification that raced with the re-check) only causes an extra iteration of the loop.
+ */
+static void BlockingWait( PaJackBlockingWakeup *wakeup, PaUtilRingBuffer *rbuf, int readable, long numBytes )
+{
+    if( numBytes > rbuf->bufferSize )
+        numBytes = rbuf->bufferSize;
+
+    for( ;; )
+    {
+        wakeup->threshold = numBytes;
+        PaUtil_FullMemoryBarrier();
+        if( BlockingGetAvailable( rbuf, readable ) >= numBytes )
+            break;
+        sem_wait( &wakeup->semaphore );
+    }
+    wakeup->threshold = 0;
+}
+
+/* The number of bytes a blocked call should wait for, given the bytes it has yet to transfer */
+static long BlockingGetWakeupBytes( long wakeupBytes, long remainingBytes )
+{
+    return wakeupBytes > 0 && wakeupBytes < remainingBytes ? wakeupBytes : remainingBytes;
+}
+
 static int
 BlockingCallback( const void                      *inputBuffer,
                   void                            *outputBuffer,
@@ -283,29 +384,38 @@ BlockingCallback( const void                      *inputBuffer,
     if( inputBuffer != NULL )
     {
         PaUtil_WriteRingBuffer( &stream->inFIFO, inputBuffer, numBytes );
+        BlockingNotify( &stream->readWakeup, &stream->inFIFO, 1 );
     }
     if( outputBuffer != NULL )
     {
         int numRead = PaUtil_ReadRingBuffer( &stream->outFIFO, outputBuffer, numBytes );
         /* Zero out remainder of buffer if we run out of data. */
         memset( (char *)outputBuffer + numRead, 0, numBytes - numRead );
+        BlockingNotify( &stream->writeWakeup, &stream->outFIFO, 0 );
     }
 
-    if( !stream->data_available )
-    {
-        stream->data_available = 1;
-        sem_post( &stream->data_semaphore );
-    }
     return paContinue;
 }
 
+/* Round the FIFO depth up to the power of 2 required by the ring buffer */
+static long BlockingGetFIFOFrames( long minimumFrames )
+{
+    long numFrames = 32;
+    while( numFrames < minimumFrames )
+        numFrames *= 2;
+    return numFrames;
+}
+
 static PaError
-BlockingBegin( PaJackStream *stream, int minimum_buffer_size )
+BlockingBegin( PaJackStream *stream, long inputFIFOFrames, long outputFIFOFrames )
 {
     long    doRead = 0;
     long    doWrite = 0;
     PaError result = paNoError;
-    long    numFrames;
+
+    sem_init( &stream->readWakeup.semaphore, 0, 0 );
+    sem_init( &stream->writeWakeup.semaphore, 0, 0 );
+    stream->readWakeup.threshold = stream->writeWakeup.threshold = 0;
 
     doRead = stream->local_input_ports != NULL;
     doWrite = stream->local_output_ports != NULL;
@@ -313,39 +423,53 @@ BlockingBegin( PaJackStream *stream, int minimum_buffer_size )
     stream->samplesPerFrame = 2;
     stream->bytesPerFrame = sizeof(float) * stream->samplesPerFrame;
     /* </FIXME> */
-    numFrames = 32;
-    while (numFrames < minimum_buffer_size)
-        numFrames *= 2;
 
     if( doRead )
     {
-        ENSURE_PA( BlockingInitFIFO( &stream->inFIFO, numFrames, stream->bytesPerFrame ) );
+        ENSURE_PA( BlockingInitFIFO( &stream->inFIFO, BlockingGetFIFOFrames( inputFIFOFrames ),
+                    stream->bytesPerFrame ) );
     }
     if( doWrite )
     {
         long numBytes;
 
-        ENSURE_PA( BlockingInitFIFO( &stream->outFIFO, numFrames, stream->bytesPerFrame ) );
+        ENSURE_PA( BlockingInitFIFO( &stream->outFIFO, BlockingGetFIFOFrames( outputFIFOFrames ),
+                    stream->bytesPerFrame ) );
 
         /* Make Write FIFO appear full initially. */
         numBytes = PaUtil_GetRingBufferWriteAvailable( &stream->outFIFO );
         PaUtil_AdvanceRingBufferWriteIndex( &stream->outFIFO, numBytes );
     }
 
-    stream->data_available = 0;
-    sem_init( &stream->data_semaphore, 0, 0 );
-
 error:
     return result;
 }
 
+/* Prefault and lock the memory touched by the process callback, for paLockStreamMemory */
+static void
+LockStreamMemory( PaJackStream *stream )
+{
+    unsigned long lockedSize = stream->bufferProcessor.lockedMemorySize;
+
+    lockedSize += PaUtil_LockMemory( stream, sizeof (PaJackStream) );
+    lockedSize += PaUtil_LockAllocationGroup( stream->stream_memory );
+    if( stream->inFIFO.buffer )
+        lockedSize += PaUtil_LockMemory( stream->inFIFO.buffer, stream->inFIFO.bufferSize * stream->inFIFO.elementSizeBytes );
+    if( stream->outFIFO.buffer )
+        lockedSize += PaUtil_LockMemory( stream->outFIFO.buffer, stream->outFIFO.bufferSize * stream->outFIFO.elementSizeBytes );
+
+    PA_DEBUG(( "%s: Locked %lu bytes of stream memory\n", __FUNCTION__, lockedSize ));
+    stream->streamRepresentation.streamInfo.lockedMemorySize = lockedSize;
+}
+
 static void
 BlockingEnd( PaJackStream *stream )
 {
     BlockingTermFIFO( &stream->inFIFO );
     BlockingTermFIFO( &stream->outFIFO );
 
-    sem_destroy( &stream->data_semaphore );
+    sem_destroy( &stream->readWakeup.semaphore );
+    sem_destroy( &stream->writeWakeup.semaphore );
 }
 
 static PaError BlockingReadStream( PaStream* s, void *data, unsigned long numFrames )
@@ -362,13 +486,8 @@ static PaError BlockingReadStream( PaStream* s, void *data, unsigned long numFra
         numBytes -= bytesRead;
         p += bytesRead;
         if( numBytes > 0 )
-        {
-            /* see write for an explanation */
-            if( stream->data_available )
-                stream->data_available = 0;
-            else
-                sem_wait( &stream->data_semaphore );
-        }
+            BlockingWait( &stream->readWakeup, &stream->inFIFO, 1,
+                    BlockingGetWakeupBytes( stream->readWakeupBytes, numBytes ) );
     }
 
     return result;
@@ -387,26 +506,8 @@ static PaError BlockingWriteStream( PaStream* s, const void *data, unsigned long
         numBytes -= bytesWritten;
         p += bytesWritten;
         if( numBytes > 0 )
-        {
-            /* we use the following algorithm:
-             *   (1) write data
-             *   (2) if some data didn't fit into the ringbuffer, set data_available to 0
-             *       to indicate to the audio that if space becomes available, we want to know
-             *   (3) retry to write data (because it might be that between (1) and (2)
-             *       new space in the buffer became available)
-             *   (4) if this failed, we are sure that the buffer is really empty and
-             *       we will definitely receive a notification when it becomes available
-             *       thus we can safely sleep
-             *
-             * if the algorithm bailed out in step (3) before, it leaks a count of 1
-             * on the semaphore; however, it doesn't matter, because if we block in (4),
-             * we also do it in a loop
-             */
-            if( stream->data_available )
-                stream->data_available = 0;
-            else
-                sem_wait( &stream->data_semaphore );
-        }
+            BlockingWait( &stream->writeWakeup, &stream->outFIFO, 0,
+                    BlockingGetWakeupBytes( stream->writeWakeupBytes, numBytes ) );
     }
 
     return result;
@@ -435,16 +536,55 @@ BlockingWaitEmpty( PaStream *s )
 {
     PaJackStream *stream = (PaJackStream *)s;
 
-    while( PaUtil_GetRingBufferReadAvailable( &stream->outFIFO ) > 0 )
-    {
-        stream->data_available = 0;
-        sem_wait( &stream->data_semaphore );
-    }
+    if( stream->outFIFO.buffer )
+        BlockingWait( &stream->writeWakeup, &stream->outFIFO, 0, stream->outFIFO.bufferSize );
     return 0;
 }
 
 /* ---- jack driver ---- */
 
+static int IsValidStreamInfo( const PaStreamParameters *parameters )
+{
+    const PaJackStreamInfo *streamInfo = (const PaJackStreamInfo *)parameters->hostApiSpecificStreamInfo;
+    return streamInfo->size == sizeof (PaJackStreamInfo) && streamInfo->hostApiType == paJACK &&
+        streamInfo->version == 1;
+}
+
+/* Get the blocking FIFO parameters of one direction, applying defaults where the user didn't specify anything */
+static PaError GetBlockingParameters( const PaStreamParameters *parameters, int jackBufferSize, double sampleRate,
+        long *fifoFrames, long *wakeupFrames )
+{
+    PaError result = paNoError;
+    const PaJackStreamInfo *streamInfo = (const PaJackStreamInfo *)parameters->hostApiSpecificStreamInfo;
+    double latency = 0.001; /* 1ms is the absolute minimum we support */
+
+    *wakeupFrames = 0;
+    if( streamInfo )
+        *wakeupFrames = streamInfo->wakeupFrames;
+
+    if( streamInfo && streamInfo->fifoFrames > 0 )
+    {
+        /* The user knows best, as long as a whole JACK buffer fits */
+        *fifoFrames = streamInfo->fifoFrames;
+        UNLESS( *fifoFrames >= jackBufferSize, paBufferTooSmall );
+    }
+    else
+    {
+        if( parameters->suggestedLatency > latency )
+            latency = parameters->suggestedLatency;
+
+        /* the latency the user asked for indicates the minimum buffer size in frames */
+        *fifoFrames = (long) (latency * sampleRate);
+
+        /* we also need to be able to store at least three full jack buffers to avoid dropouts */
+        if( jackBufferSize * 3 > *fifoFrames )
+            *fifoFrames = jackBufferSize * 3;
+    }
+
+error:
+    return result;
+}
+
 /* BuildDeviceList():
  *
  * The process of determining a list of PortAudio "devices" from
@@ -666,11 +806,9 @@ static void JackOnShutdown( void *arg )
         stream->is_active = 0;
     }
 
-    /* Make sure that the main thread doesn't get stuck waiting on the condition */
-    ASSERT_CALL( pthread_mutex_lock( &jackApi->mtx ), 0 );
+    /* Make sure that the main thread doesn't get stuck waiting for a request to be carried out */
     jackApi->jackIsDown = 1;
-    ASSERT_CALL( pthread_cond_signal( &jackApi->cond ), 0 );
-    ASSERT_CALL( pthread_mutex_unlock( &jackApi->mtx ), 0 );
+    ASSERT_CALL( sem_post( &jackApi->commandDone ), 0 );
 
 }
 
@@ -712,12 +850,14 @@ PaError PaJack_Initialize( PaUtilHostApiRepresentation **hostApi,
     *hostApi = NULL;    /* Initialize to NULL */
 
     UNLESS( jackHostApi = (PaJackHostApiRepresentation*)
-        PaUtil_AllocateMemory( sizeof(PaJackHostApiRepresentation) ), paInsufficientMemory );
-    UNLESS( jackHostApi->deviceInfoMemory = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+        PaUtil_AllocateTaggedMemory( sizeof(PaJackHostApiRepresentation), paMemoryDeviceInfo ), paInsufficientMemory );
+    UNLESS( jackHostApi->deviceInfoMemory = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo ), paInsufficientMemory );
 
     mainThread_ = pthread_self();
     ASSERT_CALL( pthread_mutex_init( &jackHostApi->mtx, NULL ), 0 );
-    ASSERT_CALL( pthread_cond_init( &jackHostApi->cond, NULL ), 0 );
+    ASSERT_CALL( sem_init( &jackHostApi->commandDone, 0, 0 ), 0 );
+    PaUtil_InitializeRingBuffer( &jackHostApi->commandQueue, sizeof(PaJackCommand),
+                                 PA_JACK_COMMAND_QUEUE_SIZE, jackHostApi->commandQueueData );
 
     /* Try to become a client of the JACK server.  If we cannot do
      * this, then this API cannot be used.
@@ -770,9 +910,10 @@ PaError PaJack_Initialize( PaUtilHostApiRepresentation **hostApi,
 
     jackHostApi->inputBase = jackHostApi->outputBase = 0;
     jackHostApi->xrun = 0;
-    jackHostApi->toAdd = jackHostApi->toRemove = NULL;
     jackHostApi->processQueue = NULL;
     jackHostApi->jackIsDown = 0;
+    jackHostApi->stackPrefaulted = 0;
+    jackHostApi->lastCommandId = jackHostApi->pendingCommandId = 0;
 
     jack_on_shutdown( jackHostApi->jack_client, JackOnShutdown, jackHostApi );
     jack_set_error_function( JackErrorCallback );
@@ -816,7 +957,7 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
     ASSERT_CALL( jack_deactivate( jackHostApi->jack_client ), 0 );
 
     ASSERT_CALL( pthread_mutex_destroy( &jackHostApi->mtx ), 0 );
-    ASSERT_CALL( pthread_cond_destroy( &jackHostApi->cond ), 0 );
+    ASSERT_CALL( sem_destroy( &jackHostApi->commandDone ), 0 );
 
     ASSERT_CALL( jack_client_close( jackHostApi->jack_client ), 0 );
 
@@ -856,8 +997,8 @@ static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
             return paInvalidChannelCount;
 
         /* validate inputStreamInfo */
-        if( inputParameters->hostApiSpecificStreamInfo )
-            return paIncompatibleHostApiSpecificStreamInfo; /* this implementation doesn't use custom stream info */
+        if( inputParameters->hostApiSpecificStreamInfo && !IsValidStreamInfo( inputParameters ) )
+            return paIncompatibleHostApiSpecificStreamInfo;
     }
     else
     {
@@ -880,8 +1021,8 @@ static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
             return paInvalidChannelCount;
 
         /* validate outputStreamInfo */
-        if( outputParameters->hostApiSpecificStreamInfo )
-            return paIncompatibleHostApiSpecificStreamInfo; /* this implementation doesn't use custom stream info */
+        if( outputParameters->hostApiSpecificStreamInfo && !IsValidStreamInfo( outputParameters ) )
+            return paIncompatibleHostApiSpecificStreamInfo;
     }
     else
     {
@@ -926,7 +1067,7 @@ static PaError InitializeStream( PaJackStream *stream, PaJackHostApiRepresentati
     assert( stream );
 
     memset( stream, 0, sizeof (PaJackStream) );
-    UNLESS( stream->stream_memory = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+    UNLESS( stream->stream_memory = PaUtil_CreateTaggedAllocationGroup( paMemoryHostApiStream ), paInsufficientMemory );
     stream->jack_client = hostApi->jack_client;
     stream->hostApi = hostApi;
 
@@ -997,40 +1138,72 @@ static void CleanUpStream( PaJackStream *stream, int terminateStreamRepresentati
     PaUtil_FreeMemory( stream );
 }
 
-static PaError WaitCondition( PaJackHostApiRepresentation *hostApi )
+/* Wait for the process thread to carry out the current request, the caller holds hostApi->mtx */
+static PaError WaitCommandDone( PaJackHostApiRepresentation *hostApi )
 {
     PaError result = paNoError;
     int err = 0;
-    PaTime pt = PaUtil_GetTime();
     struct timespec ts;
 
-    ts.tv_sec = (time_t) floor( pt + 10 * 60 /* 10 minutes */ );
-    ts.tv_nsec = (long) ((pt - floor( pt )) * 1000000000);
-    /* XXX: Best enclose in loop, in case of spurious wakeups? */
-    err = pthread_cond_timedwait( &hostApi->cond, &hostApi->mtx, &ts );
+    ASSERT_CALL( clock_gettime( CLOCK_REALTIME, &ts ), 0 );
+    ts.tv_sec += 10 * 60; /* 10 minutes */
+    while( (err = sem_timedwait( &hostApi->commandDone, &ts )) != 0 && errno == EINTR )
+        ;
 
     /* Make sure we didn't time out */
-    UNLESS( err != ETIMEDOUT, paTimedOut );
+    UNLESS( !err || errno != ETIMEDOUT, paTimedOut );
     UNLESS( !err, paInternalError );
 
 error:
     return result;
 }
 
-static PaError AddStream( PaJackStream *stream )
+/* Queue a request for the process thread and wait until it has been carried out. The process thread picks the
+ * request up at the start of its next cycle without taking any locks, the mutex only serializes requesters. */
+static PaError SendCommand( PaJackHostApiRepresentation *hostApi, PaJackCommandType type, PaJackStream *stream )
 {
     PaError result = paNoError;
-    PaJackHostApiRepresentation *hostApi = stream->hostApi;
-    /* Add to queue of streams that should be processed */
+    PaJackCommand command;
+
+    command.type = type;
+    command.stream = stream;
+
     ASSERT_CALL( pthread_mutex_lock( &hostApi->mtx ), 0 );
     if( !hostApi->jackIsDown )
     {
-        hostApi->toAdd = stream;
-        /* Unlock mutex and await signal from processing thread */
-        result = WaitCondition( stream->hostApi );
+        /* Discard completions left over from requests that timed out */
+        while( sem_trywait( &hostApi->commandDone ) == 0 )
+            ;
+
+        hostApi->lastCommandId = hostApi->lastCommandId % LONG_MAX + 1;
+        command.id = hostApi->lastCommandId;
+        hostApi->pendingCommandId = command.id;
+        hostApi->commandResult = paNoError;
+        if( PaUtil_WriteRingBuffer( &hostApi->commandQueue, &command, 1 ) == 1 )
+        {
+            result = WaitCommandDone( hostApi );
+            /* A request still in the queue is withdrawn, as its stream may be freed once we return. The process
+             * thread skips it, see UpdateQueue. A request it has taken meanwhile is being carried out, wait for it. */
+            if( !PaUtil_AtomicCompareAndSwap( &hostApi->pendingCommandId, command.id, 0 ) && result != paNoError )
+                result = WaitCommandDone( hostApi );
+            if( result == paNoError )
+                result = hostApi->commandResult;
+        }
+        else
+            result = paInternalError;
     }
     ASSERT_CALL( pthread_mutex_unlock( &hostApi->mtx ), 0 );
-    ENSURE_PA( result );
+
+    return result;
+}
+
+static PaError AddStream( PaJackStream *stream )
+{
+    PaError result = paNoError;
+    PaJackHostApiRepresentation *hostApi = stream->hostApi;
+
+    /* Add to queue of streams that should be processed */
+    ENSURE_PA( SendCommand( hostApi, PaJackCommand_Add, stream ) );
 
     UNLESS( !hostApi->jackIsDown, paDeviceUnavailable );
 
@@ -1042,18 +1215,8 @@ error:
 static PaError RemoveStream( PaJackStream *stream )
 {
     PaError result = paNoError;
-    PaJackHostApiRepresentation *hostApi = stream->hostApi;
 
-    /* Add to queue over streams that should be processed */
-    ASSERT_CALL( pthread_mutex_lock( &hostApi->mtx ), 0 );
-    if( !hostApi->jackIsDown )
-    {
-        hostApi->toRemove = stream;
-        /* Unlock mutex and await signal from processing thread */
-        result = WaitCondition( stream->hostApi );
-    }
-    ASSERT_CALL( pthread_mutex_unlock( &hostApi->mtx ), 0 );
-    ENSURE_PA( result );
+    ENSURE_PA( SendCommand( stream->hostApi, PaJackCommand_Remove, stream ) );
 
 error:
     return result;
@@ -1118,8 +1281,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
             return paInvalidChannelCount;
 
         /* validate inputStreamInfo */
-        if( inputParameters->hostApiSpecificStreamInfo )
-            return paIncompatibleHostApiSpecificStreamInfo; /* this implementation doesn't use custom stream info */
+        if( inputParameters->hostApiSpecificStreamInfo && !IsValidStreamInfo( inputParameters ) )
+            return paIncompatibleHostApiSpecificStreamInfo;
     }
     else
     {
@@ -1142,8 +1305,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
             return paInvalidChannelCount;
 
         /* validate outputStreamInfo */
-        if( outputParameters->hostApiSpecificStreamInfo )
-            return paIncompatibleHostApiSpecificStreamInfo; /* this implementation doesn't use custom stream info */
+        if( outputParameters->hostApiSpecificStreamInfo && !IsValidStreamInfo( outputParameters ) )
+            return paIncompatibleHostApiSpecificStreamInfo;
     }
     else
     {
@@ -1158,30 +1321,27 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
        return paInvalidSampleRate;
 #undef ABS
 
-    UNLESS( stream = (PaJackStream*)PaUtil_AllocateMemory( sizeof(PaJackStream) ), paInsufficientMemory );
+    UNLESS( stream = (PaJackStream*)PaUtil_AllocateTaggedMemory( sizeof(PaJackStream), paMemoryHostApiStream ), paInsufficientMemory );
     ENSURE_PA( InitializeStream( stream, jackHostApi, inputChannelCount, outputChannelCount ) );
+    stream->lockMemory = (streamFlags & paLockStreamMemory) != 0;
 
     /* the blocking emulation, if necessary */
-    stream->isBlockingStream = !streamCallback;
-    if( stream->isBlockingStream )
+    if( !streamCallback )
     {
-        float latency = 0.001; /* 1ms is the absolute minimum we support */
-        int   minimum_buffer_frames = 0;
+        long inputFIFOFrames = 0, outputFIFOFrames = 0, readWakeupFrames = 0, writeWakeupFrames = 0;
 
-        if( inputParameters && inputParameters->suggestedLatency > latency )
-            latency = inputParameters->suggestedLatency;
-        else if( outputParameters && outputParameters->suggestedLatency > latency )
-            latency = outputParameters->suggestedLatency;
+        if( inputParameters )
+            ENSURE_PA( GetBlockingParameters( inputParameters, jackHostApi->jack_buffer_size, jackSr,
+                        &inputFIFOFrames, &readWakeupFrames ) );
+        if( outputParameters )
+            ENSURE_PA( GetBlockingParameters( outputParameters, jackHostApi->jack_buffer_size, jackSr,
+                        &outputFIFOFrames, &writeWakeupFrames ) );
 
-        /* the latency the user asked for indicates the minimum buffer size in frames */
-        minimum_buffer_frames = (int) (latency * jack_get_sample_rate( jackHostApi->jack_client ));
-
-        /* we also need to be able to store at least three full jack buffers to avoid dropouts */
-        if( jackHostApi->jack_buffer_size * 3 > minimum_buffer_frames )
-            minimum_buffer_frames = jackHostApi->jack_buffer_size * 3;
-
-        /* setup blocking API data structures (FIXME: can fail) */
-        BlockingBegin( stream, minimum_buffer_frames );
+        /* setup blocking API data structures */
+        stream->isBlockingStream = 1;
+        ENSURE_PA( BlockingBegin( stream, inputFIFOFrames, outputFIFOFrames ) );
+        stream->readWakeupBytes = readWakeupFrames * stream->bytesPerFrame;
+        stream->writeWakeupBytes = writeWakeupFrames * stream->bytesPerFrame;
 
         /* install our own callback for the blocking API */
         streamCallback = BlockingCallback;
@@ -1197,6 +1357,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     }
     srInitialized = 1;
     PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, jackSr );
+    stream->streamRepresentation.cpuLoadMeasurer = &stream->cpuLoadMeasurer;
+    stream->streamRepresentation.bufferProcessor = &stream->bufferProcessor;
 
     /* create the JACK ports.  We cannot connect them until audio
      * processing begins */
@@ -1293,18 +1455,44 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                   userData ) );
     bpInitialized = 1;
 
+    /* Bypass the buffer processor altogether when the user's format is JACK's own and buffers line up */
+    if( !stream->isBlockingStream
+            && (!inputParameters || inputSampleFormat == (paFloat32 | paNonInterleaved))
+            && (!outputParameters || outputSampleFormat == (paFloat32 | paNonInterleaved))
+            && (framesPerBuffer == paFramesPerBufferUnspecified
+                || framesPerBuffer == (unsigned long)jackHostApi->jack_buffer_size) )
+    {
+        if( inputChannelCount > 0 )
+            UNLESS( stream->directInputBuffers = (const jack_default_audio_sample_t**) PaUtil_GroupAllocateMemory(
+                        stream->stream_memory, sizeof(jack_default_audio_sample_t*) * inputChannelCount ),
+                    paInsufficientMemory );
+        if( outputChannelCount > 0 )
+            UNLESS( stream->directOutputBuffers = (jack_default_audio_sample_t**) PaUtil_GroupAllocateMemory(
+                        stream->stream_memory, sizeof(jack_default_audio_sample_t*) * outputChannelCount ),
+                    paInsufficientMemory );
+
+        stream->directFramesPerBuffer = framesPerBuffer == paFramesPerBufferUnspecified ? 0 : framesPerBuffer;
+        stream->directCallback = 1;
+        PA_DEBUG(( "%s: Using zero-copy processing\n", __FUNCTION__ ));
+    }
+
     if( stream->num_incoming_connections > 0 )
         stream->streamRepresentation.streamInfo.inputLatency = (jack_port_get_latency( stream->remote_output_ports[0] )
                 - jack_get_buffer_size( jackHostApi->jack_client )  /* One buffer is not counted as latency */
-            + PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor )) / sampleRate;
+            + (stream->directCallback ? 0 : PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor )))
+            / sampleRate;
     if( stream->num_outgoing_connections > 0 )
         stream->streamRepresentation.streamInfo.outputLatency = (jack_port_get_latency( stream->remote_input_ports[0] )
                 - jack_get_buffer_size( jackHostApi->jack_client )  /* One buffer is not counted as latency */
-            + PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor )) / sampleRate;
+            + (stream->directCallback ? 0 : PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor )))
+            / sampleRate;
 
     stream->streamRepresentation.streamInfo.sampleRate = jackSr;
     stream->t0 = jack_frame_time( jackHostApi->jack_client );   /* A: Time should run from Pa_OpenStream */
 
+    if( stream->lockMemory )
+        LockStreamMemory( stream );
+
     /* Add to queue of opened streams */
     ENSURE_PA( AddStream( stream ) );
 
@@ -1336,6 +1524,34 @@ error:
     return result;
 }
 
+/* Invoke the user callback on the JACK port buffers, without conversion or intermediate copies */
+static void ProcessDirect( PaJackStream *stream, jack_nframes_t frames, const PaStreamCallbackTimeInfo *timeInfo,
+        PaStreamCallbackFlags cbFlags )
+{
+    int chn;
+
+    for( chn = 0; chn < stream->num_incoming_connections; chn++ )
+        stream->directInputBuffers[chn] = (const jack_default_audio_sample_t*)
+            jack_port_get_buffer( stream->local_input_ports[chn], frames );
+    for( chn = 0; chn < stream->num_outgoing_connections; chn++ )
+        stream->directOutputBuffers[chn] = (jack_default_audio_sample_t*)
+            jack_port_get_buffer( stream->local_output_ports[chn], frames );
+
+    PaUtil_BeginDirectStreamCallback( &stream->bufferProcessor, cbFlags );
+    stream->callbackResult = stream->streamRepresentation.streamCallback(
+            stream->num_incoming_connections > 0 ? (const void *)stream->directInputBuffers : NULL,
+            stream->num_outgoing_connections > 0 ? (void *)stream->directOutputBuffers : NULL,
+            frames, timeInfo, cbFlags, stream->streamRepresentation.userData );
+    PaUtil_EndDirectStreamCallback( &stream->bufferProcessor, frames );
+
+    if( stream->callbackResult == paAbort )
+    {
+        /* Like the buffer processor, disregard the output of an aborting callback */
+        for( chn = 0; chn < stream->num_outgoing_connections; chn++ )
+            memset( stream->directOutputBuffers[chn], 0, sizeof (jack_default_audio_sample_t) * frames );
+    }
+}
+
 static PaError RealProcess( PaJackStream *stream, jack_nframes_t frames )
 {
     PaError result = paNoError;
@@ -1374,6 +1590,21 @@ static PaError RealProcess( PaJackStream *stream, jack_nframes_t frames )
         cbFlags = paOutputUnderflow | paInputOverflow;
         stream->xrun = FALSE;
     }
+    if( stream->directCallback )
+    {
+        if( !stream->directFramesPerBuffer || frames == stream->directFramesPerBuffer )
+        {
+            ProcessDirect( stream, frames, &timeInfo, cbFlags );
+            PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, frames );
+            goto end;
+        }
+
+        /* JACK's period no longer matches the user's buffer size, let the buffer processor adapt from now on. It
+         * hasn't been used so far, so there is no state to carry over. */
+        PA_DEBUG(( "%s: JACK buffer size changed, leaving zero-copy mode\n", __FUNCTION__ ));
+        stream->directCallback = 0;
+    }
+
     PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo,
             cbFlags );
 
@@ -1415,81 +1646,108 @@ end:
     return result;
 }
 
-/* Update the JACK callback's stream processing queue. */
+/* Carry out the requests queued by SendCommand. This runs in the JACK process callback, so only the lock-free
+ * command queue and a semaphore post are used to communicate with the main thread. */
 static PaError UpdateQueue( PaJackHostApiRepresentation *hostApi )
 {
     PaError result = paNoError;
-    int queueModified = 0;
     const double jackSr = jack_get_sample_rate( hostApi->jack_client );
-    int err;
+    PaJackCommand command;
 
-    if( (err = pthread_mutex_trylock( &hostApi->mtx )) != 0 )
+    while( PaUtil_ReadRingBuffer( &hostApi->commandQueue, &command, 1 ) == 1 )
     {
-        assert( err == EBUSY );
-        return paNoError;
-    }
+        PaJackStream *stream = command.stream;
 
-    if( hostApi->toAdd )
-    {
-        if( hostApi->processQueue )
-        {
-            PaJackStream *node = hostApi->processQueue;
-            /* Advance to end of queue */
-            while( node->next )
-                node = node->next;
+        /* Take the request, unless its requester has given up waiting and withdrawn it */
+        if( !PaUtil_AtomicCompareAndSwap( &hostApi->pendingCommandId, command.id, 0 ) )
+            continue;
 
-            node->next = hostApi->toAdd;
-        }
-        else
+        switch( command.type )
         {
-            /* The only queue entry. */
-            hostApi->processQueue = (PaJackStream *)hostApi->toAdd;
-        }
+        case PaJackCommand_Add:
+            if( hostApi->processQueue )
+            {
+                PaJackStream *node = hostApi->processQueue;
+                /* Advance to end of queue */
+                while( node->next )
+                    node = node->next;
 
-        /* If necessary, update stream state */
-        if( hostApi->toAdd->streamRepresentation.streamInfo.sampleRate != jackSr )
-            UpdateSampleRate( hostApi->toAdd, jackSr );
+                node->next = stream;
+            }
+            else
+            {
+                /* The only queue entry. */
+                hostApi->processQueue = stream;
+            }
 
-        hostApi->toAdd = NULL;
-        queueModified = 1;
-    }
-    if( hostApi->toRemove )
-    {
-        int removed = 0;
-        PaJackStream *node = hostApi->processQueue, *prev = NULL;
-        assert( hostApi->processQueue );
+            /* If necessary, update stream state */
+            if( stream->streamRepresentation.streamInfo.sampleRate != jackSr )
+                UpdateSampleRate( stream, jackSr );
+
+            /* JACK owns this thread, so its stack is pre-grown the first time a locked stream is added */
+            if( stream->lockMemory && !hostApi->stackPrefaulted )
+            {
+                PaUtil_PrefaultStack( PA_PREFAULT_STACK_SIZE );
+                hostApi->stackPrefaulted = 1;
+            }
+
+            ASSERT_CALL( sem_post( &hostApi->commandDone ), 0 );
+            break;
 
-        while( node )
+        case PaJackCommand_Remove:
         {
-            if( node == hostApi->toRemove )
+            int removed = 0;
+            PaJackStream *node = hostApi->processQueue, *prev = NULL;
+            assert( hostApi->processQueue );
+
+            while( node )
             {
-                if( prev )
-                    prev->next = node->next;
-                else
-                    hostApi->processQueue = (PaJackStream *)node->next;
+                if( node == stream )
+                {
+                    if( prev )
+                        prev->next = node->next;
+                    else
+                        hostApi->processQueue = (PaJackStream *)node->next;
 
-                removed = 1;
-                break;
+                    removed = 1;
+                    break;
+                }
+
+                prev = node;
+                node = node->next;
             }
+            UNLESS( removed, paInternalError );
+            PA_DEBUG(( "%s: Removed stream from processing queue\n", __FUNCTION__ ));
 
-            prev = node;
-            node = node->next;
+            ASSERT_CALL( sem_post( &hostApi->commandDone ), 0 );
+            break;
         }
-        UNLESS( removed, paInternalError );
-        hostApi->toRemove = NULL;
-        PA_DEBUG(( "%s: Removed stream from processing queue\n", __FUNCTION__ ));
-        queueModified = 1;
-    }
 
-    if( queueModified )
-    {
-        /* Signal that we've done what was asked of us */
-        ASSERT_CALL( pthread_cond_signal( &hostApi->cond ), 0 );
+        case PaJackCommand_Start:
+            PA_DEBUG(( "%s: Starting stream\n", __FUNCTION__ ));
+            stream->callbackResult = paContinue;
+            stream->isSilenced = 0;
+            stream->is_active = 1;
+
+            ASSERT_CALL( sem_post( &hostApi->commandDone ), 0 );
+            break;
+
+        /* Completion is signalled by JackCallback once the stream has become inactive */
+        case PaJackCommand_Stop:
+            stream->doStop = 1;
+            break;
+        case PaJackCommand_Abort:
+            stream->doAbort = 1;
+            break;
+        }
     }
 
-error:
-    ASSERT_CALL( pthread_mutex_unlock( &hostApi->mtx ), 0 );
+    return result;
 
+error:
+    /* Don't leave the requester waiting for the failed request */
+    hostApi->commandResult = result;
+    ASSERT_CALL( sem_post( &hostApi->commandDone ), 0 );
     return result;
 }
 
@@ -1499,11 +1757,16 @@ static int JackCallback( jack_nframes_t frames, void *userData )
     PaError result = paNoError;
     PaJackHostApiRepresentation *hostApi = (PaJackHostApiRepresentation *)userData;
     PaJackStream *stream = NULL;
+    PaUtilTrace *trace = PaUtil_GetStreamTrace();
     int xrun = hostApi->xrun;
     hostApi->xrun = 0;
 
     assert( hostApi );
 
+    PaUtil_TraceEvent( trace, "JACK process, %lu frames", (long)frames, 0, 0, 0 );
+    if( xrun )
+        PaUtil_TraceEvent( trace, "JACK xrun", 0, 0, 0, 0 );
+
     ENSURE_PA( UpdateQueue( hostApi ) );
 
     /* Process each stream */
@@ -1513,29 +1776,7 @@ static int JackCallback( jack_nframes_t frames, void *userData )
         if( xrun )  /* Don't override if already set */
             stream->xrun = 1;
 
-        /* See if this stream is to be started */
-        if( stream->doStart )
-        {
-            /* If we can't obtain a lock, we'll try next time */
-            int err = pthread_mutex_trylock( &stream->hostApi->mtx );
-            if( !err )
-            {
-                if( stream->doStart )   /* Could potentially change before obtaining the lock */
-                {
-                    stream->is_active = 1;
-                    stream->doStart = 0;
-                    PA_DEBUG(( "%s: Starting stream\n", __FUNCTION__ ));
-                    ASSERT_CALL( pthread_cond_signal( &stream->hostApi->cond ), 0 );
-                    stream->callbackResult = paContinue;
-                    stream->isSilenced = 0;
-                }
-
-                ASSERT_CALL( pthread_mutex_unlock( &stream->hostApi->mtx ), 0 );
-            }
-            else
-                assert( err == EBUSY );
-        }
-        else if( stream->doStop || stream->doAbort )    /* Should we stop/abort stream? */
+        if( stream->doStop || stream->doAbort )    /* Should we stop/abort stream? */
         {
             if( stream->callbackResult == paContinue )     /* Ok, make it stop */
             {
@@ -1567,16 +1808,8 @@ static int JackCallback( jack_nframes_t frames, void *userData )
             /* See if RealProcess has acted on the request */
             if( !stream->is_active )   /* Ok, signal to the main thread that we've carried out the operation */
             {
-                /* If we can't obtain a lock, we'll try next time */
-                int err = pthread_mutex_trylock( &stream->hostApi->mtx );
-                if( !err )
-                {
-                    stream->doStop = stream->doAbort = 0;
-                    ASSERT_CALL( pthread_cond_signal( &stream->hostApi->cond ), 0 );
-                    ASSERT_CALL( pthread_mutex_unlock( &stream->hostApi->mtx ), 0 );
-                }
-                else
-                    assert( err == EBUSY );
+                stream->doStop = stream->doAbort = 0;
+                ASSERT_CALL( sem_post( &hostApi->commandDone ), 0 );
             }
         }
     }
@@ -1594,6 +1827,7 @@ static PaError StartStream( PaStream *s )
 
     /* Ready the processor */
     PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    PaUtil_ResetBufferProcessorStatistics( &stream->bufferProcessor );
 
     /* Connect the ports. Note that the ports may already have been connected by someone else in
      * the meantime, in which case JACK returns EEXIST. */
@@ -1620,27 +1854,12 @@ static PaError StartStream( PaStream *s )
 
     stream->xrun = FALSE;
 
-    /* Enable processing */
-
-    ASSERT_CALL( pthread_mutex_lock( &stream->hostApi->mtx ), 0 );
-    stream->doStart = 1;
-
-    /* Wait for stream to be started */
-    result = WaitCondition( stream->hostApi );
-    /*
-    do
-    {
-        err = pthread_cond_timedwait( &stream->hostApi->cond, &stream->hostApi->mtx, &ts );
-    } while( !stream->is_active && !err );
-    */
+    /* Enable processing, and wait for stream to be started */
+    result = SendCommand( stream->hostApi, PaJackCommand_Start, stream );
     if( result != paNoError )   /* Something went wrong, call off the stream start */
-    {
-        stream->doStart = 0;
         stream->is_active = 0;  /* Cancel any processing */
-    }
-    ASSERT_CALL( pthread_mutex_unlock( &stream->hostApi->mtx ), 0 );
-
     ENSURE_PA( result );
+    UNLESS( !stream->hostApi->jackIsDown, paDeviceUnavailable );
 
     stream->is_running = TRUE;
     PA_DEBUG(( "%s: Stream started\n", __FUNCTION__ ));
@@ -1657,16 +1876,8 @@ static PaError RealStop( PaJackStream *stream, int abort )
     if( stream->isBlockingStream )
         BlockingWaitEmpty ( stream );
 
-    ASSERT_CALL( pthread_mutex_lock( &stream->hostApi->mtx ), 0 );
-    if( abort )
-        stream->doAbort = 1;
-    else
-        stream->doStop = 1;
-
     /* Wait for stream to be stopped */
-    result = WaitCondition( stream->hostApi );
-    ASSERT_CALL( pthread_mutex_unlock( &stream->hostApi->mtx ), 0 );
-    ENSURE_PA( result );
+    ENSURE_PA( SendCommand( stream->hostApi, abort ? PaJackCommand_Abort : PaJackCommand_Stop, stream ) );
 
     UNLESS( !stream->is_active, paInternalError );
 
@@ -1763,3 +1974,12 @@ PaError PaJack_GetClientName(const char** clientName)
 error:
     return result;
 }
+
+void PaJack_InitializeStreamInfo( PaJackStreamInfo *info )
+{
+    info->size = sizeof (PaJackStreamInfo);
+    info->hostApiType = paJACK;
+    info->version = 1;
+    info->fifoFrames = 0;
+    info->wakeupFrames = 0;
+}
@@ -60,6 +60,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/poll.h>
+#include <sys/mman.h>
 #include <limits.h>
 #include <semaphore.h>
 
@@ -89,6 +90,7 @@
 #include "pa_process.h"
 #include "pa_unix_util.h"
 #include "pa_debugprint.h"
+#include "pa_trace.h"
 
 static int sysErr_;
 static pthread_t mainThread_;
@@ -157,6 +159,16 @@ typedef struct
     double latency;
     unsigned long hostFrames, numBufs;
     void **userBuffers; /* For non-interleaved blocking */
+
+    /* The device buffer, if it could be memory mapped (see PaOssStreamComponent_SetUpMmap). The buffer processor
+     * then converts in place instead of going through buffer and read/write. */
+    unsigned char *mmapBuffer;
+    size_t mmapSize;
+    size_t mmapOffset;  /* Byte offset of the next frame to read or write */
+    long mmapFill;      /* Bytes queued for playback or not yet read from capture */
+    int mmapLastBytes;  /* count_info.bytes when last checking the device pointer */
+
+    struct pollfd *pfd; /* This component's entry in PaOssStream.pfds */
 } PaOssStreamComponent;
 
 /** Implementation specific representation of a PaStream.
@@ -185,11 +197,15 @@ typedef struct PaOssStream
     double sampleRate;
 
     int callbackMode;
+    int lockMemory;     /* Was the stream opened with paLockStreamMemory */
     volatile int callbackStop, callbackAbort;
 
     PaOssStreamComponent *capture, *playback;
     unsigned long pollTimeout;
+    struct pollfd pfds[2];  /* Capture first, then playback, set up once in PaOssStream_Configure */
+    int nfds;
     sem_t semaphore;
+    PaStreamCallbackFlags mmapXrunFlags;    /* Xruns detected by PaOssStreamComponent_GetMmapAvail */
 }
 PaOssStream;
 
@@ -243,9 +259,9 @@ PaError PaOSS_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
     PaError result = paNoError;
     PaOSSHostApiRepresentation *ossHostApi = NULL;
 
-    PA_UNLESS( ossHostApi = (PaOSSHostApiRepresentation*)PaUtil_AllocateMemory( sizeof(PaOSSHostApiRepresentation) ),
+    PA_UNLESS( ossHostApi = (PaOSSHostApiRepresentation*)PaUtil_AllocateTaggedMemory( sizeof(PaOSSHostApiRepresentation), paMemoryDeviceInfo ),
             paInsufficientMemory );
-    PA_UNLESS( ossHostApi->allocations = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+    PA_UNLESS( ossHostApi->allocations = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo ), paInsufficientMemory );
     ossHostApi->hostApiIndex = hostApiIndex;
 
     /* Initialize host API structure */
@@ -741,7 +757,7 @@ static PaError PaOssStreamComponent_Initialize( PaOssStreamComponent *component,
     if( !callbackMode && !component->userInterleaved )
     {
         /* Pre-allocate non-interleaved user provided buffers */
-        PA_UNLESS( component->userBuffers = PaUtil_AllocateMemory( sizeof (void *) * component->userChannelCount ),
+        PA_UNLESS( component->userBuffers = PaUtil_AllocateTaggedMemory( sizeof (void *) * component->userChannelCount, paMemoryHostApiStream ),
                 paInsufficientMemory );
     }
 
@@ -753,6 +769,8 @@ static void PaOssStreamComponent_Terminate( PaOssStreamComponent *component )
 {
     assert( component );
 
+    if( component->mmapBuffer )
+        munmap( component->mmapBuffer, component->mmapSize );
     if( component->fd >= 0 )
         close( component->fd );
     if( component->buffer )
@@ -841,6 +859,7 @@ static PaError PaOssStream_Initialize( PaOssStream *stream, const PaStreamParame
 
     memset( stream, 0, sizeof (PaOssStream) );
     stream->isStopped = 1;
+    stream->lockMemory = (streamFlags & paLockStreamMemory) != 0;
 
     PA_ENSURE( PaUtil_InitializeThreading( &stream->threading ) );
 
@@ -857,12 +876,12 @@ static PaError PaOssStream_Initialize( PaOssStream *stream, const PaStreamParame
     PA_ENSURE( OpenDevices( idevName, odevName, &idev, &odev ) );
     if( inputParameters )
     {
-        PA_UNLESS( stream->capture = PaUtil_AllocateMemory( sizeof (PaOssStreamComponent) ), paInsufficientMemory );
+        PA_UNLESS( stream->capture = PaUtil_AllocateTaggedMemory( sizeof (PaOssStreamComponent), paMemoryHostApiStream ), paInsufficientMemory );
         PA_ENSURE( PaOssStreamComponent_Initialize( stream->capture, inputParameters, callback != NULL, idev, idevName ) );
     }
     if( outputParameters )
     {
-        PA_UNLESS( stream->playback = PaUtil_AllocateMemory( sizeof (PaOssStreamComponent) ), paInsufficientMemory );
+        PA_UNLESS( stream->playback = PaUtil_AllocateTaggedMemory( sizeof (PaOssStreamComponent), paMemoryHostApiStream ), paInsufficientMemory );
         PA_ENSURE( PaOssStreamComponent_Initialize( stream->playback, outputParameters, callback != NULL, odev, odevName ) );
     }
 
@@ -1061,19 +1080,205 @@ static PaError PaOssStreamComponent_Configure( PaOssStreamComponent *component,
         component->numBufs = master->numBufs;
     }
 
-    PA_UNLESS( component->buffer = PaUtil_AllocateMemory( PaOssStreamComponent_BufferSize( component ) ),
+    PA_UNLESS( component->buffer = PaUtil_AllocateTaggedMemory( PaOssStreamComponent_BufferSize( component ), paMemoryHostApiStream ),
             paInsufficientMemory );
 
 error:
     return result;
 }
 
+/** Try memory mapping the device buffer of a component, for the callback thread to process in place.
+ *
+ * Memory mapping is optional, if the driver doesn't support it we silently stay with read/write. The two directions
+ * of a shared device can't be mapped separately, so those aren't mapped either.
+ */
+static PaError PaOssStreamComponent_SetUpMmap( PaOssStreamComponent *component, StreamMode streamMode )
+{
+    PaError result = paNoError;
+    int caps = 0;
+    audio_buf_info bufInfo;
+    void *buffer;
+
+    if( ioctl( component->fd, SNDCTL_DSP_GETCAPS, &caps ) < 0 || !(caps & DSP_CAP_MMAP) || !(caps & DSP_CAP_TRIGGER) )
+    {
+        PA_DEBUG(( "%s: %s doesn't support mmap\n", __FUNCTION__, component->devName ));
+        goto error;
+    }
+
+    ENSURE_( ioctl( component->fd, streamMode == StreamMode_In ? SNDCTL_DSP_GETISPACE : SNDCTL_DSP_GETOSPACE, &bufInfo ),
+            paUnanticipatedHostError );
+    /* The buffer must consist of whole host buffers, so that they are contiguous */
+    if( bufInfo.fragsize != (int)(component->hostFrames * PaOssStreamComponent_FrameSize( component )) )
+    {
+        PA_DEBUG(( "%s: Fragment size %d doesn't match host buffer size, not using mmap\n", __FUNCTION__, bufInfo.fragsize ));
+        goto error;
+    }
+
+    component->mmapSize = (size_t)bufInfo.fragstotal * bufInfo.fragsize;
+    buffer = mmap( NULL, component->mmapSize, streamMode == StreamMode_In ? PROT_READ : PROT_WRITE, MAP_SHARED,
+            component->fd, 0 );
+    if( buffer == MAP_FAILED )
+    {
+        PA_DEBUG(( "%s: Failed mapping %s: %s\n", __FUNCTION__, component->devName, strerror( errno ) ));
+        component->mmapSize = 0;
+        goto error;
+    }
+    component->mmapBuffer = (unsigned char *)buffer;
+    component->numBufs = bufInfo.fragstotal;
+    PA_DEBUG(( "%s: Mapped %lu bytes of %s\n", __FUNCTION__, (unsigned long)component->mmapSize, component->devName ));
+
+error:
+    return result;
+}
+
+/** Reset the positions in the mapped device buffer, before triggering the device.
+ *
+ * The playback buffer is filled with silence, so the device has one buffer's worth queued.
+ */
+static PaError PaOssStreamComponent_ResetMmap( PaOssStreamComponent *component, StreamMode streamMode )
+{
+    PaError result = paNoError;
+    count_info info;
+    unsigned long fragSize = component->hostFrames * PaOssStreamComponent_FrameSize( component );
+
+    ENSURE_( ioctl( component->fd, streamMode == StreamMode_In ? SNDCTL_DSP_GETIPTR : SNDCTL_DSP_GETOPTR, &info ),
+            paUnanticipatedHostError );
+    /* Keep to host buffer boundaries */
+    component->mmapOffset = info.ptr - info.ptr % fragSize;
+    component->mmapLastBytes = info.bytes;
+
+    if( streamMode == StreamMode_Out )
+    {
+        memset( component->mmapBuffer, component->hostFormat == paUInt8 ? 0x80 : 0, component->mmapSize );
+        component->mmapFill = component->mmapSize - info.ptr % fragSize;
+    }
+    else
+        component->mmapFill = info.ptr % fragSize;
+
+error:
+    return result;
+}
+
+/** Determine the number of frames that can be processed in the mapped device buffer.
+ *
+ * The device's byte counter tells how far it has advanced since we last looked. If it has consumed more than was
+ * queued for playback, or produced more than fits in the buffer for capture, an xrun is reported in flags and we
+ * resynchronize with the device pointer.
+ */
+static PaError PaOssStreamComponent_GetMmapAvail( PaOssStreamComponent *component, StreamMode streamMode,
+        int *available, PaStreamCallbackFlags *flags )
+{
+    PaError result = paNoError;
+    count_info info;
+    long advance;
+    unsigned long fragSize = component->hostFrames * PaOssStreamComponent_FrameSize( component );
+
+    ENSURE_( ioctl( component->fd, streamMode == StreamMode_In ? SNDCTL_DSP_GETIPTR : SNDCTL_DSP_GETOPTR, &info ),
+            paUnanticipatedHostError );
+    /* The byte counter may wrap at either 2^31 or 2^32 depending on the implementation */
+    advance = (long)((unsigned int)info.bytes - (unsigned int)component->mmapLastBytes) & 0x7fffffff;
+    component->mmapLastBytes = info.bytes;
+
+    if( streamMode == StreamMode_Out )
+    {
+        component->mmapFill -= advance;
+        if( component->mmapFill < 0 )
+        {
+            /* Continue one host buffer ahead of the device */
+            *flags |= paOutputUnderflow;
+            component->mmapOffset = (info.ptr - info.ptr % fragSize + fragSize) % component->mmapSize;
+            component->mmapFill = fragSize - info.ptr % fragSize;
+        }
+        *available = (component->mmapSize - component->mmapFill) / PaOssStreamComponent_FrameSize( component );
+    }
+    else
+    {
+        component->mmapFill += advance;
+        if( component->mmapFill > (long)component->mmapSize )
+        {
+            /* Continue with the host buffer being captured */
+            *flags |= paInputOverflow;
+            component->mmapOffset = info.ptr - info.ptr % fragSize;
+            component->mmapFill = info.ptr % fragSize;
+        }
+        *available = component->mmapFill / PaOssStreamComponent_FrameSize( component );
+    }
+
+error:
+    return result;
+}
+
+/** Wait until the output queued in the mapped device buffer has been played.
+ *
+ * The rest of the buffer is silenced first, since the device keeps looping through it until it is disabled. Gives up
+ * if the device stops advancing.
+ */
+static PaError PaOssStreamComponent_DrainMmap( PaOssStreamComponent *component, double sampleRate )
+{
+    PaError result = paNoError;
+    int frameSize = PaOssStreamComponent_FrameSize( component ), available;
+    size_t silenceOffset = component->mmapOffset, silenceBytes = component->mmapSize - component->mmapFill;
+    long lastFill = -1;
+    PaStreamCallbackFlags flags = 0;
+
+    while( silenceBytes > 0 )
+    {
+        size_t bytes = PA_MIN( silenceBytes, component->mmapSize - silenceOffset );
+        memset( component->mmapBuffer + silenceOffset, component->hostFormat == paUInt8 ? 0x80 : 0, bytes );
+        silenceOffset = (silenceOffset + bytes) % component->mmapSize;
+        silenceBytes -= bytes;
+    }
+
+    for( ;; )
+    {
+        PA_ENSURE( PaOssStreamComponent_GetMmapAvail( component, StreamMode_Out, &available, &flags ) );
+        /* An underflow means the device has run past the queued output */
+        if( component->mmapFill <= 0 || (flags & paOutputUnderflow) || component->mmapFill == lastFill )
+            break;
+        lastFill = component->mmapFill;
+        Pa_Sleep( (long)ceil( 1000. * component->mmapFill / frameSize / sampleRate ) );
+    }
+
+error:
+    return result;
+}
+
+/** The number of frames that can be processed in one go, at most frames.
+ *
+ * Host buffers in the mapped device buffer wrap around at its end.
+ */
+static unsigned long PaOssStreamComponent_ContiguousFrames( PaOssStreamComponent *component, unsigned long frames )
+{
+    if( !component || !component->mmapBuffer )
+        return frames;
+    return PA_MIN( frames, (component->mmapSize - component->mmapOffset) / PaOssStreamComponent_FrameSize( component ) );
+}
+
+/** The address the buffer processor converts to or from. */
+static void *PaOssStreamComponent_Buffer( PaOssStreamComponent *component )
+{
+    return component->mmapBuffer ? component->mmapBuffer + component->mmapOffset : component->buffer;
+}
+
+/** Pass processed frames of the mapped device buffer to the device. */
+static void PaOssStreamComponent_AdvanceMmap( PaOssStreamComponent *component, StreamMode streamMode, unsigned long frames )
+{
+    size_t bytes = frames * PaOssStreamComponent_FrameSize( component );
+
+    component->mmapOffset = (component->mmapOffset + bytes) % component->mmapSize;
+    component->mmapFill += streamMode == StreamMode_Out ? (long)bytes : -(long)bytes;
+}
+
 static PaError PaOssStreamComponent_Read( PaOssStreamComponent *component, unsigned long *frames )
 {
     PaError result = paNoError;
     size_t len = *frames * PaOssStreamComponent_FrameSize( component );
     ssize_t bytesRead;
 
+    /* Mapped frames are processed in place, see PaOssStreamComponent_AdvanceMmap */
+    if( component->mmapBuffer )
+        return paNoError;
+
     ENSURE_( bytesRead = read( component->fd, component->buffer, len ), paUnanticipatedHostError );
     *frames = bytesRead / PaOssStreamComponent_FrameSize( component );
     /* TODO: Handle condition where number of frames read doesn't equal number of frames requested */
@@ -1088,6 +1293,12 @@ static PaError PaOssStreamComponent_Write( PaOssStreamComponent *component, unsi
     size_t len = *frames * PaOssStreamComponent_FrameSize( component );
     ssize_t bytesWritten;
 
+    if( component->mmapBuffer )
+    {
+        PaOssStreamComponent_AdvanceMmap( component, StreamMode_Out, *frames );
+        return paNoError;
+    }
+
     ENSURE_( bytesWritten = write( component->fd, component->buffer, len ), paUnanticipatedHostError );
     *frames = bytesWritten / PaOssStreamComponent_FrameSize( component );
     /* TODO: Handle condition where number of frames written doesn't equal number of frames requested */
@@ -1096,6 +1307,48 @@ error:
     return result;
 }
 
+/** Set the amount of data that wakes up a thread waiting on a component.
+ *
+ * By default the driver wakes us up for every fragment. The PA_OSS_LOW_WATER environment variable sets the threshold
+ * in frames instead, 0 meaning one user buffer. It is rounded up to whole host buffers, as that is what we process
+ * per wakeup, and limited to the buffer size minus one host buffer.
+ *
+ * This needs SNDCTL_DSP_LOW_WATER from OSS 4 (e.g. FreeBSD). The Linux kernel's OSS emulation doesn't provide it, so
+ * PA_OSS_LOW_WATER is ignored there. The threshold is only a hint: if the driver rejects it the stream still works
+ * with the default wakeups, so this never fails.
+ */
+static void PaOssStreamComponent_SetLowWater( PaOssStreamComponent *component, unsigned long framesPerBuffer,
+        unsigned long framesPerHostBuffer )
+{
+    const char *env = getenv( "PA_OSS_LOW_WATER" );
+#ifdef SNDCTL_DSP_LOW_WATER
+    long frames;
+    int bytes;
+#endif
+
+    if( !env )
+        return;
+
+#ifdef SNDCTL_DSP_LOW_WATER
+    frames = atol( env );
+    if( frames == 0 )
+        frames = framesPerBuffer == paFramesPerBufferUnspecified ? (long)framesPerHostBuffer : (long)framesPerBuffer;
+    frames = ((frames + framesPerHostBuffer - 1) / framesPerHostBuffer) * framesPerHostBuffer;
+    frames = PA_MAX( PA_MIN( frames, (long)(component->hostFrames * (component->numBufs - 1)) ), (long)framesPerHostBuffer );
+    bytes = frames * PaOssStreamComponent_FrameSize( component );
+
+    if( ioctl( component->fd, SNDCTL_DSP_LOW_WATER, &bytes ) < 0 )
+    {
+        PA_DEBUG(( "%s: Failed setting low water mark of %s to %ld frames: %s\n", __FUNCTION__, component->devName,
+                    frames, strerror( errno ) ));
+        return;
+    }
+    PA_DEBUG(( "%s: Low water mark of %s set to %ld frames\n", __FUNCTION__, component->devName, frames ));
+#else
+    PA_DEBUG(( "%s: SNDCTL_DSP_LOW_WATER isn't available, ignoring PA_OSS_LOW_WATER\n", __FUNCTION__ ));
+#endif
+}
+
 /** Configure the stream according to input/output parameters.
  *
  * Aspect StreamChannels: The minimum number of channels supported by the device may exceed that requested by
@@ -1120,8 +1373,6 @@ static PaError PaOssStream_Configure( PaOssStream *stream, double sampleRate, un
 
         assert( component->hostChannelCount > 0 );
         assert( component->hostFrames > 0 );
-
-        *inputLatency = (component->hostFrames * (component->numBufs - 1)) / sampleRate;
     }
     if( stream->playback )
     {
@@ -1131,10 +1382,22 @@ static PaError PaOssStream_Configure( PaOssStream *stream, double sampleRate, un
 
         assert( component->hostChannelCount > 0 );
         assert( component->hostFrames > 0 );
+    }
 
-        *outputLatency = (component->hostFrames * (component->numBufs - 1)) / sampleRate;
+    if( stream->callbackMode && !stream->sharedDevice )
+    {
+        if( stream->capture )
+            PA_ENSURE( PaOssStreamComponent_SetUpMmap( stream->capture, StreamMode_In ) );
+        if( stream->playback )
+            PA_ENSURE( PaOssStreamComponent_SetUpMmap( stream->playback, StreamMode_Out ) );
     }
 
+    /* Mapping the buffers may change the number of fragments */
+    if( stream->capture )
+        *inputLatency = (stream->capture->hostFrames * (stream->capture->numBufs - 1)) / sampleRate;
+    if( stream->playback )
+        *outputLatency = (stream->playback->hostFrames * (stream->playback->numBufs - 1)) / sampleRate;
+
     if( duplex )
         framesPerHostBuffer = PA_MIN( stream->capture->hostFrames, stream->playback->hostFrames );
     else if( stream->capture )
@@ -1145,12 +1408,60 @@ static PaError PaOssStream_Configure( PaOssStream *stream, double sampleRate, un
     stream->framesPerHostBuffer = framesPerHostBuffer;
     stream->pollTimeout = (int) ceil( 1e6 * framesPerHostBuffer / sampleRate );    /* Period in usecs, rounded up */
 
+    /* The descriptors to poll are registered once, see PaOssStream_WaitForFrames */
+    stream->nfds = 0;
+    if( stream->capture )
+    {
+        PaOssStreamComponent_SetLowWater( stream->capture, framesPerBuffer, framesPerHostBuffer );
+        stream->capture->pfd = &stream->pfds[stream->nfds++];
+        stream->capture->pfd->fd = stream->capture->fd;
+        stream->capture->pfd->events = POLLIN;
+    }
+    if( stream->playback )
+    {
+        PaOssStreamComponent_SetLowWater( stream->playback, framesPerBuffer, framesPerHostBuffer );
+        stream->playback->pfd = &stream->pfds[stream->nfds++];
+        stream->playback->pfd->fd = stream->playback->fd;
+        stream->playback->pfd->events = POLLOUT;
+    }
+
     stream->sampleRate = stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
 
 error:
     return result;
 }
 
+/** Prefault and lock the memory used by the audio thread, for paLockStreamMemory.
+ *
+ * A memory mapped device buffer is left alone, the capture mapping is read-only and the pages belong to the driver.
+ */
+static void PaOssStream_LockMemory( PaOssStream *stream )
+{
+    unsigned long lockedSize = stream->bufferProcessor.lockedMemorySize;
+    PaOssStreamComponent *components[2];
+    int i;
+
+    components[0] = stream->capture;
+    components[1] = stream->playback;
+
+    lockedSize += PaUtil_LockMemory( stream, sizeof (PaOssStream) );
+    for( i = 0; i < 2; ++i )
+    {
+        PaOssStreamComponent *component = components[i];
+        if( !component )
+            continue;
+
+        lockedSize += PaUtil_LockMemory( component, sizeof (PaOssStreamComponent) );
+        if( component->buffer )
+            lockedSize += PaUtil_LockMemory( component->buffer, PaOssStreamComponent_BufferSize( component ) );
+        if( component->userBuffers )
+            lockedSize += PaUtil_LockMemory( component->userBuffers, sizeof (void *) * component->userChannelCount );
+    }
+
+    PA_DEBUG(( "%s: Locked %lu bytes of stream memory\n", __FUNCTION__, lockedSize ));
+    stream->streamRepresentation.streamInfo.lockedMemorySize = lockedSize;
+}
+
 /* see pa_hostapi.h for a list of validity guarantees made about OpenStream parameters */
 
 /** Open a PA OSS stream.
@@ -1230,12 +1541,14 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     }
 
     /* allocate and do basic initialization of the stream structure */
-    PA_UNLESS( stream = (PaOssStream*)PaUtil_AllocateMemory( sizeof(PaOssStream) ), paInsufficientMemory );
+    PA_UNLESS( stream = (PaOssStream*)PaUtil_AllocateTaggedMemory( sizeof(PaOssStream), paMemoryHostApiStream ), paInsufficientMemory );
     PA_ENSURE( PaOssStream_Initialize( stream, inputParameters, outputParameters, streamCallback, userData, streamFlags, ossHostApi ) );
 
     PA_ENSURE( PaOssStream_Configure( stream, sampleRate, framesPerBuffer, &inLatency, &outLatency ) );
 
     PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+    stream->streamRepresentation.cpuLoadMeasurer = &stream->cpuLoadMeasurer;
+    stream->streamRepresentation.bufferProcessor = &stream->bufferProcessor;
 
     if( inputParameters )
     {
@@ -1260,6 +1573,9 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
               paUtilFixedHostBufferSize, streamCallback, userData ) );
     bpInitialized = 1;
 
+    if( stream->lockMemory )
+        PaOssStream_LockMemory( stream );
+
     *s = (PaStream*)stream;
 
     return result;
@@ -1289,11 +1605,8 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
     int pollPlayback = 0, pollCapture = 0;
     int captureAvail = INT_MAX, playbackAvail = INT_MAX, commonAvail;
     audio_buf_info bufInfo;
-    /* int ofs = 0, nfds = stream->nfds; */
-    fd_set readFds, writeFds;
-    int nfds = 0;
-    struct timeval selectTimeval = {0, 0};
-    unsigned long timeout = stream->pollTimeout;    /* In usecs */
+    int ofs = 0, nfds = stream->nfds;
+    int timeout = (int)((stream->pollTimeout + 999) / 1000);    /* poll() wants msecs, rounded up */
     int captureFd = -1, playbackFd = -1;
 
     assert( stream );
@@ -1303,18 +1616,13 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
     {
         pollCapture = 1;
         captureFd = stream->capture->fd;
-        /* stream->capture->pfd->events = POLLIN; */
     }
     if( stream->playback )
     {
         pollPlayback = 1;
         playbackFd = stream->playback->fd;
-        /* stream->playback->pfd->events = POLLOUT; */
     }
 
-    FD_ZERO( &readFds );
-    FD_ZERO( &writeFds );
-
     while( pollPlayback || pollCapture )
     {
 #ifdef PTHREAD_CANCELED
@@ -1329,28 +1637,13 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
         }
 #endif
 
-        /* select may modify the timeout parameter */
-        selectTimeval.tv_usec = timeout;
-        nfds = 0;
-
-        if( pollCapture )
-        {
-            FD_SET( captureFd, &readFds );
-            nfds = captureFd + 1;
-        }
-        if( pollPlayback )
+        /* Only the directions we're still waiting for are polled, capture precedes playback in pfds */
+        if( poll( stream->pfds + ofs, nfds, timeout ) < 0 )
         {
-            FD_SET( playbackFd, &writeFds );
-            nfds = PA_MAX( nfds, playbackFd + 1 );
-        }
-        ENSURE_( select( nfds, &readFds, &writeFds, NULL, &selectTimeval ), paUnanticipatedHostError );
-        /*
-        if( poll( stream->pfds + ofs, nfds, stream->pollTimeout ) < 0 )
-        {
-
+            if( errno == EINTR )
+                continue;
             ENSURE_( -1, paUnanticipatedHostError );
         }
-        */
 #ifdef PTHREAD_CANCELED
         pthread_testcancel();
 #else
@@ -1362,21 +1655,18 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
             return paNoError;
         }
 #endif
+        /* A device that has gone away keeps reporting these, polling again would just spin */
+        PA_UNLESS( !pollCapture || !(stream->capture->pfd->revents & (POLLHUP | POLLNVAL)), paDeviceUnavailable );
+        PA_UNLESS( !pollPlayback || !(stream->playback->pfd->revents & (POLLHUP | POLLNVAL)), paDeviceUnavailable );
+
         if( pollCapture )
         {
-            if( FD_ISSET( captureFd, &readFds ) )
-            {
-                FD_CLR( captureFd, &readFds );
-                pollCapture = 0;
-            }
-            /*
-            if( stream->capture->pfd->revents & POLLIN )
+            if( stream->capture->pfd->revents & (POLLIN | POLLERR) )
             {
                 --nfds;
                 ++ofs;
                 pollCapture = 0;
             }
-            */
             else if( stream->playback ) /* Timed out, go on with playback? */
             {
                 /*PA_DEBUG(( "%s: Trying to poll again for capture frames, pollTimeout: %d\n",
@@ -1385,18 +1675,11 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
         }
         if( pollPlayback )
         {
-            if( FD_ISSET( playbackFd, &writeFds ) )
-            {
-                FD_CLR( playbackFd, &writeFds );
-                pollPlayback = 0;
-            }
-            /*
-            if( stream->playback->pfd->revents & POLLOUT )
+            if( stream->playback->pfd->revents & (POLLOUT | POLLERR) )
             {
                 --nfds;
                 pollPlayback = 0;
             }
-            */
             else if( stream->capture )  /* Timed out, go on with capture? */
             {
                 /*PA_DEBUG(( "%s: Trying to poll again for playback frames, pollTimeout: %d\n\n",
@@ -1407,8 +1690,16 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
 
     if( stream->capture )
     {
-        ENSURE_( ioctl( captureFd, SNDCTL_DSP_GETISPACE, &bufInfo ), paUnanticipatedHostError );
-        captureAvail = bufInfo.fragments * stream->capture->hostFrames;
+        if( stream->capture->mmapBuffer )
+        {
+            PA_ENSURE( PaOssStreamComponent_GetMmapAvail( stream->capture, StreamMode_In, &captureAvail,
+                        &stream->mmapXrunFlags ) );
+        }
+        else
+        {
+            ENSURE_( ioctl( captureFd, SNDCTL_DSP_GETISPACE, &bufInfo ), paUnanticipatedHostError );
+            captureAvail = bufInfo.fragments * stream->capture->hostFrames;
+        }
         if( !captureAvail )
             PA_DEBUG(( "%s: captureAvail: 0\n", __FUNCTION__ ));
 
@@ -1416,8 +1707,16 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
     }
     if( stream->playback )
     {
-        ENSURE_( ioctl( playbackFd, SNDCTL_DSP_GETOSPACE, &bufInfo ), paUnanticipatedHostError );
-        playbackAvail = bufInfo.fragments * stream->playback->hostFrames;
+        if( stream->playback->mmapBuffer )
+        {
+            PA_ENSURE( PaOssStreamComponent_GetMmapAvail( stream->playback, StreamMode_Out, &playbackAvail,
+                        &stream->mmapXrunFlags ) );
+        }
+        else
+        {
+            ENSURE_( ioctl( playbackFd, SNDCTL_DSP_GETOSPACE, &bufInfo ), paUnanticipatedHostError );
+            playbackAvail = bufInfo.fragments * stream->playback->hostFrames;
+        }
         if( !playbackAvail )
         {
             PA_DEBUG(( "%s: playbackAvail: 0\n", __FUNCTION__ ));
@@ -1457,7 +1756,15 @@ static PaError PaOssStream_Prepare( PaOssStream *stream )
     if( stream->capture )
         ENSURE_( ioctl( stream->capture->fd, SNDCTL_DSP_SETTRIGGER, &enableBits ), paUnanticipatedHostError );
 
-    if( stream->playback )
+    if( stream->capture && stream->capture->mmapBuffer )
+        PA_ENSURE( PaOssStreamComponent_ResetMmap( stream->capture, StreamMode_In ) );
+
+    if( stream->playback && stream->playback->mmapBuffer )
+    {
+        /* The mapped buffer is filled in place, rather than by writing */
+        PA_ENSURE( PaOssStreamComponent_ResetMmap( stream->playback, StreamMode_Out ) );
+    }
+    else if( stream->playback )
     {
         size_t bufSz = PaOssStreamComponent_BufferSize( stream->playback );
         memset( stream->playback->buffer, 0, bufSz );
@@ -1525,6 +1832,22 @@ static PaError PaOssStream_Stop( PaOssStream *stream, int abort )
         }
     }
 
+    /* Mapped buffers are played in a loop till the device is disabled, it has to be triggered again when restarting */
+    if( (stream->capture && stream->capture->mmapBuffer) || (stream->playback && stream->playback->mmapBuffer) )
+    {
+        int enableBits = 0;
+        /* Disabling the device discards queued output, let it play out unless aborting */
+        if( !abort && stream->playback && stream->playback->mmapBuffer && stream->triggered &&
+                PaOssStreamComponent_DrainMmap( stream->playback, stream->streamRepresentation.streamInfo.sampleRate )
+                != paNoError )
+            playbackErr = -1;
+        if( stream->capture && ioctl( stream->capture->fd, SNDCTL_DSP_SETTRIGGER, &enableBits ) < 0 )
+            captureErr = -1;
+        if( stream->playback && ioctl( stream->playback->fd, SNDCTL_DSP_SETTRIGGER, &enableBits ) < 0 )
+            playbackErr = -1;
+        stream->triggered = 0;
+    }
+
     if( captureErr || playbackErr )
     {
         result = paUnanticipatedHostError;
@@ -1543,6 +1866,7 @@ static void OnExit( void *data )
     assert( data );
 
     PaUtil_ResetCpuLoadMeasurer( &stream->cpuLoadMeasurer );
+    PaUtil_ReleaseTraceThread( stream->bufferProcessor.trace );
 
     PaOssStream_Stop( stream, stream->callbackAbort );
 
@@ -1562,13 +1886,13 @@ static PaError SetUpBuffers( PaOssStream *stream, unsigned long framesAvail )
 
     if( stream->capture )
     {
-        PaUtil_SetInterleavedInputChannels( &stream->bufferProcessor, 0, stream->capture->buffer,
+        PaUtil_SetInterleavedInputChannels( &stream->bufferProcessor, 0, PaOssStreamComponent_Buffer( stream->capture ),
                 stream->capture->hostChannelCount );
         PaUtil_SetInputFrameCount( &stream->bufferProcessor, framesAvail );
     }
     if( stream->playback )
     {
-        PaUtil_SetInterleavedOutputChannels( &stream->bufferProcessor, 0, stream->playback->buffer,
+        PaUtil_SetInterleavedOutputChannels( &stream->bufferProcessor, 0, PaOssStreamComponent_Buffer( stream->playback ),
                 stream->playback->hostChannelCount );
         PaUtil_SetOutputFrameCount( &stream->bufferProcessor, framesAvail );
     }
@@ -1602,6 +1926,9 @@ static void *PaOSS_AudioThreadProc( void *userData )
 
     assert( stream );
 
+    if( stream->lockMemory )
+        PaUtil_PrefaultStack( PA_PREFAULT_STACK_SIZE );
+
     pthread_cleanup_push( &OnExit, stream );	/* Execute OnExit when exiting */
 
     /* The first time the stream is started we use SNDCTL_DSP_TRIGGER to accurately start capture and
@@ -1646,6 +1973,7 @@ static void *PaOSS_AudioThreadProc( void *userData )
         {
             /* Wait on available frames */
             PA_ENSURE( PaOssStream_WaitForFrames( stream, &framesAvail ) );
+            PaUtil_TraceEvent( stream->bufferProcessor.trace, "wakeup, %lu frames available", framesAvail, 0, 0, 0 );
             assert( framesAvail % stream->framesPerHostBuffer == 0 );
         }
         else
@@ -1655,7 +1983,10 @@ static void *PaOSS_AudioThreadProc( void *userData )
 
         while( framesAvail > 0 )
         {
-            unsigned long frames = framesAvail;
+            /* Process at most up to the end of mapped buffers */
+            unsigned long frames = PaOssStreamComponent_ContiguousFrames( stream->capture,
+                    PaOssStreamComponent_ContiguousFrames( stream->playback, framesAvail ) );
+            unsigned long framesRead = frames;
 
 #ifdef PTHREAD_CANCELED
             pthread_testcancel();
@@ -1677,11 +2008,11 @@ static void *PaOSS_AudioThreadProc( void *userData )
             /* Read data */
             if ( stream->capture )
             {
-                PA_ENSURE( PaOssStreamComponent_Read( stream->capture, &frames ) );
-                if( frames < framesAvail )
+                PA_ENSURE( PaOssStreamComponent_Read( stream->capture, &framesRead ) );
+                if( framesRead < frames )
                 {
-                    PA_DEBUG(( "Read %lu less frames than requested\n", framesAvail - frames ));
-                    framesAvail = frames;
+                    PA_DEBUG(( "Read %lu less frames than requested\n", frames - framesRead ));
+                    framesAvail = frames = framesRead;
                 }
             }
 
@@ -1703,25 +2034,34 @@ static void *PaOSS_AudioThreadProc( void *userData )
                 */
 #endif
 
+            if( stream->mmapXrunFlags )
+                PaUtil_TraceEvent( stream->bufferProcessor.trace, "mmap xrun", 0, 0, 0, 0 );
+            cbFlags |= stream->mmapXrunFlags;
+            stream->mmapXrunFlags = 0;
             PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo,
                     cbFlags );
             cbFlags = 0;
-            PA_ENSURE( SetUpBuffers( stream, framesAvail ) );
+            PA_ENSURE( SetUpBuffers( stream, frames ) );
 
             framesProcessed = PaUtil_EndBufferProcessing( &stream->bufferProcessor,
                     &callbackResult );
-            assert( framesProcessed == framesAvail );
+            assert( framesProcessed == frames );
             PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
 
+            if( stream->capture && stream->capture->mmapBuffer )
+                PaOssStreamComponent_AdvanceMmap( stream->capture, StreamMode_In, framesProcessed );
+
             if ( stream->playback )
             {
-                frames = framesAvail;
+                unsigned long framesWritten = frames;
 
-                PA_ENSURE( PaOssStreamComponent_Write( stream->playback, &frames ) );
-                if( frames < framesAvail )
+                PaUtil_TraceBegin( stream->bufferProcessor.trace, "commit host buffer" );
+                PA_ENSURE( PaOssStreamComponent_Write( stream->playback, &framesWritten ) );
+                PaUtil_TraceEnd( stream->bufferProcessor.trace, "commit host buffer" );
+                if( framesWritten < frames )
                 {
                     /* TODO: handle bytesWritten != bytesRequested (slippage?) */
-                    PA_DEBUG(( "Wrote %lu less frames than requested\n", framesAvail - frames ));
+                    PA_DEBUG(( "Wrote %lu less frames than requested\n", frames - framesWritten ));
                 }
             }
 
@@ -1790,6 +2130,7 @@ static PaError StartStream( PaStream *s )
     stream->lastPosPtr = 0;
     stream->lastStreamBytes = 0;
     stream->framesProcessed = 0;
+    PaUtil_ResetBufferProcessorStatistics( &stream->bufferProcessor );
 
     /* only use the thread for callback streams */
     if( stream->bufferProcessor.streamCallback )
@@ -130,14 +130,14 @@ PaError PaSkeleton_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiI
     PaSkeletonHostApiRepresentation *skeletonHostApi;
     PaDeviceInfo *deviceInfoArray;
 
-    skeletonHostApi = (PaSkeletonHostApiRepresentation*)PaUtil_AllocateMemory( sizeof(PaSkeletonHostApiRepresentation) );
+    skeletonHostApi = (PaSkeletonHostApiRepresentation*)PaUtil_AllocateTaggedMemory( sizeof(PaSkeletonHostApiRepresentation), paMemoryDeviceInfo );
     if( !skeletonHostApi )
     {
         result = paInsufficientMemory;
         goto error;
     }
 
-    skeletonHostApi->allocations = PaUtil_CreateAllocationGroup();
+    skeletonHostApi->allocations = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo );
     if( !skeletonHostApi->allocations )
     {
         result = paInsufficientMemory;
@@ -477,7 +477,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         return paInvalidFlag; /* unexpected platform specific flag */
 
 
-    stream = (PaSkeletonStream*)PaUtil_AllocateMemory( sizeof(PaSkeletonStream) );
+    stream = (PaSkeletonStream*)PaUtil_AllocateTaggedMemory( sizeof(PaSkeletonStream), paMemoryHostApiStream );
     if( !stream )
     {
         result = paInsufficientMemory;
@@ -496,6 +496,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     }
 
     PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+    stream->streamRepresentation.cpuLoadMeasurer = &stream->cpuLoadMeasurer;
+    stream->streamRepresentation.bufferProcessor = &stream->bufferProcessor;
 
 
     /* we assume a fixed host buffer size in this example, but the buffer processor
@@ -660,6 +662,7 @@ static PaError StartStream( PaStream *s )
     PaSkeletonStream *stream = (PaSkeletonStream*)s;
 
     PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    PaUtil_ResetBufferProcessorStatistics( &stream->bufferProcessor );
 
     /* IMPLEMENT ME, see portaudio.h for required behavior */
 
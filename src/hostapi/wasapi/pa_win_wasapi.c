@@ -1074,7 +1074,7 @@ PaError PaWasapi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
         goto error;
     }
 
-    paWasapi->allocations = PaUtil_CreateAllocationGroup();
+    paWasapi->allocations = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo );
     if (paWasapi->allocations == NULL)
 	{
         result = paInsufficientMemory;
@@ -2935,6 +2935,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 
 	// Initialize CPU measurer
     PaUtil_InitializeCpuLoadMeasurer(&stream->cpuLoadMeasurer, sampleRate);
+    stream->streamRepresentation.cpuLoadMeasurer = &stream->cpuLoadMeasurer;
+    stream->streamRepresentation.bufferProcessor = &stream->bufferProcessor;
 
 	if (outputParameters && inputParameters)
 	{
@@ -3226,6 +3228,7 @@ static PaError StartStream( PaStream *s )
 		return paStreamIsNotStopped;
 
     PaUtil_ResetBufferProcessor(&stream->bufferProcessor);
+    PaUtil_ResetBufferProcessorStatistics(&stream->bufferProcessor);
 
 	// Cleanup handles (may be necessary if stream was stopped by itself due to error)
 	_StreamCleanup(stream);
@@ -3302,7 +3302,7 @@ static PaError InitNameHashObject(PaNameHashObject* obj, PaWinWdmFilter* pFilter
 {
     int i;
 
-    obj->allocGroup = PaUtil_CreateAllocationGroup();
+    obj->allocGroup = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo );
     if (obj->allocGroup == NULL)
     {
         return paInsufficientMemory;
@@ -3367,7 +3367,6 @@ static unsigned GetNameIndex(PaNameHashObject* obj, const wchar_t* name, const B
 
 static PaError ScanDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, PaHostApiIndex hostApiIndex, void **scanResults, int *newDeviceCount )
 {
-    PaWinWdmHostApiRepresentation *wdmHostApi = (PaWinWdmHostApiRepresentation*)hostApi;
     PaError result = paNoError;
     PaWinWdmFilter** ppFilters = 0;
     PaWinWDMScanDeviceInfosResults *outArgument = 0;
@@ -3387,9 +3386,10 @@ static PaError ScanDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, PaH
         int idxFilter;
         int i;
 
-        /* Allocate the out param for all the info we need */
-        outArgument = (PaWinWDMScanDeviceInfosResults *) PaUtil_GroupAllocateMemory(
-            wdmHostApi->allocations, sizeof(PaWinWDMScanDeviceInfosResults) );
+        /* Allocate the out param for all the info we need. The scan results aren't in the allocation group, since
+        they are freed individually by CommitDeviceInfos() and DisposeDeviceInfos() */
+        outArgument = (PaWinWDMScanDeviceInfosResults *) PaUtil_AllocateTaggedMemory(
+            sizeof(PaWinWDMScanDeviceInfosResults), paMemoryDeviceInfo );
         if( !outArgument )
         {
             result = paInsufficientMemory;
@@ -3399,22 +3399,24 @@ static PaError ScanDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, PaH
         outArgument->defaultInputDevice  = paNoDevice;
         outArgument->defaultOutputDevice = paNoDevice;
 
-        outArgument->deviceInfos = (PaDeviceInfo**)PaUtil_GroupAllocateMemory(
-            wdmHostApi->allocations, sizeof(PaDeviceInfo*) * totalDeviceCount );
+        outArgument->deviceInfos = (PaDeviceInfo**)PaUtil_AllocateTaggedMemory(
+            sizeof(PaDeviceInfo*) * totalDeviceCount, paMemoryDeviceInfo );
         if( !outArgument->deviceInfos )
         {
             result = paInsufficientMemory;
             goto error;
         }
+        memset( outArgument->deviceInfos, 0, sizeof(PaDeviceInfo*) * totalDeviceCount );
 
         /* allocate all device info structs in a contiguous block */
-        deviceInfoArray = (PaWinWdmDeviceInfo*)PaUtil_GroupAllocateMemory(
-            wdmHostApi->allocations, sizeof(PaWinWdmDeviceInfo) * totalDeviceCount );
+        deviceInfoArray = (PaWinWdmDeviceInfo*)PaUtil_AllocateTaggedMemory(
+            sizeof(PaWinWdmDeviceInfo) * totalDeviceCount, paMemoryDeviceInfo );
         if( !deviceInfoArray )
         {
             result = paInsufficientMemory;
             goto error;
         }
+        memset( deviceInfoArray, 0, sizeof(PaWinWdmDeviceInfo) * totalDeviceCount );
 
         /* Make sure all items in array */
         for( i = 0 ; i < totalDeviceCount; ++i )
@@ -3601,7 +3603,6 @@ error:
 
 static PaError CommitDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, PaHostApiIndex index, void *scanResults, int deviceCount )
 {
-    PaWinWdmHostApiRepresentation *wdmHostApi = (PaWinWdmHostApiRepresentation*)hostApi;
 
     hostApi->info.deviceCount = 0;
     hostApi->info.defaultInputDevice = paNoDevice;
@@ -3610,11 +3611,13 @@ static PaError CommitDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, P
     /* Free any old memory which might be in the device info */
     if( hostApi->deviceInfos )
     {
-        PaWinWDMScanDeviceInfosResults* localScanResults = (PaWinWDMScanDeviceInfosResults*)PaUtil_GroupAllocateMemory(
-            wdmHostApi->allocations, sizeof(PaWinWDMScanDeviceInfosResults));
-        localScanResults->deviceInfos = hostApi->deviceInfos;
-
-        DisposeDeviceInfos(hostApi, &localScanResults, hostApi->info.deviceCount);
+        PaWinWDMScanDeviceInfosResults* localScanResults = (PaWinWDMScanDeviceInfosResults*)PaUtil_AllocateTaggedMemory(
+            sizeof(PaWinWDMScanDeviceInfosResults), paMemoryDeviceInfo );
+        if( localScanResults )
+        {
+            localScanResults->deviceInfos = hostApi->deviceInfos;
+            DisposeDeviceInfos(hostApi, localScanResults, hostApi->info.deviceCount);
+        }
 
         hostApi->deviceInfos = NULL;
     }
@@ -3634,7 +3637,7 @@ static PaError CommitDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, P
             hostApi->info.deviceCount = deviceCount;
         }
 
-        PaUtil_GroupFreeMemory( wdmHostApi->allocations, scanDeviceInfosResults );
+        PaUtil_FreeMemory( scanDeviceInfosResults );
     }
 
     return paNoError;
@@ -3643,7 +3646,6 @@ static PaError CommitDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, P
 
 static PaError DisposeDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, void *scanResults, int deviceCount )
 {
-    PaWinWdmHostApiRepresentation *winDsHostApi = (PaWinWdmHostApiRepresentation*)hostApi;
 
     if( scanResults != NULL )
     {
@@ -3655,17 +3657,18 @@ static PaError DisposeDeviceInfos( struct PaUtilHostApiRepresentation *hostApi,
             for (i = 0; i < deviceCount; ++i)
             {
                 PaWinWdmDeviceInfo* pDevice = (PaWinWdmDeviceInfo*)scanDeviceInfosResults->deviceInfos[i];
-                if (pDevice->filter != 0)
+                if (pDevice != 0 && pDevice->filter != 0)
                 {
                     FilterFree(pDevice->filter);
                 }
             }
 
-            PaUtil_GroupFreeMemory( winDsHostApi->allocations, scanDeviceInfosResults->deviceInfos[0] ); /* all device info structs are allocated in a block so we can destroy them here */
-            PaUtil_GroupFreeMemory( winDsHostApi->allocations, scanDeviceInfosResults->deviceInfos );
+            if( scanDeviceInfosResults->deviceInfos[0] )
+                PaUtil_FreeMemory( scanDeviceInfosResults->deviceInfos[0] ); /* all device info structs are allocated in a block so we can destroy them here */
+            PaUtil_FreeMemory( scanDeviceInfosResults->deviceInfos );
         }
 
-        PaUtil_GroupFreeMemory( winDsHostApi->allocations, scanDeviceInfosResults );
+        PaUtil_FreeMemory( scanDeviceInfosResults );
     }
 
     return paNoError;
@@ -3721,7 +3724,7 @@ PaError PaWinWdm_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
         goto error;
     }
 
-    wdmHostApi->allocations = PaUtil_CreateAllocationGroup();
+    wdmHostApi->allocations = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo );
     if( !wdmHostApi->allocations )
     {
         result = paInsufficientMemory;
@@ -3797,10 +3800,16 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
 
     if( wdmHostApi)
     {
-        PaWinWDMScanDeviceInfosResults* localScanResults = (PaWinWDMScanDeviceInfosResults*)PaUtil_GroupAllocateMemory(
-            wdmHostApi->allocations, sizeof(PaWinWDMScanDeviceInfosResults));
-        localScanResults->deviceInfos = hostApi->deviceInfos;
-        DisposeDeviceInfos(hostApi, localScanResults, hostApi->info.deviceCount);
+        if( hostApi->deviceInfos )
+        {
+            PaWinWDMScanDeviceInfosResults* localScanResults = (PaWinWDMScanDeviceInfosResults*)PaUtil_AllocateTaggedMemory(
+                sizeof(PaWinWDMScanDeviceInfosResults), paMemoryDeviceInfo );
+            if( localScanResults )
+            {
+                localScanResults->deviceInfos = hostApi->deviceInfos;
+                DisposeDeviceInfos(hostApi, localScanResults, hostApi->info.deviceCount);
+            }
+        }
 
         if( wdmHostApi->allocations )
         {
@@ -4294,7 +4303,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     }
 
     /* Create allocation group */
-    stream->allocGroup = PaUtil_CreateAllocationGroup();
+    stream->allocGroup = PaUtil_CreateTaggedAllocationGroup( paMemoryHostApiStream );
     if( !stream->allocGroup )
     {
         result = paInsufficientMemory;
@@ -4322,6 +4331,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     }
 
     PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+    stream->streamRepresentation.cpuLoadMeasurer = &stream->cpuLoadMeasurer;
+    stream->streamRepresentation.bufferProcessor = &stream->bufferProcessor;
 
     /* Instantiate the input pin if necessary */
     if(userInputChannels > 0)
@@ -6067,6 +6078,7 @@ static PaError StartStream( PaStream *s )
     ResetStreamEvents(stream);
 
     PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    PaUtil_ResetBufferProcessorStatistics( &stream->bufferProcessor );
 
     stream->oldProcessPriority = GetPriorityClass(GetCurrentProcess());
     /* Uncomment the following line to enable dynamic boosting of the process
@@ -942,7 +942,7 @@ PaError PaWinMme_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
         goto error;
     }
 
-    winMmeHostApi->allocations = PaUtil_CreateAllocationGroup();
+    winMmeHostApi->allocations = PaUtil_CreateTaggedAllocationGroup( paMemoryDeviceInfo );
     if( !winMmeHostApi->allocations )
     {
         result = paInsufficientMemory;
@@ -2468,6 +2468,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     streamRepresentationIsInitialized = 1;
 
     PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+    stream->streamRepresentation.cpuLoadMeasurer = &stream->cpuLoadMeasurer;
+    stream->streamRepresentation.bufferProcessor = &stream->bufferProcessor;
 
 
     if( inputParameters && outputParameters ) /* full duplex */
@@ -3224,6 +3226,7 @@ static PaError StartStream( PaStream *s )
 	PaStreamCallbackTimeInfo timeInfo = {0,0,0}; /** @todo implement this for stream priming */
     
     PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    PaUtil_ResetBufferProcessorStatistics( &stream->bufferProcessor );
     
     if( PA_IS_INPUT_STREAM_(stream) )
     {
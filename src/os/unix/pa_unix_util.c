@@ -40,16 +40,32 @@
 /** @file
  @ingroup unix_src
 */
+
+#if defined __linux__ && !defined _GNU_SOURCE
+#define _GNU_SOURCE /* pthread_setaffinity_np, syscall */
+#endif
  
 #include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <time.h>
 #include <sys/time.h>
 #include <assert.h>
 #include <string.h> /* For memset */
 #include <math.h>
 #include <errno.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+#include <alloca.h> /* elsewhere alloca() is declared in stdlib.h */
+#endif
+#if (defined(_POSIX_MEMLOCK_RANGE) && (_POSIX_MEMLOCK_RANGE > 0)) || \
+    (defined(_POSIX_MEMLOCK) && (_POSIX_MEMLOCK > 0))
+#include <sys/mman.h>
+#endif
 
 #if defined(__APPLE__) && !defined(HAVE_MACH_ABSOLUTE_TIME)
 #define HAVE_MACH_ABSOLUTE_TIME
@@ -63,22 +79,112 @@
 #include "pa_debugprint.h"
 
 /*
-   Track memory allocations to avoid leaks.
+   Account for memory by category. Every block is preceded by a header
+   recording its size and category, so that PaUtil_FreeMemory can subtract
+   it again. The counters are updated atomically, since blocks are allocated
+   and freed from any thread.
  */
 
-#if PA_TRACK_MEMORY
-static int numAllocations_ = 0;
+typedef union
+{
+    struct
+    {
+        long size;
+        PaMemoryCategory category;
+    } info;
+    double alignment[2]; /* keep the block following the header 16 byte aligned */
+} PaUtilMemoryHeader;
+
+typedef struct
+{
+    volatile long currentBytes;
+    volatile long peakBytes;
+    volatile long currentBlocks;
+    volatile long totalAllocations;
+} PaUtilMemoryCounters;
+
+/* indexed by category, the last entry accumulates all categories */
+static PaUtilMemoryCounters memoryCounters_[paMemoryTotal + 1];
+
+#ifdef __GNUC__
+#define PA_ATOMIC_ADD_( target, value )   __sync_add_and_fetch( (target), (value) )
+#define PA_ATOMIC_CAS_( target, expected, value )   __sync_bool_compare_and_swap( (target), (expected), (value) )
+#else
+static pthread_mutex_t memoryCountersMtx_ = PTHREAD_MUTEX_INITIALIZER;
+
+static long AtomicAdd( volatile long *target, long value )
+{
+    long result;
+    pthread_mutex_lock( &memoryCountersMtx_ );
+    result = (*target += value);
+    pthread_mutex_unlock( &memoryCountersMtx_ );
+    return result;
+}
+
+static int AtomicCompareAndSwap( volatile long *target, long expected, long value )
+{
+    int result;
+    pthread_mutex_lock( &memoryCountersMtx_ );
+    if( (result = (*target == expected)) )
+        *target = value;
+    pthread_mutex_unlock( &memoryCountersMtx_ );
+    return result;
+}
+
+#define PA_ATOMIC_ADD_( target, value )   AtomicAdd( (target), (value) )
+#define PA_ATOMIC_CAS_( target, expected, value )   AtomicCompareAndSwap( (target), (expected), (value) )
 #endif
 
+static void CountMemory( PaMemoryCategory category, long bytes, long blocks )
+{
+    PaUtilMemoryCounters *counters[2];
+    int i;
+
+    counters[0] = &memoryCounters_[category];
+    counters[1] = &memoryCounters_[paMemoryTotal];
+
+    for( i = 0; i < 2; ++i )
+    {
+        long current = PA_ATOMIC_ADD_( &counters[i]->currentBytes, bytes );
+        PA_ATOMIC_ADD_( &counters[i]->currentBlocks, blocks );
+
+        if( blocks > 0 )
+        {
+            long peak;
+
+            PA_ATOMIC_ADD_( &counters[i]->totalAllocations, blocks );
+            do
+            {
+                peak = counters[i]->peakBytes;
+            }
+            while( current > peak && !PA_ATOMIC_CAS_( &counters[i]->peakBytes, peak, current ) );
+        }
+    }
+}
+
 
 void *PaUtil_AllocateMemory( long size )
 {
-    void *result = malloc( size );
+    return PaUtil_AllocateTaggedMemory( size, paMemoryGeneral );
+}
 
-#if PA_TRACK_MEMORY
-    if( result != NULL ) numAllocations_ += 1;
-#endif
-    return result;
+
+void *PaUtil_AllocateTaggedMemory( long size, PaMemoryCategory category )
+{
+    PaUtilMemoryHeader *header;
+
+    if( (int)category < 0 || category >= paMemoryTotal )
+        category = paMemoryGeneral;
+
+    header = (PaUtilMemoryHeader *)malloc( sizeof (PaUtilMemoryHeader) + size );
+    if( header == NULL )
+        return NULL;
+
+    header->info.size = size;
+    header->info.category = category;
+    CountMemory( category, size, 1 );
+
+    return header + 1;
 }
 
 
@@ -86,25 +192,126 @@ void PaUtil_FreeMemory( void *block )
 {
     if( block != NULL )
     {
-        free( block );
-#if PA_TRACK_MEMORY
-        numAllocations_ -= 1;
-#endif
+        PaUtilMemoryHeader *header = (PaUtilMemoryHeader *)block - 1;
 
+        CountMemory( header->info.category, -header->info.size, -1 );
+        free( header );
     }
 }
 
 
 int PaUtil_CountCurrentlyAllocatedBlocks( void )
 {
-#if PA_TRACK_MEMORY
-    return numAllocations_;
+    return (int)memoryCounters_[paMemoryTotal].currentBlocks;
+}
+
+
+void PaUtil_GetMemoryUsage( PaMemoryCategory category, PaMemoryUsage *usage )
+{
+    const PaUtilMemoryCounters *counters = &memoryCounters_[category];
+
+    usage->currentBytes = (unsigned long)counters->currentBytes;
+    usage->peakBytes = (unsigned long)counters->peakBytes;
+    usage->currentBlocks = (unsigned long)counters->currentBlocks;
+    usage->totalAllocations = (unsigned long)counters->totalAllocations;
+}
+
+
+static long GetPageSize( void )
+{
+#ifdef _SC_PAGESIZE
+    long pageSize = sysconf( _SC_PAGESIZE );
+    if( pageSize > 0 )
+        return pageSize;
+#endif
+    return 4096;
+}
+
+
+long PaUtil_LockMemory( void *block, long size )
+{
+    long pageSize = GetPageSize();
+    volatile char *p;
+    long i;
+
+    if( !block || size <= 0 )
+        return 0;
+
+    /* Prefault by writing one byte per page, so copy-on-write and zero pages
+       are replaced by private pages before the lock is taken */
+    p = (volatile char *)block;
+    for( i = 0; i < size; i += pageSize )
+        p[i] = p[i];
+    p[size - 1] = p[size - 1];
+
+#if defined(_POSIX_MEMLOCK_RANGE) && (_POSIX_MEMLOCK_RANGE > 0)
+    {
+        /* mlock() rounds the start down to a page boundary on Linux, but
+           POSIX allows it to require an aligned address */
+        unsigned long start = (unsigned long)block & ~(unsigned long)(pageSize - 1);
+        unsigned long length = (unsigned long)block + size - start;
+
+        if( mlock( (void *)start, length ) != 0 )
+        {
+            PA_DEBUG(( "%s: Failed locking %ld bytes: %s\n", __FUNCTION__, size, strerror( errno ) ));
+            return 0;
+        }
+        return size;
+    }
 #else
     return 0;
 #endif
 }
 
 
+void PaUtil_InitializeMemoryLocking( void )
+{
+#if defined(_POSIX_MEMLOCK) && (_POSIX_MEMLOCK > 0)
+    const char *env = getenv( "PA_MLOCKALL" );
+
+    if( !env || atoi( env ) == 0 )
+        return;
+
+    if( mlockall( MCL_CURRENT | MCL_FUTURE ) < 0 )
+    {
+        PA_DEBUG(( "%s: Failed locking memory: %s\n", __FUNCTION__, strerror( errno ) ));
+    }
+    else
+    {
+        PA_DEBUG(( "%s: Successfully locked memory\n", __FUNCTION__ ));
+    }
+#endif
+}
+
+
+void PaUtil_PrefaultStack( unsigned long size )
+{
+    long pageSize = GetPageSize();
+    volatile char *stack;
+    unsigned long i;
+
+    if( size == 0 )
+        return;
+
+    stack = (volatile char *)alloca( size );
+    for( i = 0; i < size; i += pageSize )
+        stack[i] = 0;
+}
+
+
+int PaUtil_AtomicCompareAndSwap( volatile long *target, long expected, long value )
+{
+    return PA_ATOMIC_CAS_( target, expected, value );
+}
+
+
+unsigned long PaUtil_GetCurrentThreadId( void )
+{
+    /* pthread_t is an integer or a pointer on the platforms we support */
+    return (unsigned long)pthread_self();
+}
+
+
 void Pa_Sleep( long msec )
 {
 #ifdef HAVE_NANOSLEEP
@@ -143,6 +350,95 @@ void Pa_Sleep( long msec )
 static double machSecondsConversionScaler_ = 0.0; 
 #endif
 
+#ifdef HAVE_CLOCK_GETTIME
+/* Stream times and CPU load measurements must not jump when the wall clock is stepped, so we avoid CLOCK_REALTIME */
+#ifdef CLOCK_MONOTONIC
+#define PA_MONOTONIC_CLOCK CLOCK_MONOTONIC
+#else
+#define PA_MONOTONIC_CLOCK CLOCK_REALTIME
+#endif
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define PA_HAVE_TSC
+#endif
+
+static PaUnixClockSource clockSource_ = paUnixClockMonotonic;
+static clockid_t clockId_ = PA_MONOTONIC_CLOCK;
+
+static double GetClockTime( clockid_t clockId )
+{
+    struct timespec tp;
+    clock_gettime( clockId, &tp );
+    return (double)(tp.tv_sec + tp.tv_nsec * 1e-9);
+}
+
+#ifdef PA_HAVE_TSC
+/* The time is tscBaseTime_ + (TSC - tscBase_) * tscSecondsPerTick_ */
+static unsigned long long tscBase_ = 0;
+static double tscBaseTime_ = 0.0, tscSecondsPerTick_ = 0.0;
+
+static unsigned long long ReadTsc( void )
+{
+    unsigned int lo, hi;
+    __asm__ __volatile__( "rdtsc" : "=a" (lo), "=d" (hi) );
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+/* The TSC can only stand in for the monotonic clock if it ticks at a constant rate, whatever the power state */
+static int IsTscInvariant( void )
+{
+    FILE *f = fopen( "/proc/cpuinfo", "r" );
+    char line[4096];
+    int invariant = 0;
+
+    if( !f )
+        return 0;
+    while( fgets( line, sizeof (line), f ) )
+    {
+        if( !strncmp( line, "flags", 5 ) )
+        {
+            invariant = strstr( line, " constant_tsc" ) && strstr( line, " nonstop_tsc" );
+            break;
+        }
+    }
+    fclose( f );
+
+    return invariant;
+}
+
+/* Sample the monotonic clock along with the TSC, bracketing the clock read to halve the uncertainty */
+static void SampleTsc( double *time, unsigned long long *tsc )
+{
+    unsigned long long before = ReadTsc();
+    *time = GetClockTime( PA_MONOTONIC_CLOCK );
+    *tsc = before + (ReadTsc() - before) / 2;
+}
+
+static int CalibrateTsc( void )
+{
+    /* 50 ms, keeps the rate error well below 1 ppm. This delays Pa_Initialize, but calibrating lazily would put the
+       sleep into whichever thread reads the clock first, possibly the audio thread. */
+    const struct timespec interval = { 0, 50000000 };
+    double t0, t1;
+    unsigned long long c0, c1;
+
+    if( !IsTscInvariant() )
+        return 0;
+
+    SampleTsc( &t0, &c0 );
+    nanosleep( &interval, NULL );
+    SampleTsc( &t1, &c1 );
+    if( c1 <= c0 || t1 <= t0 )
+        return 0;
+
+    tscSecondsPerTick_ = (t1 - t0) / (double)(c1 - c0);
+    tscBase_ = c1;
+    tscBaseTime_ = t1;
+    return 1;
+}
+#endif /* PA_HAVE_TSC */
+#endif /* HAVE_CLOCK_GETTIME */
+
 void PaUtil_InitializeClock( void )
 {
 #ifdef HAVE_MACH_ABSOLUTE_TIME
@@ -150,7 +446,60 @@ void PaUtil_InitializeClock( void )
     kern_return_t err = mach_timebase_info( &info );
     if( err == 0  )
         machSecondsConversionScaler_ = 1e-9 * (double) info.numer / (double) info.denom;
+#elif defined(HAVE_CLOCK_GETTIME)
+    const char *source = getenv( "PA_UNIX_CLOCK" );
+
+    clockSource_ = paUnixClockMonotonic;
+    clockId_ = PA_MONOTONIC_CLOCK;
+    if( source && !strcmp( source, "raw" ) )
+    {
+#ifdef CLOCK_MONOTONIC_RAW
+        clockSource_ = paUnixClockMonotonicRaw;
+        clockId_ = CLOCK_MONOTONIC_RAW;
+#else
+        PA_DEBUG(( "%s: CLOCK_MONOTONIC_RAW is not supported\n", __FUNCTION__ ));
 #endif
+    }
+    else if( source && !strcmp( source, "tsc" ) )
+    {
+#ifdef PA_HAVE_TSC
+        if( CalibrateTsc() )
+            clockSource_ = paUnixClockTsc;
+#endif
+        if( clockSource_ != paUnixClockTsc )
+        {
+            PA_DEBUG(( "%s: No invariant TSC, using the monotonic clock\n", __FUNCTION__ ));
+        }
+    }
+#endif
+}
+
+PaUnixClockSource PaUnixClock_GetSource( void )
+{
+#ifdef HAVE_CLOCK_GETTIME
+    return clockSource_;
+#else
+    return paUnixClockMonotonic;
+#endif
+}
+
+PaTime PaUnixClock_ToRealtime( PaTime time )
+{
+    PaTime before, after, realtime;
+
+    before = PaUtil_GetTime();
+#ifdef HAVE_CLOCK_GETTIME
+    realtime = GetClockTime( CLOCK_REALTIME );
+#else
+    {
+        struct timeval tv;
+        gettimeofday( &tv, NULL );
+        realtime = (PaTime) tv.tv_usec * 1e-6 + tv.tv_sec;
+    }
+#endif
+    after = PaUtil_GetTime();
+
+    return time + realtime - (before + after) / 2;
 }
 
 
@@ -159,9 +508,11 @@ PaTime PaUtil_GetTime( void )
 #ifdef HAVE_MACH_ABSOLUTE_TIME
     return mach_absolute_time() * machSecondsConversionScaler_;
 #elif defined(HAVE_CLOCK_GETTIME)
-    struct timespec tp;
-    clock_gettime(CLOCK_REALTIME, &tp);
-    return (PaTime)(tp.tv_sec + tp.tv_nsec * 1e-9);
+#ifdef PA_HAVE_TSC
+    if( clockSource_ == paUnixClockTsc )
+        return tscBaseTime_ + (double)(long long)(ReadTsc() - tscBase_) * tscSecondsPerTick_;
+#endif
+    return GetClockTime( clockId_ );
 #else
     struct timeval tv;
     gettimeofday( &tv, NULL );
@@ -242,31 +593,205 @@ PaError PaUnixThreading_Initialize()
     return paNoError;
 }
 
-static PaError BoostPriority( PaUnixThread* self )
+#if defined __linux__ && defined SYS_sched_setattr && defined SYS_sched_getattr
+#define PA_HAVE_SCHED_ATTR
+
+/* Layout of the kernel's struct sched_attr, which isn't exposed by the C library */
+typedef struct
+{
+    unsigned int size;
+    unsigned int sched_policy;
+    unsigned long long sched_flags;
+    int sched_nice;
+    unsigned int sched_priority;
+    unsigned long long sched_runtime;
+    unsigned long long sched_deadline;
+    unsigned long long sched_period;
+} PaUnixSchedAttr;
+#endif
+
+/* Restrict the calling thread to the CPUs in cpuMask. Returns 0 on success, else an errno value. */
+static int SetAffinity( unsigned long long cpuMask )
+{
+#ifdef __linux__
+    cpu_set_t cpus;
+    int i, err;
+
+    if( !cpuMask )
+        return 0;
+
+    CPU_ZERO( &cpus );
+    for( i = 0; i < 64; ++i )
+    {
+        if( cpuMask & (1ULL << i) )
+            CPU_SET( i, &cpus );
+    }
+    if( (err = pthread_setaffinity_np( pthread_self(), sizeof (cpus), &cpus )) != 0 )
+    {
+        PA_DEBUG(( "%s: Failed setting CPU affinity: %s\n", __FUNCTION__, strerror( err ) ));
+    }
+    return err;
+#else
+    if( !cpuMask )
+        return 0;
+    PA_DEBUG(( "%s: CPU affinity is not supported on this platform\n", __FUNCTION__ ));
+    return ENOSYS;
+#endif
+}
+
+/* Apply the requested policy to the calling thread. SCHED_DEADLINE falls back to SCHED_FIFO if it can't be had, in
+ * which case *fellBack is set. Returns 0 if the resulting policy was applied, else an errno value. */
+static int SetPolicy( const PaUnixThreadScheduling* scheduling, int* fellBack )
 {
-    PaError result = paNoError;
     struct sched_param spm = { 0 };
-    /* Priority should only matter between contending FIFO threads? */
-    spm.sched_priority = 1;
+    int policy = scheduling->policy;
+    int err;
+
+    *fellBack = 0;
+
+    if( policy == PA_SCHED_DEADLINE )
+    {
+#ifdef PA_HAVE_SCHED_ATTR
+        PaUnixSchedAttr attr;
+
+        memset( &attr, 0, sizeof (attr) );
+        attr.size = sizeof (attr);
+        attr.sched_policy = PA_SCHED_DEADLINE;
+        attr.sched_runtime = scheduling->runtime;
+        attr.sched_deadline = attr.sched_period = scheduling->period;
+        if( syscall( SYS_sched_setattr, 0, &attr, 0 ) == 0 )
+            return 0;
+        PA_DEBUG(( "%s: Failed setting SCHED_DEADLINE: %s\n", __FUNCTION__, strerror( errno ) ));
+#else
+        PA_DEBUG(( "%s: SCHED_DEADLINE is not supported on this platform\n", __FUNCTION__ ));
+#endif
+        policy = SCHED_FIFO;
+        *fellBack = 1;
+    }
+
+    spm.sched_priority = scheduling->priority;
+    if( policy != SCHED_OTHER && spm.sched_priority < sched_get_priority_min( policy ) )
+        spm.sched_priority = sched_get_priority_min( policy );
+
+    if( (err = pthread_setschedparam( pthread_self(), policy, &spm )) != 0 )
+    {
+        /* EPERM means we lack permission to raise priority */
+        PA_DEBUG(( "%s: Failed bumping priority: %s\n", __FUNCTION__, strerror( err ) ));
+    }
+    return err;
+}
+
+/* Obtain the scheduling in effect for the calling thread */
+static void GetScheduling( PaUnixThreadScheduling* scheduling )
+{
+    struct sched_param spm = { 0 };
+    int policy = SCHED_OTHER;
+
+    memset( scheduling, 0, sizeof (PaUnixThreadScheduling) );
+    if( pthread_getschedparam( pthread_self(), &policy, &spm ) == 0 )
+    {
+        scheduling->policy = policy;
+        scheduling->priority = spm.sched_priority;
+    }
+
+#ifdef PA_HAVE_SCHED_ATTR
+    if( policy == PA_SCHED_DEADLINE )
+    {
+        PaUnixSchedAttr attr;
+
+        memset( &attr, 0, sizeof (attr) );
+        if( syscall( SYS_sched_getattr, 0, &attr, sizeof (attr), 0 ) == 0 )
+        {
+            scheduling->runtime = attr.sched_runtime;
+            scheduling->period = attr.sched_period;
+        }
+    }
+#endif
+
+#ifdef __linux__
+    {
+        cpu_set_t cpus;
+        int i;
+
+        if( pthread_getaffinity_np( pthread_self(), sizeof (cpus), &cpus ) == 0 )
+        {
+            for( i = 0; i < 64; ++i )
+            {
+                if( CPU_ISSET( i, &cpus ) )
+                    scheduling->cpuMask |= 1ULL << i;
+            }
+        }
+    }
+#endif
+}
 
-    assert( self );
+/* Entry point of threads spawned by PaUnixThread_New, the scheduling can only be applied from within the thread in
+ * the SCHED_DEADLINE case, so it is done here for all cases.
+ *
+ * The policy is applied before the affinity, since the kernel refuses SCHED_DEADLINE for a thread whose CPUs are a
+ * subset of its root domain. For the same reason the affinity of a SCHED_DEADLINE thread is left alone. */
+static void* ThreadFunc( void* arg )
+{
+    PaUnixThread* self = (PaUnixThread*)arg;
+    int fellBack = 0, policyError = 0, affinityError = 0;
 
-    if( pthread_setschedparam( self->thread, SCHED_FIFO, &spm ) != 0 )
+    if( self->applyScheduling )
     {
-        PA_UNLESS( errno == EPERM, paInternalError );  /* Lack permission to raise priority */
-        PA_DEBUG(( "Failed bumping priority\n" ));
-        result = 0;
+        unsigned long long cpuMask = self->scheduling.cpuMask;
+
+        policyError = SetPolicy( &self->scheduling, &fellBack );
+        if( cpuMask && self->scheduling.policy == PA_SCHED_DEADLINE && !fellBack )
+        {
+            PA_DEBUG(( "%s: Not restricting the CPU affinity of a SCHED_DEADLINE thread\n", __FUNCTION__ ));
+            affinityError = EINVAL;
+        }
+        else
+            affinityError = SetAffinity( cpuMask );
+        GetScheduling( &self->scheduling );
+        PA_DEBUG(( "%s: Thread running with policy %d, priority %d\n", __FUNCTION__, self->scheduling.policy,
+                    self->scheduling.priority ));
     }
     else
+        GetScheduling( &self->scheduling );
+
+    /* Report the outcome to PaUnixThread_New */
+    PA_ASSERT_CALL( PaUnixMutex_Lock( &self->mtx ), paNoError );
+    self->schedulingGranted = !fellBack && !policyError && !affinityError;
+    self->schedulingError = policyError;
+    self->schedulingDone = 1;
+    pthread_cond_broadcast( &self->cond );
+    PA_ASSERT_CALL( PaUnixMutex_Unlock( &self->mtx ), paNoError );
+
+    if( policyError && policyError != EPERM )
     {
-        result = 1; /* Success */
+        PaUnixThreading_EXIT( paInternalError );
     }
-error:
-    return result;
+
+    return self->threadFunc( self->threadArg );
+}
+
+/* The deadline for pthread_cond_timedwait must be on the clock of the condition variable, which isn't necessarily
+ * that of PaUtil_GetTime. */
+#if defined HAVE_CLOCK_GETTIME && defined CLOCK_MONOTONIC && !defined __APPLE__
+#define PA_COND_CLOCK CLOCK_MONOTONIC
+#endif
+
+static void GetCondDeadline( PaTime timeout, struct timespec *ts )
+{
+    PaTime till;
+#ifdef PA_COND_CLOCK
+    till = GetClockTime( PA_COND_CLOCK ) + timeout;
+#else
+    struct timeval tv;
+    gettimeofday( &tv, NULL );
+    till = (PaTime) tv.tv_usec * 1e-6 + tv.tv_sec + timeout;
+#endif
+    ts->tv_sec = (time_t) floor( till );
+    ts->tv_nsec = (long) ((till - floor( till )) * 1e9);
 }
 
 PaError PaUnixThread_New( PaUnixThread* self, void* (*threadFunc)( void* ), void* threadArg, PaTime waitForChild,
-        int rtSched )
+        const PaUnixThreadScheduling* scheduling )
 {
     PaError result = paNoError;
     pthread_attr_t attr;
@@ -274,102 +799,97 @@ PaError PaUnixThread_New( PaUnixThread* self, void* (*threadFunc)( void* ), void
 
     memset( self, 0, sizeof (PaUnixThread) );
     PaUnixMutex_Initialize( &self->mtx );
+#ifdef PA_COND_CLOCK
+    {
+        pthread_condattr_t condAttr;
+        PA_ASSERT_CALL( pthread_condattr_init( &condAttr ), 0 );
+        PA_ASSERT_CALL( pthread_condattr_setclock( &condAttr, PA_COND_CLOCK ), 0 );
+        PA_ASSERT_CALL( pthread_cond_init( &self->cond, &condAttr ), 0 );
+        PA_ASSERT_CALL( pthread_condattr_destroy( &condAttr ), 0 );
+    }
+#else
     PA_ASSERT_CALL( pthread_cond_init( &self->cond, NULL ), 0 );
+#endif
 
     self->parentWaiting = 0 != waitForChild;
-
-    /* Spawn thread */
-
-/* Temporarily disabled since we should test during configuration for presence of required mman.h header */
-#if 0
-#if defined _POSIX_MEMLOCK && (_POSIX_MEMLOCK != -1)
-    if( rtSched )
+    self->threadFunc = threadFunc;
+    self->threadArg = threadArg;
+    if( scheduling )
     {
-        if( mlockall( MCL_CURRENT | MCL_FUTURE ) < 0 )
-        {
-            int savedErrno = errno;             /* In case errno gets overwritten */
-            assert( savedErrno != EINVAL );     /* Most likely a programmer error */
-            PA_UNLESS( (savedErrno == EPERM), paInternalError );
-            PA_DEBUG(( "%s: Failed locking memory\n", __FUNCTION__ ));
-        }
-        else
-            PA_DEBUG(( "%s: Successfully locked memory\n", __FUNCTION__ ));
+        self->scheduling = *scheduling;
+        self->applyScheduling = 1;
     }
-#endif
-#endif
+
+    /* Spawn thread */
 
     PA_UNLESS( !pthread_attr_init( &attr ), paInternalError );
     /* Priority relative to other processes */
     PA_UNLESS( !pthread_attr_setscope( &attr, PTHREAD_SCOPE_SYSTEM ), paInternalError );   
 
-    PA_UNLESS( !pthread_create( &self->thread, &attr, threadFunc, threadArg ), paInternalError );
+    PA_UNLESS( !pthread_create( &self->thread, &attr, ThreadFunc, self ), paInternalError );
     started = 1;
 
-    if( rtSched )
-    {
+    /* Wait for the thread to apply its scheduling. Lacking permission to raise the priority is alright, the caller
+     * can find out through PaUnixThread_GetScheduling, other failures are errors. */
+    PA_ENSURE( PaUnixMutex_Lock( &self->mtx ) );
+    while( !self->schedulingDone )
+        pthread_cond_wait( &self->cond, &self->mtx.mtx );
+    PA_ENSURE( PaUnixMutex_Unlock( &self->mtx ) );
+    PA_UNLESS( !self->schedulingError || self->schedulingError == EPERM, paInternalError );
+
 #if 0
-        if( self->useWatchdog )
+    if( scheduling && self->useWatchdog )
+    {
+        int err;
+        struct sched_param wdSpm = { 0 };
+        /* Launch watchdog, watchdog sets callback thread priority */
+        int prio = PA_MIN( self->rtPrio + 4, sched_get_priority_max( SCHED_FIFO ) );
+        wdSpm.sched_priority = prio;
+
+        PA_UNLESS( !pthread_attr_init( &attr ), paInternalError );
+        PA_UNLESS( !pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED ), paInternalError );
+        PA_UNLESS( !pthread_attr_setscope( &attr, PTHREAD_SCOPE_SYSTEM ), paInternalError );
+        PA_UNLESS( !pthread_attr_setschedpolicy( &attr, SCHED_FIFO ), paInternalError );
+        PA_UNLESS( !pthread_attr_setschedparam( &attr, &wdSpm ), paInternalError );
+        if( (err = pthread_create( &self->watchdogThread, &attr, &WatchdogFunc, self )) )
         {
-            int err;
-            struct sched_param wdSpm = { 0 };
-            /* Launch watchdog, watchdog sets callback thread priority */
-            int prio = PA_MIN( self->rtPrio + 4, sched_get_priority_max( SCHED_FIFO ) );
-            wdSpm.sched_priority = prio;
-
-            PA_UNLESS( !pthread_attr_init( &attr ), paInternalError );
-            PA_UNLESS( !pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED ), paInternalError );
-            PA_UNLESS( !pthread_attr_setscope( &attr, PTHREAD_SCOPE_SYSTEM ), paInternalError );
-            PA_UNLESS( !pthread_attr_setschedpolicy( &attr, SCHED_FIFO ), paInternalError );
-            PA_UNLESS( !pthread_attr_setschedparam( &attr, &wdSpm ), paInternalError );
-            if( (err = pthread_create( &self->watchdogThread, &attr, &WatchdogFunc, self )) )
-            {
-                PA_UNLESS( err == EPERM, paInternalError );
-                /* Permission error, go on without realtime privileges */
-                PA_DEBUG(( "Failed bumping priority\n" ));
-            }
-            else
-            {
-                int policy;
-                self->watchdogRunning = 1;
-                PA_ENSURE_SYSTEM( pthread_getschedparam( self->watchdogThread, &policy, &wdSpm ), 0 );
-                /* Check if priority is right, policy could potentially differ from SCHED_FIFO (but that's alright) */
-                if( wdSpm.sched_priority != prio )
-                {
-                    PA_DEBUG(( "Watchdog priority not set correctly (%d)\n", wdSpm.sched_priority ));
-                    PA_ENSURE( paInternalError );
-                }
-            }
+            PA_UNLESS( err == EPERM, paInternalError );
+            /* Permission error, go on without realtime privileges */
+            PA_DEBUG(( "Failed bumping priority\n" ));
         }
         else
-#endif
-            PA_ENSURE( BoostPriority( self ) );
-
         {
             int policy;
-            struct sched_param spm;
-            pthread_getschedparam(self->thread, &policy, &spm);
+            self->watchdogRunning = 1;
+            PA_ENSURE_SYSTEM( pthread_getschedparam( self->watchdogThread, &policy, &wdSpm ), 0 );
+            /* Check if priority is right, policy could potentially differ from SCHED_FIFO (but that's alright) */
+            if( wdSpm.sched_priority != prio )
+            {
+                PA_DEBUG(( "Watchdog priority not set correctly (%d)\n", wdSpm.sched_priority ));
+                PA_ENSURE( paInternalError );
+            }
         }
     }
-    
+#endif
+
     if( self->parentWaiting )
     {
-        PaTime till;
         struct timespec ts;
         int res = 0;
-        PaTime now;
+#ifdef PA_ENABLE_DEBUG_OUTPUT
+        PaTime waitStartTime = PaUtil_GetTime();
+#endif
 
         PA_ENSURE( PaUnixMutex_Lock( &self->mtx ) );
 
         /* Wait for stream to be started */
-        now = PaUtil_GetTime();
-        till = now + waitForChild;
+        if( waitForChild > 0 )
+            GetCondDeadline( waitForChild, &ts );
 
         while( self->parentWaiting && !res )
         {
             if( waitForChild > 0 )
             {
-                ts.tv_sec = (time_t) floor( till );
-                ts.tv_nsec = (long) ((till - floor( till )) * 1e9);
                 res = pthread_cond_timedwait( &self->cond, &self->mtx.mtx, &ts );
             }
             else
@@ -381,7 +901,7 @@ PaError PaUnixThread_New( PaUnixThread* self, void* (*threadFunc)( void* ), void
         PA_ENSURE( PaUnixMutex_Unlock( &self->mtx ) );
 
         PA_UNLESS( !res || ETIMEDOUT == res, paInternalError );
-        PA_DEBUG(( "%s: Waited for %g seconds for stream to start\n", __FUNCTION__, PaUtil_GetTime() - now ));
+        PA_DEBUG(( "%s: Waited for %g seconds for stream to start\n", __FUNCTION__, PaUtil_GetTime() - waitStartTime ));
         if( ETIMEDOUT == res )
         {
             PA_ENSURE( paTimedOut );
@@ -492,6 +1012,12 @@ error:
     return result;
 }
 
+int PaUnixThread_GetScheduling( PaUnixThread* self, PaUnixThreadScheduling* scheduling )
+{
+    *scheduling = self->scheduling;
+    return self->schedulingGranted;
+}
+
 int PaUnixThread_StopRequested( PaUnixThread* self )
 {
     return self->stopRequested;
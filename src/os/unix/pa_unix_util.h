@@ -118,6 +118,30 @@ void PaUtil_TerminateThreading( PaUtilThreading *threading );
 PaError PaUtil_StartThreading( PaUtilThreading *threading, void *(*threadRoutine)(void *), void *data );
 PaError PaUtil_CancelThreading( PaUtilThreading *threading, int wait, PaError *exitResult );
 
+/** Clocks that PaUtil_GetTime can follow.
+ *
+ * The clock is chosen by PaUtil_InitializeClock, according to the PA_UNIX_CLOCK environment variable: "raw" for
+ * CLOCK_MONOTONIC_RAW, "tsc" for the TSC fast path, CLOCK_MONOTONIC otherwise. None of them are stepped along with
+ * the wall clock.
+ */
+typedef enum
+{
+    paUnixClockMonotonic,       /**< CLOCK_MONOTONIC, slewed but never stepped by NTP */
+    paUnixClockMonotonicRaw,    /**< CLOCK_MONOTONIC_RAW, the undisciplined hardware clock */
+    paUnixClockTsc              /**< Invariant x86 TSC, calibrated against CLOCK_MONOTONIC once. Cheapest to read,
+                                     but may drift from CLOCK_MONOTONIC by a fraction of a ppm. The calibration
+                                     sleeps for 50 ms in PaUtil_InitializeClock, i.e. during Pa_Initialize. */
+} PaUnixClockSource;
+
+/** The clock followed by PaUtil_GetTime. */
+PaUnixClockSource PaUnixClock_GetSource( void );
+
+/** Convert a time on the clock of PaUtil_GetTime to wall clock time (seconds since the epoch), e.g. for logging.
+ *
+ * The current offset between the clocks is used, so the result follows any steps of the wall clock.
+ */
+PaTime PaUnixClock_ToRealtime( PaTime time );
+
 /* State accessed by utility functions */
 
 /*
@@ -144,9 +168,30 @@ PaError PaUnixMutex_Terminate( PaUnixMutex* self );
 PaError PaUnixMutex_Lock( PaUnixMutex* self );
 PaError PaUnixMutex_Unlock( PaUnixMutex* self );
 
+/** Value of the SCHED_DEADLINE policy on Linux, which the C library doesn't necessarily define. */
+#define PA_SCHED_DEADLINE 6
+
+/** Scheduling of a thread spawned with PaUnixThread_New.
+ */
+typedef struct
+{
+    int policy;                 /**< SCHED_OTHER, SCHED_FIFO, SCHED_RR or PA_SCHED_DEADLINE */
+    int priority;               /**< Static priority, for SCHED_FIFO and SCHED_RR */
+    unsigned long long runtime; /**< Nanoseconds of CPU time per period, for PA_SCHED_DEADLINE */
+    unsigned long long period;  /**< Period in nanoseconds, for PA_SCHED_DEADLINE. The deadline is the period end. */
+    unsigned long long cpuMask; /**< Bit i allows the thread to run on CPU i, 0 to leave the affinity alone */
+} PaUnixThreadScheduling;
+
 typedef struct
 {
     pthread_t thread;
+    void* (*threadFunc)( void* );
+    void* threadArg;
+    int applyScheduling;
+    PaUnixThreadScheduling scheduling;  /* Requested, replaced by the effective values once the thread runs */
+    int schedulingDone;                 /* Set by the thread once it has applied the scheduling */
+    int schedulingGranted;              /* Did the requested scheduling take effect in full? */
+    int schedulingError;                /* errno value from applying the policy, 0 on success */
     int parentWaiting;
     int stopRequested;
     int locked;
@@ -187,11 +232,22 @@ PaError PaUnixThreading_Initialize();
  * @param threadFunc: The function to be executed in the child thread.
  * @param waitForChild: If not 0, wait for child thread to call PaUnixThread_NotifyParent. Less than 0 means
  * wait for ever, greater than 0 wait for the specified time.
- * @param rtSched: Enable realtime scheduling?
- * @return: If timed out waiting on child, paTimedOut.
+ * @param scheduling: Scheduling to apply in the new thread before threadFunc is entered, NULL for the default.
+ * Lacking the privileges to apply it is not an error, see PaUnixThread_GetScheduling. SCHED_DEADLINE threads keep
+ * their CPU affinity, since the kernel doesn't admit them with a restricted one.
+ * @return: If timed out waiting on child, paTimedOut. paInternalError if the policy was refused for another reason
+ * than lack of privileges.
  */
 PaError PaUnixThread_New( PaUnixThread* self, void* (*threadFunc)( void* ), void* threadArg, PaTime waitForChild,
-        int rtSched );
+        const PaUnixThreadScheduling* scheduling );
+
+/** Get the scheduling that is in effect for the thread.
+ *
+ * The values are obtained by the thread itself before PaUnixThread_New returns.
+ * @return: Non-zero if the scheduling passed to PaUnixThread_New took effect in full, 0 if the thread runs with less
+ * (e.g. SCHED_FIFO instead of SCHED_DEADLINE, no priority boost or no CPU affinity).
+ */
+int PaUnixThread_GetScheduling( PaUnixThread* self, PaUnixThreadScheduling* scheduling );
 
 /** Terminate thread.
  *
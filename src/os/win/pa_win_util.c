@@ -45,6 +45,7 @@
  
 #include <windows.h>
 #include <mmsystem.h> /* for timeGetTime() */
+#include <malloc.h> /* for _alloca() */
 
 #include "pa_util.h"
 
@@ -54,22 +55,87 @@
 
 
 /*
-   Track memory allocations to avoid leaks.
+   Account for memory by category. Every block is preceded by a header
+   recording its size and category, so that PaUtil_FreeMemory can subtract
+   it again. The counters are updated atomically, since blocks are allocated
+   and freed from any thread.
  */
 
-#if PA_TRACK_MEMORY
-static int numAllocations_ = 0;
-#endif
+typedef union
+{
+    struct
+    {
+        long size;
+        PaMemoryCategory category;
+    } info;
+    double alignment[2]; /* keep the block following the header 16 byte aligned */
+} PaUtilMemoryHeader;
+
+typedef struct
+{
+    volatile long currentBytes;
+    volatile long peakBytes;
+    volatile long currentBlocks;
+    volatile long totalAllocations;
+} PaUtilMemoryCounters;
+
+/* indexed by category, the last entry accumulates all categories */
+static PaUtilMemoryCounters memoryCounters_[paMemoryTotal + 1];
+
+#define PA_ATOMIC_ADD_( target, value )   (InterlockedExchangeAdd( (LONG volatile *)(target), (value) ) + (value))
+#define PA_ATOMIC_CAS_( target, expected, value ) \
+    (InterlockedCompareExchange( (LONG volatile *)(target), (value), (expected) ) == (expected))
+
+static void CountMemory( PaMemoryCategory category, long bytes, long blocks )
+{
+    PaUtilMemoryCounters *counters[2];
+    int i;
+
+    counters[0] = &memoryCounters_[category];
+    counters[1] = &memoryCounters_[paMemoryTotal];
+
+    for( i = 0; i < 2; ++i )
+    {
+        long current = PA_ATOMIC_ADD_( &counters[i]->currentBytes, bytes );
+        PA_ATOMIC_ADD_( &counters[i]->currentBlocks, blocks );
+
+        if( blocks > 0 )
+        {
+            long peak;
+
+            PA_ATOMIC_ADD_( &counters[i]->totalAllocations, blocks );
+            do
+            {
+                peak = counters[i]->peakBytes;
+            }
+            while( current > peak && !PA_ATOMIC_CAS_( &counters[i]->peakBytes, peak, current ) );
+        }
+    }
+}
 
 
 void *PaUtil_AllocateMemory( long size )
 {
-    void *result = GlobalAlloc( GPTR, size );
+    return PaUtil_AllocateTaggedMemory( size, paMemoryGeneral );
+}
 
-#if PA_TRACK_MEMORY
-    if( result != NULL ) numAllocations_ += 1;
-#endif
-    return result;
+
+void *PaUtil_AllocateTaggedMemory( long size, PaMemoryCategory category )
+{
+    PaUtilMemoryHeader *header;
+
+    if( (int)category < 0 || category >= paMemoryTotal )
+        category = paMemoryGeneral;
+
+    header = (PaUtilMemoryHeader *)GlobalAlloc( GPTR, sizeof (PaUtilMemoryHeader) + size );
+    if( header == NULL )
+        return NULL;
+
+    header->info.size = size;
+    header->info.category = category;
+    CountMemory( category, size, 1 );
+
+    return header + 1;
 }
 
 
@@ -77,22 +143,87 @@ void PaUtil_FreeMemory( void *block )
 {
     if( block != NULL )
     {
-        GlobalFree( block );
-#if PA_TRACK_MEMORY
-        numAllocations_ -= 1;
-#endif
+        PaUtilMemoryHeader *header = (PaUtilMemoryHeader *)block - 1;
 
+        CountMemory( header->info.category, -header->info.size, -1 );
+        GlobalFree( header );
     }
 }
 
 
 int PaUtil_CountCurrentlyAllocatedBlocks( void )
 {
-#if PA_TRACK_MEMORY
-    return numAllocations_;
-#else
-    return 0;
-#endif
+    return (int)memoryCounters_[paMemoryTotal].currentBlocks;
+}
+
+
+void PaUtil_GetMemoryUsage( PaMemoryCategory category, PaMemoryUsage *usage )
+{
+    const PaUtilMemoryCounters *counters = &memoryCounters_[category];
+
+    usage->currentBytes = (unsigned long)counters->currentBytes;
+    usage->peakBytes = (unsigned long)counters->peakBytes;
+    usage->currentBlocks = (unsigned long)counters->currentBlocks;
+    usage->totalAllocations = (unsigned long)counters->totalAllocations;
+}
+
+
+long PaUtil_LockMemory( void *block, long size )
+{
+    SYSTEM_INFO systemInfo;
+    volatile char *p;
+    long i;
+
+    if( !block || size <= 0 )
+        return 0;
+
+    GetSystemInfo( &systemInfo );
+
+    p = (volatile char *)block;
+    for( i = 0; i < size; i += (long)systemInfo.dwPageSize )
+        p[i] = p[i];
+    p[size - 1] = p[size - 1];
+
+    /* VirtualLock is limited by the process's minimum working set size,
+       which we don't adjust */
+    return VirtualLock( block, size ) ? size : 0;
+}
+
+
+void PaUtil_InitializeMemoryLocking( void )
+{
+    /* there is no equivalent of mlockall() on Windows */
+}
+
+
+void PaUtil_PrefaultStack( unsigned long size )
+{
+    /* Windows commits stack pages through guard pages as they are touched;
+       probing in page order from the top grows it without faulting later */
+    SYSTEM_INFO systemInfo;
+    volatile char *stack;
+    unsigned long i;
+
+    if( size == 0 )
+        return;
+
+    GetSystemInfo( &systemInfo );
+
+    stack = (volatile char *)_alloca( size );
+    for( i = size; i > 0; i -= (i > systemInfo.dwPageSize ? systemInfo.dwPageSize : i) )
+        stack[i - 1] = 0;
+}
+
+
+int PaUtil_AtomicCompareAndSwap( volatile long *target, long expected, long value )
+{
+    return PA_ATOMIC_CAS_( target, expected, value );
+}
+
+
+unsigned long PaUtil_GetCurrentThreadId( void )
+{
+    return GetCurrentThreadId();
 }
 
 
@@ -0,0 +1,175 @@
+/** @file patest_alsa_device_monitor.c
+	@ingroup test_src
+	@brief Tests ALSA hot-plug monitoring against a simulated /dev/snd tree.
+
+	Points PA_ALSA_DEVICE_DIR at a temporary directory, creates and removes
+	a controlC* node in it and checks that the device change callback
+	reports both. After each change the device list is refreshed and the
+	default devices must still be ALSA devices with channels in their
+	direction. Doesn't open any stream.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com/
+ * Copyright (c) 1999-2008 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "portaudio.h"
+#include "pa_linux_alsa.h"
+#include "patest_check.h"
+
+#define SIMULATED_CARD      (7)
+#define MAX_WAIT_MSEC       (2000)
+#define POLL_MSEC           (10)
+
+static volatile int gNumChanges = 0;
+static volatile int gLastCard = -1;
+static volatile int gLastAdded = -1;
+
+static void DeviceChanged( int card, int added, void *userData )
+{
+    (void) userData;
+    gLastCard = card;
+    gLastAdded = added;
+    gNumChanges++;
+}
+
+/* Wait for the monitor thread to report numChanges changes in total */
+static int WaitForChanges( int numChanges )
+{
+    int waited;
+
+    for( waited = 0; gNumChanges < numChanges && waited < MAX_WAIT_MSEC; waited += POLL_MSEC )
+        Pa_Sleep( POLL_MSEC );
+    return gNumChanges >= numChanges;
+}
+
+static void CheckDefaultDevice( PaDeviceIndex device, PaHostApiIndex alsaIndex, int input )
+{
+    const PaDeviceInfo *deviceInfo;
+
+    if( device == paNoDevice )
+        return;
+
+    CHECK( device >= 0 && device < Pa_GetDeviceCount() );
+    if( device < 0 || device >= Pa_GetDeviceCount() )
+        return;
+
+    deviceInfo = Pa_GetDeviceInfo( device );
+    CHECK( deviceInfo->hostApi == alsaIndex );
+    CHECK( (input ? deviceInfo->maxInputChannels : deviceInfo->maxOutputChannels) > 0 );
+}
+
+static void RefreshAndCheckDefaults( PaHostApiIndex alsaIndex )
+{
+    const PaHostApiInfo *hostApiInfo;
+
+    CHECK( PaAlsa_RefreshDeviceList( NULL ) == paNoError );
+
+    hostApiInfo = Pa_GetHostApiInfo( alsaIndex );
+    CheckDefaultDevice( hostApiInfo->defaultInputDevice, alsaIndex, 1 );
+    CheckDefaultDevice( hostApiInfo->defaultOutputDevice, alsaIndex, 0 );
+}
+
+int main(void);
+int main(void)
+{
+    char deviceDir[] = "/tmp/patest_alsa_device_monitor.XXXXXX";
+    char nodePath[sizeof (deviceDir) + 32];
+    PaHostApiIndex alsaIndex;
+    FILE *node;
+
+    if( mkdtemp( deviceDir ) == NULL )
+    {
+        printf( "Can't create the simulated device directory\n" );
+        return 1;
+    }
+    snprintf( nodePath, sizeof (nodePath), "%s/controlC%d", deviceDir, SIMULATED_CARD );
+
+    /* Read when monitoring starts */
+    setenv( "PA_ALSA_DEVICE_DIR", deviceDir, 1 );
+
+    if( Pa_Initialize() != paNoError )
+    {
+        printf( "Pa_Initialize failed\n" );
+        rmdir( deviceDir );
+        return 1;
+    }
+
+    alsaIndex = Pa_HostApiTypeIdToHostApiIndex( paALSA );
+    CHECK( alsaIndex >= 0 );
+    if( alsaIndex < 0 )
+        goto done;
+
+    CHECK( PaAlsa_SetDeviceChangeCallback( DeviceChanged, NULL ) == paNoError );
+
+    /* A card appearing */
+    node = fopen( nodePath, "w" );
+    CHECK( node != NULL );
+    if( node )
+        fclose( node );
+    CHECK( WaitForChanges( 1 ) );
+    CHECK( gLastCard == SIMULATED_CARD );
+    CHECK( gLastAdded == 1 );
+    RefreshAndCheckDefaults( alsaIndex );
+
+    /* Files that aren't control nodes are ignored */
+    snprintf( nodePath, sizeof (nodePath), "%s/pcmC%dD0p", deviceDir, SIMULATED_CARD );
+    node = fopen( nodePath, "w" );
+    if( node )
+        fclose( node );
+    unlink( nodePath );
+
+    /* The card going away */
+    snprintf( nodePath, sizeof (nodePath), "%s/controlC%d", deviceDir, SIMULATED_CARD );
+    CHECK( unlink( nodePath ) == 0 );
+    CHECK( WaitForChanges( 2 ) );
+    CHECK( gNumChanges == 2 );
+    CHECK( gLastCard == SIMULATED_CARD );
+    CHECK( gLastAdded == 0 );
+    RefreshAndCheckDefaults( alsaIndex );
+
+    CHECK( PaAlsa_SetDeviceChangeCallback( NULL, NULL ) == paNoError );
+
+done:
+    Pa_Terminate();
+    rmdir( deviceDir );
+
+    return CHECK_REPORT();
+}
@@ -0,0 +1,449 @@
+/*
+ * $Id: $
+ * Portable Audio I/O Library
+ * ALSA automatic search for the lowest glitch free period size and count
+ *
+ * Based on patest_wmme_find_best_latency_params.c
+ * Copyright (c) 2010 Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include <alsa/asoundlib.h>
+
+#include "portaudio.h"
+#include "pa_linux_alsa.h"
+
+
+#define DEFAULT_SAMPLE_RATE             (44100.)
+
+#ifndef M_PI
+#define M_PI  (3.14159265)
+#endif
+
+#define TABLE_SIZE              (2048)
+
+#define CHANNEL_COUNT           (2)
+
+
+/* seach parameters. we test all period counts in this range */
+#define MIN_ALSA_PERIOD_COUNT        (2)
+#define MAX_ALSA_PERIOD_COUNT        (8)
+
+/* period sizes are grown from the device's minimum, this one is used if it can't be queried */
+#define DEFAULT_MIN_ALSA_PERIOD_SIZE (16)
+#define MAX_ALSA_PERIOD_SIZE         (8192)
+
+/* each configuration has to play this long without xruns to pass */
+#define DEFAULT_TEST_SECONDS         (10)
+
+/* and must leave this much CPU headroom */
+#define MAX_CPU_LOAD                 (0.8)
+
+
+/*******************************************************************/
+
+static void printTimeAndDate( FILE *fp )
+{
+    struct tm *local;
+    time_t t;
+
+    t = time(NULL);
+    local = localtime(&t);
+    fprintf(fp, "Local time and date: %s", asctime(local));
+    local = gmtime(&t);
+    fprintf(fp, "UTC time and date: %s", asctime(local));
+}
+
+/*******************************************************************/
+
+/* The smallest period size the device supports with our channel count and sample rate. Hardware
+   devices are listed as "card: device (hw:x,y)", plugins by their ALSA name. */
+static int getMinPeriodSize( const char *deviceName, double sampleRate )
+{
+    char alsaName[64];
+    const char *hw = strstr( deviceName, "(hw:" );
+    snd_pcm_t *pcm;
+    snd_pcm_hw_params_t *hwParams;
+    snd_pcm_uframes_t minPeriodSize;
+    unsigned int rate = (unsigned int)sampleRate;
+    int dir = 0, result = DEFAULT_MIN_ALSA_PERIOD_SIZE;
+
+    if( hw != NULL ){
+        strncpy( alsaName, hw + 1, sizeof(alsaName) - 1 );
+        alsaName[sizeof(alsaName) - 1] = '\0';
+        alsaName[strcspn( alsaName, ")" )] = '\0';
+    }else{
+        strncpy( alsaName, deviceName, sizeof(alsaName) - 1 );
+        alsaName[sizeof(alsaName) - 1] = '\0';
+    }
+
+    if( snd_pcm_open( &pcm, alsaName, SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK ) < 0 )
+        return result;
+
+    snd_pcm_hw_params_alloca( &hwParams );
+    if( snd_pcm_hw_params_any( pcm, hwParams ) >= 0 &&
+            snd_pcm_hw_params_set_channels( pcm, hwParams, CHANNEL_COUNT ) >= 0 &&
+            snd_pcm_hw_params_set_rate_near( pcm, hwParams, &rate, NULL ) >= 0 &&
+            snd_pcm_hw_params_get_period_size_min( hwParams, &minPeriodSize, &dir ) >= 0 ){
+        result = (int)minPeriodSize;
+    }
+
+    snd_pcm_close( pcm );
+    return result;
+}
+
+/*******************************************************************/
+
+typedef struct
+{
+    float sine[TABLE_SIZE];
+    double phase;
+    double phaseIncrement;
+    volatile int xrunCount;
+}
+paTestData;
+
+static paTestData data;
+
+/* This routine will be called by the PortAudio engine when audio is needed.
+** It may called at interrupt level on some machines so don't do anything
+** that could mess up the system like calling malloc() or free().
+*/
+static int patestCallback( const void *inputBuffer, void *outputBuffer,
+                            unsigned long framesPerBuffer,
+                            const PaStreamCallbackTimeInfo* timeInfo,
+                            PaStreamCallbackFlags statusFlags,
+                            void *userData )
+{
+    paTestData *data = (paTestData*)userData;
+    float *out = (float*)outputBuffer;
+    unsigned long i,j;
+
+    (void) timeInfo; /* Prevent unused variable warnings. */
+    (void) inputBuffer;
+
+    /* ALSA reports underruns detected while waiting for the device through this flag */
+    if( statusFlags & paOutputUnderflow )
+        ++data->xrunCount;
+
+    for( i=0; i<framesPerBuffer; i++ )
+    {
+        float x = data->sine[(int)data->phase] * .5f;
+        data->phase += data->phaseIncrement;
+        if( data->phase >= TABLE_SIZE ){
+            data->phase -= TABLE_SIZE;
+        }
+
+        for( j = 0; j < CHANNEL_COUNT; ++j ){
+            *out++ = x;
+        }
+    }
+
+    return paContinue;
+}
+
+
+#define YES     1
+#define NO      0
+
+
+static int playForTestWindow( int deviceIndex, double sampleRate,
+                             int framesPerPeriod, int periodCount, int testSeconds, double *outputLatency )
+{
+    PaStreamParameters outputParameters;
+    PaStream *stream = NULL;
+    PaError err;
+    double cpuLoad, maxCpuLoad = 0.;
+    int i;
+
+    outputParameters.device = deviceIndex;
+    outputParameters.channelCount = CHANNEL_COUNT;
+    outputParameters.sampleFormat = paFloat32; /* 32 bit floating point processing */
+    /* the buffer size is derived from the suggested latency */
+    outputParameters.suggestedLatency = (framesPerPeriod * periodCount) / sampleRate;
+    outputParameters.hostApiSpecificStreamInfo = NULL;
+
+    PaAlsa_SetNumPeriods( periodCount );
+
+    err = Pa_OpenStream(
+              &stream,
+              NULL, /* no input */
+              &outputParameters,
+              sampleRate,
+              framesPerPeriod, /* ALSA uses this as the period size when possible */
+              paClipOff,      /* we won't output out of range samples so don't bother clipping them */
+              patestCallback,
+              &data );
+    if( err != paNoError )
+    {
+        stream = NULL; /* undefined after a failed open */
+        goto error;
+    }
+
+    *outputLatency = Pa_GetStreamInfo( stream )->outputLatency;
+
+    data.phase = 0;
+    data.phaseIncrement = 15 + ((rand()%100) / 10); /* randomise pitch */
+    data.xrunCount = 0;
+
+    err = Pa_StartStream( stream );
+    if( err != paNoError ) goto error;
+
+    /* give up early on the first xrun, or when the callback leaves too little headroom */
+    for( i=0; i < testSeconds * 10 && data.xrunCount == 0 && maxCpuLoad <= MAX_CPU_LOAD; ++i )
+    {
+        Pa_Sleep( 100 );
+
+        cpuLoad = Pa_GetStreamCpuLoad( stream );
+        if( cpuLoad > maxCpuLoad )
+            maxCpuLoad = cpuLoad;
+    }
+
+    err = Pa_StopStream( stream );
+    if( err != paNoError ) goto error;
+
+    err = Pa_CloseStream( stream );
+    stream = NULL;
+    if( err != paNoError ) goto error;
+
+    printf( "Period size %d, %d periods: %d xruns, max CPU load %f -> %s\n", framesPerPeriod, periodCount,
+            data.xrunCount, maxCpuLoad, (data.xrunCount == 0 && maxCpuLoad <= MAX_CPU_LOAD) ? "ok" : "glitchy" );
+
+    return (data.xrunCount == 0 && maxCpuLoad <= MAX_CPU_LOAD) ? YES : NO;
+
+error:
+    /* the device refusing a configuration counts as a failure, not as an error */
+    printf( "Period size %d, %d periods: %s\n", framesPerPeriod, periodCount, Pa_GetErrorText( err ) );
+    if( stream )
+        Pa_CloseStream( stream ); /* the next configuration needs the device */
+    return NO;
+}
+
+/*******************************************************************/
+static void usage( int alsaHostApiIndex )
+{
+    int i;
+
+    fprintf( stderr, "PortAudio ALSA output latency automatic search\n" );
+    fprintf( stderr, "Usage: x alsa-device-index [sampleRate [test-seconds [min-period-count max-period-count]]]\n" );
+    fprintf( stderr, "Invalid device index. Use one of these:\n" );
+    for( i=0; i < Pa_GetDeviceCount(); ++i ){
+
+        if( Pa_GetDeviceInfo(i)->hostApi == alsaHostApiIndex && Pa_GetDeviceInfo(i)->maxOutputChannels > 0  )
+            fprintf( stderr, "%d (%s)\n", i, Pa_GetDeviceInfo(i)->name );
+    }
+    Pa_Terminate();
+    exit(-1);
+}
+
+/*
+    For each period count the period size is doubled starting from the smallest size
+    until a configuration plays without xruns for the test window, then the smallest
+    working size is searched for between the last failing and the first working size.
+*/
+
+int main(int argc, char* argv[])
+{
+    PaError err;
+    int i;
+    int deviceIndex;
+    int periodCount, periodSize, minPeriodSize, smallestWorkingPeriodSize, largestFailingPeriodSize;
+    int min, max, mid;
+    FILE *resultsFp;
+    int alsaHostApiIndex;
+    const PaHostApiInfo *alsaHostApiInfo;
+    double sampleRate = DEFAULT_SAMPLE_RATE;
+    int testSeconds = DEFAULT_TEST_SECONDS;
+    int alsaMinPeriodCount = MIN_ALSA_PERIOD_COUNT;
+    int alsaMaxPeriodCount = MAX_ALSA_PERIOD_COUNT;
+    double outputLatency, smallestWorkingLatency;
+    int bestPeriodCount = 0, bestPeriodSize = 0;
+    double bestLatency = 0.;
+
+    err = Pa_Initialize();
+    if( err != paNoError ) goto error;
+
+    alsaHostApiIndex = Pa_HostApiTypeIdToHostApiIndex( paALSA );
+    if( alsaHostApiIndex < 0 ){
+        err = alsaHostApiIndex;
+        goto error;
+    }
+    alsaHostApiInfo = Pa_GetHostApiInfo( alsaHostApiIndex );
+
+    if( argc > 6 || argc == 5 )
+        usage(alsaHostApiIndex);
+
+    deviceIndex = alsaHostApiInfo->defaultOutputDevice;
+    if( argc >= 2 ){
+        deviceIndex = -1;
+        if( sscanf( argv[1], "%d", &deviceIndex ) != 1 )
+            usage(alsaHostApiIndex);
+        if( deviceIndex < 0 || deviceIndex >= Pa_GetDeviceCount() || Pa_GetDeviceInfo(deviceIndex)->hostApi != alsaHostApiIndex ){
+            usage(alsaHostApiIndex);
+        }
+    }
+
+    printf( "Using device id %d (%s)\n", deviceIndex, Pa_GetDeviceInfo(deviceIndex)->name );
+
+    if( argc >= 3 ){
+        if( sscanf( argv[2], "%lf", &sampleRate ) != 1 )
+            usage(alsaHostApiIndex);
+    }
+
+    printf( "Testing with sample rate %f.\n", (float)sampleRate );
+
+    if( argc >= 4 ){
+        if( sscanf( argv[3], "%d", &testSeconds ) != 1 || testSeconds < 1 )
+            usage(alsaHostApiIndex);
+    }
+
+    printf( "Each configuration has to run %d seconds without xruns.\n", testSeconds );
+
+    if( argc == 6 ){
+        if( sscanf( argv[4], "%d", &alsaMinPeriodCount ) != 1 )
+            usage(alsaHostApiIndex);
+        if( sscanf( argv[5], "%d", &alsaMaxPeriodCount ) != 1 )
+            usage(alsaHostApiIndex);
+    }
+
+    printf( "Testing period counts from %d to %d\n", alsaMinPeriodCount, alsaMaxPeriodCount );
+
+    minPeriodSize = getMinPeriodSize( Pa_GetDeviceInfo( deviceIndex )->name, sampleRate );
+    printf( "Starting from the device's minimum period size of %d frames\n", minPeriodSize );
+
+
+    /* initialise sinusoidal wavetable */
+    for( i=0; i<TABLE_SIZE; i++ )
+    {
+        data.sine[i] = (float) sin( ((double)i/(double)TABLE_SIZE) * M_PI * 2. );
+    }
+
+    data.phase = 0;
+
+    resultsFp = fopen( "results.txt", "at" );
+    if( resultsFp == NULL ){
+        fprintf( stderr, "Can't open results.txt for writing\n" );
+        Pa_Terminate();
+        return 1;
+    }
+    fprintf( resultsFp, "*** ALSA smallest working output period sizes\n" );
+
+    printTimeAndDate( resultsFp );
+
+    fprintf( resultsFp, "audio device: %s\n", Pa_GetDeviceInfo( deviceIndex )->name );
+    fflush( resultsFp );
+
+    fprintf( resultsFp, "Sample rate: %f\n", (float)sampleRate );
+    fprintf( resultsFp, "Period count, Smallest working period size (frames), Output latency (Seconds)\n" );
+
+    for( periodCount = alsaMinPeriodCount; periodCount <= alsaMaxPeriodCount; ++periodCount ){
+
+        printf( "Test %d of %d\n", (periodCount - alsaMinPeriodCount) + 1, (alsaMaxPeriodCount-alsaMinPeriodCount) + 1 );
+        printf( "Testing with %d periods...\n", periodCount );
+
+        /* grow the period size until playback is glitch free */
+        largestFailingPeriodSize = 0;
+        smallestWorkingPeriodSize = 0;
+        for( periodSize = minPeriodSize; periodSize <= MAX_ALSA_PERIOD_SIZE; periodSize *= 2 ){
+            if( playForTestWindow( deviceIndex, sampleRate, periodSize, periodCount, testSeconds, &outputLatency ) == YES ){
+                smallestWorkingPeriodSize = periodSize;
+                smallestWorkingLatency = outputLatency;
+                break;
+            }
+            largestFailingPeriodSize = periodSize;
+        }
+
+        if( smallestWorkingPeriodSize == 0 ){
+            printf( "No working period size for %d periods\n", periodCount );
+            fprintf( resultsFp, "%d, none, none\n", periodCount );
+            fflush( resultsFp );
+            continue;
+        }
+
+        /*
+            Binary search after Niklaus Wirth
+            from http://en.wikipedia.org/wiki/Binary_search_algorithm#The_algorithm
+         */
+        min = largestFailingPeriodSize + 1;
+        max = smallestWorkingPeriodSize - 1;
+        while( min <= max ){
+            mid = min + ((max - min) / 2);
+
+            if( playForTestWindow( deviceIndex, sampleRate, mid, periodCount, testSeconds, &outputLatency ) == YES ){
+                max = mid - 1;
+                smallestWorkingPeriodSize = mid;
+                smallestWorkingLatency = outputLatency;
+            }else{
+                min = mid + 1;
+            }
+        }
+
+        printf( "Smallest working period size for %d periods is: %d\n", periodCount, smallestWorkingPeriodSize );
+        printf( "Corresponding to output latency of %f seconds.\n", smallestWorkingLatency );
+
+        fprintf( resultsFp, "%d, %d, %f\n", periodCount, smallestWorkingPeriodSize, smallestWorkingLatency );
+        fflush( resultsFp );
+
+        if( bestPeriodCount == 0 || smallestWorkingLatency < bestLatency ){
+            bestPeriodCount = periodCount;
+            bestPeriodSize = smallestWorkingPeriodSize;
+            bestLatency = smallestWorkingLatency;
+        }
+    }
+
+    if( bestPeriodCount != 0 ){
+        /* these are the values to persist, pass them to PaAlsa_SetNumPeriods() and Pa_OpenStream() */
+        printf( "Best parameters: PaAlsa_SetNumPeriods( %d ), framesPerBuffer %d, output latency %f seconds\n",
+                bestPeriodCount, bestPeriodSize, bestLatency );
+        fprintf( resultsFp, "Best: %d, %d, %f\n", bestPeriodCount, bestPeriodSize, bestLatency );
+    }
+
+    fprintf( resultsFp, "###\n" );
+    fclose( resultsFp );
+
+    Pa_Terminate();
+    printf("Test finished.\n");
+
+    return err;
+error:
+    Pa_Terminate();
+    fprintf( stderr, "An error occured while using the portaudio stream\n" );
+    fprintf( stderr, "Error number: %d\n", err );
+    fprintf( stderr, "Error message: %s\n", Pa_GetErrorText( err ) );
+    return err;
+}
@@ -0,0 +1,68 @@
+/** @file patest_check.h
+	@ingroup test_src
+	@brief Tally of passed and failed checks for the tests of internal
+	utilities which don't open a stream.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com/
+ * Copyright (c) 1999-2008 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+#ifndef PATEST_CHECK_H
+#define PATEST_CHECK_H
+
+#include <stdio.h>
+
+static int gNumPassed = 0;
+static int gNumFailed = 0;
+
+/* Print the expression if it fails. Tally success or failure. */
+#define CHECK(_exp) \
+    do \
+    { \
+        if ((_exp)) { \
+            gNumPassed++; \
+        } \
+        else { \
+            printf( "FAILED line %d: %s\n", __LINE__, #_exp ); \
+            gNumFailed++; \
+        } \
+    } while(0)
+
+/* Print the tally, evaluates to the exit status of the test */
+#define CHECK_REPORT() \
+    ( printf( "Test report: %d passed, %d failed.\n", gNumPassed, gNumFailed ), (gNumFailed == 0) ? 0 : 1 )
+
+#endif /* PATEST_CHECK_H */
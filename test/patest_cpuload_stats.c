@@ -0,0 +1,141 @@
+/** @file patest_cpuload_stats.c
+	@ingroup test_src
+	@brief Tests the CPU load peak and percentile statistics in pa_cpuload.c.
+
+	Feeds a known distribution of loads to a CPU load measurer and checks the
+	peak, median, 99th and 99.9th percentile it reports. The measurer reads
+	the time through PaUtil_GetTime(), which this program replaces with a
+	simulated clock, so the measured loads are exact. Doesn't open any stream.
+
+	Because of the replaced clock it is built from pa_cpuload.c alone, not
+	linked with the library.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com/
+ * Copyright (c) 1999-2008 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+#include <stdio.h>
+#include <math.h>
+
+#include "portaudio.h"
+#include "pa_util.h"
+#include "pa_cpuload.h"
+#include "patest_check.h"
+
+#define SAMPLE_RATE         (1000.)
+#define FRAMES_PER_BUFFER   (100)   /* 100% load is 0.1 seconds */
+
+/* Simulated clock, replaces the implementation in pa_*_util.c */
+static PaTime now_ = 0.;
+
+PaTime PaUtil_GetTime( void )
+{
+    return now_;
+}
+
+static void Measure( PaUtilCpuLoadMeasurer *measurer, double load, int count )
+{
+    int i;
+
+    for( i = 0; i < count; ++i )
+    {
+        PaUtil_BeginCpuLoadMeasurement( measurer );
+        now_ += load * FRAMES_PER_BUFFER / SAMPLE_RATE;
+        PaUtil_EndCpuLoadMeasurement( measurer, FRAMES_PER_BUFFER );
+        now_ += 1.;
+    }
+}
+
+/* Percentiles are reported as the upper bound of a quarter octave bucket */
+static int IsBucketBound( double reported, double load )
+{
+    return reported >= load && reported <= load * pow( 2., .25 ) * 1.000001;
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    PaUtilCpuLoadMeasurer measurer;
+    PaUtilCpuLoadStatistics statistics;
+
+    printf( "PortAudio Test: CPU load statistics.\n" );
+
+    PaUtil_InitializeCpuLoadMeasurer( &measurer, SAMPLE_RATE );
+    PaUtil_SetCpuLoadTimeConstant( &measurer, 0. );  /* no smoothing, the load is the last measurement */
+
+    PaUtil_GetCpuLoadStatistics( &measurer, &statistics );
+    CHECK( statistics.measurementCount == 0 );
+    CHECK( statistics.peakLoad == 0. && statistics.medianLoad == 0. && statistics.p99Load == 0. );
+
+    /* 985 ordinary callbacks, 10 slow ones and 5 near misses */
+    Measure( &measurer, 0.27, 985 );
+    Measure( &measurer, 0.55, 10 );
+    Measure( &measurer, 0.9, 5 );
+
+    PaUtil_GetCpuLoadStatistics( &measurer, &statistics );
+    printf( "count = %lu, average = %f, peak = %f, median = %f, p99 = %f, p99.9 = %f\n",
+            statistics.measurementCount, statistics.averageLoad, statistics.peakLoad,
+            statistics.medianLoad, statistics.p99Load, statistics.p999Load );
+
+    CHECK( statistics.measurementCount == 1000 );
+    CHECK( fabs( statistics.averageLoad - 0.9 ) < 1e-6 );
+    CHECK( fabs( statistics.peakLoad - 0.9 ) < 1e-6 );
+    CHECK( IsBucketBound( statistics.medianLoad, 0.27 ) );
+    CHECK( IsBucketBound( statistics.p99Load, 0.55 ) );
+    CHECK( IsBucketBound( statistics.p999Load, 0.9 ) );
+
+    /* a single overload moves the peak, but not the percentiles */
+    Measure( &measurer, 1.5, 1 );
+    PaUtil_GetCpuLoadStatistics( &measurer, &statistics );
+    CHECK( statistics.measurementCount == 1001 );
+    CHECK( fabs( statistics.peakLoad - 1.5 ) < 1e-6 );
+    CHECK( IsBucketBound( statistics.medianLoad, 0.27 ) );
+    CHECK( IsBucketBound( statistics.p99Load, 0.55 ) );
+
+    /* loads outside the histogram's range are counted in its first and last buckets */
+    PaUtil_ResetCpuLoadMeasurer( &measurer );
+    Measure( &measurer, 0.00001, 10 );
+    PaUtil_GetCpuLoadStatistics( &measurer, &statistics );
+    CHECK( statistics.measurementCount == 10 );
+    CHECK( statistics.medianLoad > 0. && statistics.medianLoad <= pow( 2., -12. ) * pow( 2., .25 ) * 1.000001 );
+    Measure( &measurer, 100., 20 );
+    PaUtil_GetCpuLoadStatistics( &measurer, &statistics );
+    CHECK( fabs( statistics.peakLoad - 100. ) < 1e-6 );
+    CHECK( fabs( statistics.p99Load - 16. ) < 1e-6 );
+
+    return CHECK_REPORT();
+}
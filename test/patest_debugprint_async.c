@@ -0,0 +1,140 @@
+/** @file patest_debugprint_async.c
+	@ingroup test_src
+	@brief Tests the asynchronous mode of PaUtil_DebugPrint() in pa_debugprint.c.
+
+	Holds up the output thread inside the installed log function, overflows
+	the message queue behind it and checks that the excess messages are
+	counted by PaUtil_GetDroppedDebugPrintCount(), that the queued ones are
+	delivered in order and that the drops are reported. Doesn't open any
+	stream.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com/
+ * Copyright (c) 1999-2008 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "portaudio.h"
+#include "pa_util.h"
+#include "pa_debugprint.h"
+#include "patest_check.h"
+
+#define EXTRA_MESSAGES  (10)
+#define MAX_MESSAGES    (PA_DEBUG_PRINT_ASYNC_QUEUE_SIZE + 8)
+
+static volatile int entered_ = 0;
+static volatile int release_ = 0;
+static int messageCount_ = 0;
+static int outOfOrderCount_ = 0;
+static int longestMessage_ = 0;
+static char lastMessage_[PA_DEBUG_PRINT_ASYNC_MESSAGE_SIZE * 2];
+
+/* Installed with PaUtil_SetDebugPrintFunction(), called by the output thread */
+static void LogFunction( const char *text )
+{
+    int number;
+
+    if( !entered_ )
+    {
+        /* hold up the output thread while the main thread fills the queue */
+        entered_ = 1;
+        while( !release_ )
+            Pa_Sleep( 1 );
+    }
+
+    if( sscanf( text, "message %d", &number ) == 1 && number != messageCount_ )
+        ++outOfOrderCount_;
+    if( (int)strlen( text ) > longestMessage_ )
+        longestMessage_ = (int)strlen( text );
+    ++messageCount_;
+
+    strncpy( lastMessage_, text, sizeof(lastMessage_) - 1 );
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    char longText[PA_DEBUG_PRINT_ASYNC_MESSAGE_SIZE * 2];
+    unsigned long droppedBefore;
+    int i, waited;
+
+    printf( "PortAudio Test: asynchronous debug print.\n" );
+
+    PaUtil_InitializeClock();
+    PaUtil_SetDebugPrintFunction( LogFunction );
+
+    CHECK( PaUtil_EnableAsyncDebugPrint( 1 ) == 0 );
+    droppedBefore = PaUtil_GetDroppedDebugPrintCount();
+
+    PaUtil_DebugPrint( "message %d\n", 0 );
+    for( waited = 0; !entered_ && waited < 5000; ++waited )
+        Pa_Sleep( 1 );
+    CHECK( entered_ );
+
+    /* the first message still holds its slot, so one less than the queue size fits behind it */
+    for( i = 1; i < PA_DEBUG_PRINT_ASYNC_QUEUE_SIZE + EXTRA_MESSAGES; ++i )
+        PaUtil_DebugPrint( "message %d\n", i );
+    CHECK( PaUtil_GetDroppedDebugPrintCount() - droppedBefore == EXTRA_MESSAGES );
+
+    /* disabling waits for the queue to be written, followed by the drop report */
+    release_ = 1;
+    CHECK( PaUtil_EnableAsyncDebugPrint( 0 ) == 0 );
+
+    printf( "%d messages delivered, %lu dropped\n", messageCount_,
+            PaUtil_GetDroppedDebugPrintCount() - droppedBefore );
+    CHECK( messageCount_ == PA_DEBUG_PRINT_ASYNC_QUEUE_SIZE + 1 );
+    CHECK( outOfOrderCount_ == 0 );
+    CHECK( strstr( lastMessage_, "10 messages dropped" ) != NULL );
+
+    /* long messages are truncated to fit a queue slot */
+    CHECK( PaUtil_EnableAsyncDebugPrint( 1 ) == 0 );
+    memset( longText, 'x', sizeof(longText) - 1 );
+    longText[sizeof(longText) - 1] = '\0';
+    PaUtil_DebugPrint( "%s", longText );
+    CHECK( PaUtil_EnableAsyncDebugPrint( 0 ) == 0 );
+    CHECK( longestMessage_ == PA_DEBUG_PRINT_ASYNC_MESSAGE_SIZE - 1 );
+
+    /* synchronous again: written before PaUtil_DebugPrint() returns */
+    messageCount_ = 0;
+    PaUtil_DebugPrint( "message %d\n", 0 );
+    CHECK( messageCount_ == 1 );
+
+    PaUtil_SetDebugPrintFunction( NULL );
+
+    return CHECK_REPORT();
+}
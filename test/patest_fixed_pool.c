@@ -0,0 +1,142 @@
+/** @file patest_fixed_pool.c
+	@ingroup test_src
+	@brief Tests the fixed size block pool in pa_allocation.c.
+
+	Checks that every block honours the requested alignment, that the pool
+	reports exhaustion once all blocks are in use, and that freed blocks are
+	handed out again. Doesn't open any stream.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com/
+ * Copyright (c) 1999-2008 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "portaudio.h"
+#include "pa_allocation.h"
+#include "patest_check.h"
+
+#define CAPACITY    (16)
+
+static void TestPool( long blockSize, long alignment )
+{
+    PaUtilFixedPool *pool;
+    void *blocks[ CAPACITY ];
+    void *block;
+    long expectedAlignment = (alignment == 0) ? PA_ALLOCATION_DEFAULT_ALIGNMENT : alignment;
+    int i, j;
+
+    printf( "blockSize = %ld, alignment = %ld\n", blockSize, alignment );
+
+    pool = PaUtil_CreateFixedPool( blockSize, CAPACITY, alignment );
+    CHECK( pool != NULL );
+    if( !pool )
+        return;
+
+    CHECK( PaUtil_GetFixedPoolAvailable( pool ) == CAPACITY );
+
+    /* alignment, and no two blocks overlap */
+    for( i = 0; i < CAPACITY; ++i )
+    {
+        blocks[i] = PaUtil_FixedPoolAllocate( pool );
+        CHECK( blocks[i] != NULL );
+        if( !blocks[i] )
+            goto done;
+        CHECK( ((size_t)blocks[i] & (size_t)(expectedAlignment - 1)) == 0 );
+        memset( blocks[i], i, blockSize );
+        CHECK( PaUtil_GetFixedPoolAvailable( pool ) == CAPACITY - 1 - i );
+    }
+    for( i = 0; i < CAPACITY; ++i )
+    {
+        for( j = 0; j < blockSize; ++j )
+        {
+            if( ((unsigned char*)blocks[i])[j] != (unsigned char)i )
+            {
+                CHECK( !"block contents were overwritten by a neighbour" );
+                break;
+            }
+        }
+    }
+
+    /* exhaustion */
+    CHECK( PaUtil_FixedPoolAllocate( pool ) == NULL );
+    CHECK( PaUtil_GetFixedPoolAvailable( pool ) == 0 );
+
+    /* free and reuse */
+    PaUtil_FixedPoolFree( pool, blocks[3] );
+    CHECK( PaUtil_GetFixedPoolAvailable( pool ) == 1 );
+    block = PaUtil_FixedPoolAllocate( pool );
+    CHECK( block == blocks[3] );
+    CHECK( PaUtil_FixedPoolAllocate( pool ) == NULL );
+
+    PaUtil_FixedPoolFree( pool, NULL );
+    CHECK( PaUtil_GetFixedPoolAvailable( pool ) == 0 );
+
+    for( i = 0; i < CAPACITY; ++i )
+        PaUtil_FixedPoolFree( pool, blocks[i] );
+    CHECK( PaUtil_GetFixedPoolAvailable( pool ) == CAPACITY );
+
+    for( i = 0; i < CAPACITY; ++i )
+    {
+        block = PaUtil_FixedPoolAllocate( pool );
+        CHECK( block != NULL );
+        CHECK( ((size_t)block & (size_t)(expectedAlignment - 1)) == 0 );
+    }
+    CHECK( PaUtil_FixedPoolAllocate( pool ) == NULL );
+
+done:
+    PaUtil_DestroyFixedPool( pool );
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    printf( "PortAudio Test: fixed size block pool.\n" );
+
+    TestPool( 1, 0 );
+    TestPool( 24, 0 );
+    TestPool( 100, PA_ALLOCATION_CACHE_LINE_ALIGNMENT );
+    TestPool( 256, 256 );
+
+    /* invalid arguments */
+    CHECK( PaUtil_CreateFixedPool( 0, CAPACITY, 0 ) == NULL );
+    CHECK( PaUtil_CreateFixedPool( 16, 0, 0 ) == NULL );
+    CHECK( PaUtil_CreateFixedPool( 16, CAPACITY, 24 ) == NULL );
+
+    return CHECK_REPORT();
+}
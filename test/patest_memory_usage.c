@@ -0,0 +1,98 @@
+/** @file patest_memory_usage.c
+	@ingroup test_src
+	@brief Tests the memory accounting behind Pa_GetMemoryUsage.
+
+	Checks that tagged allocations are counted in their own category and in
+	paMemoryTotal, that freeing them is counted too, and that an invalid
+	category is rejected. Doesn't open any stream.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com/
+ * Copyright (c) 1999-2008 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "portaudio.h"
+#include "pa_util.h"
+#include "patest_check.h"
+
+#define BLOCK_SIZE  (1000)
+
+int main(void);
+int main(void)
+{
+    PaMemoryUsage before, beforeTotal, usage, total;
+    void *block;
+
+    printf( "PortAudio Test: memory usage accounting.\n" );
+
+    /* Memory is accounted for whether or not PortAudio is initialized */
+    CHECK( Pa_GetMemoryUsage( paMemoryRingBuffer, &before ) == paNoError );
+    CHECK( Pa_GetMemoryUsage( paMemoryTotal, &beforeTotal ) == paNoError );
+
+    block = PaUtil_AllocateTaggedMemory( BLOCK_SIZE, paMemoryRingBuffer );
+    CHECK( block != NULL );
+    if( block == NULL )
+        return CHECK_REPORT();
+
+    CHECK( Pa_GetMemoryUsage( paMemoryRingBuffer, &usage ) == paNoError );
+    CHECK( usage.currentBytes == before.currentBytes + BLOCK_SIZE );
+    CHECK( usage.currentBlocks == before.currentBlocks + 1 );
+    CHECK( usage.totalAllocations == before.totalAllocations + 1 );
+    CHECK( usage.peakBytes >= usage.currentBytes );
+
+    CHECK( Pa_GetMemoryUsage( paMemoryTotal, &total ) == paNoError );
+    CHECK( total.currentBytes == beforeTotal.currentBytes + BLOCK_SIZE );
+    CHECK( total.currentBlocks == beforeTotal.currentBlocks + 1 );
+
+    PaUtil_FreeMemory( block );
+
+    CHECK( Pa_GetMemoryUsage( paMemoryRingBuffer, &usage ) == paNoError );
+    CHECK( usage.currentBytes == before.currentBytes );
+    CHECK( usage.currentBlocks == before.currentBlocks );
+    CHECK( usage.totalAllocations == before.totalAllocations + 1 );
+    CHECK( usage.peakBytes >= before.currentBytes + BLOCK_SIZE );
+
+    /* invalid categories are rejected without touching usage */
+    memset( &usage, 0xAB, sizeof (usage) );
+    memcpy( &total, &usage, sizeof (usage) );
+    CHECK( Pa_GetMemoryUsage( (PaMemoryCategory)(paMemoryTotal + 1), &usage ) == paInvalidArgument );
+    CHECK( Pa_GetMemoryUsage( (PaMemoryCategory)-1, &usage ) == paInvalidArgument );
+    CHECK( memcmp( &usage, &total, sizeof (usage) ) == 0 );
+
+    return CHECK_REPORT();
+}
@@ -0,0 +1,189 @@
+/** @file patest_process_stats.c
+	@ingroup test_src
+	@brief Tests the callback timing, wakeup jitter and xrun statistics
+	gathered by the buffer processor in pa_process.c.
+
+	Drives a buffer processor the way a host API would, with a simulated
+	clock so that callback durations and wakeup times are exact, and checks
+	the statistics returned by PaUtil_GetBufferProcessorStatistics(). Doesn't
+	open any stream.
+
+	The clock and the few other library functions pa_process.c calls are
+	replaced here, so it is built from pa_process.c, pa_converters.c and
+	pa_dither.c, not linked with the library.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com/
+ * Copyright (c) 1999-2008 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "portaudio.h"
+#include "pa_util.h"
+#include "pa_process.h"
+#include "pa_trace.h"
+#include "patest_check.h"
+
+#define SAMPLE_RATE         (1000.)
+#define FRAMES_PER_BUFFER   (250)   /* a buffer lasts 0.25 seconds */
+#define BUFFER_DURATION     (FRAMES_PER_BUFFER / SAMPLE_RATE)
+
+#define CHECK_TIME( time, expected ) CHECK( fabs( (time) - (expected) ) < 1e-9 )
+
+/* Simulated clock and stand-ins for the rest of the library */
+static PaTime now_ = 100.;
+static PaTime callbackDuration_ = 0.;
+
+PaTime PaUtil_GetTime( void ) { return now_; }
+void *PaUtil_AllocateTaggedMemory( long size, PaMemoryCategory category ) { (void)category; return malloc( size ); }
+void PaUtil_FreeMemory( void *block ) { free( block ); }
+long PaUtil_LockMemory( void *block, long size ) { (void)block; (void)size; return 0; }
+PaUtilTrace *PaUtil_GetStreamTrace( void ) { return NULL; }
+void PaUtil_TraceEvent( PaUtilTrace *trace, const char *format, long arg0, long arg1, long arg2, long arg3 )
+    { (void)trace; (void)format; (void)arg0; (void)arg1; (void)arg2; (void)arg3; }
+void PaUtil_TraceBegin( PaUtilTrace *trace, const char *name ) { (void)trace; (void)name; }
+void PaUtil_TraceEnd( PaUtilTrace *trace, const char *name ) { (void)trace; (void)name; }
+PaError Pa_GetSampleSize( PaSampleFormat format ) { return format == paFloat32 ? 4 : paSampleFormatNotSupported; }
+
+static int patestCallback( const void *inputBuffer, void *outputBuffer,
+                           unsigned long framesPerBuffer,
+                           const PaStreamCallbackTimeInfo* timeInfo,
+                           PaStreamCallbackFlags statusFlags,
+                           void *userData )
+{
+    (void)inputBuffer; (void)timeInfo; (void)statusFlags; (void)userData;
+
+    memset( outputBuffer, 0, framesPerBuffer * sizeof(float) );
+    now_ += callbackDuration_;
+    return paContinue;
+}
+
+/* Process one host buffer which was delivered at the given time */
+static void ProcessHostBuffer( PaUtilBufferProcessor *bp, PaTime wakeupTime, PaTime duration,
+        PaStreamCallbackFlags flags )
+{
+    static float buffer[FRAMES_PER_BUFFER];
+    PaStreamCallbackTimeInfo timeInfo = { 0, 0, 0 };
+    int callbackResult = paContinue;
+
+    now_ = wakeupTime;
+    callbackDuration_ = duration;
+
+    PaUtil_BeginBufferProcessing( bp, &timeInfo, flags );
+    PaUtil_SetOutputFrameCount( bp, 0 );
+    PaUtil_SetInterleavedOutputChannels( bp, 0, buffer, 0 );
+    PaUtil_EndBufferProcessing( bp, &callbackResult );
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    PaUtilBufferProcessor bp;
+    PaUtilBufferProcessorStatistics statistics;
+    PaTime t = 100.;
+    int i;
+
+    printf( "PortAudio Test: buffer processor statistics.\n" );
+
+    CHECK( PaUtil_InitializeBufferProcessor( &bp, 0, 0, 0, 1, paFloat32, paFloat32, SAMPLE_RATE, paNoFlag,
+            FRAMES_PER_BUFFER, FRAMES_PER_BUFFER, paUtilFixedHostBufferSize, patestCallback, NULL ) == paNoError );
+
+    PaUtil_GetBufferProcessorStatistics( &bp, &statistics );
+    CHECK( statistics.callbackCount == 0 && statistics.wakeupCount == 0 );
+
+    /* 8 punctual buffers. The first wakeup has no predecessor to measure jitter against */
+    for( i = 0; i < 8; ++i, t += BUFFER_DURATION )
+        ProcessHostBuffer( &bp, t, 0.01 * (i + 1), 0 );
+
+    /* one late wakeup, a third of a buffer late, with a callback which overruns its budget */
+    t += BUFFER_DURATION / 3.;
+    ProcessHostBuffer( &bp, t, 0.3, paOutputUnderflow );
+    t += BUFFER_DURATION;
+
+    /* a whole period late */
+    t += BUFFER_DURATION;
+    ProcessHostBuffer( &bp, t, 0.02, paInputOverflow | paOutputUnderflow );
+
+    PaUtil_GetBufferProcessorStatistics( &bp, &statistics );
+    printf( "callbacks = %lu, min = %f, max = %f, over budget = %lu, wakeups = %lu, max jitter = %f\n",
+            statistics.callbackCount, statistics.minCallbackDuration, statistics.maxCallbackDuration,
+            statistics.overBudgetCallbackCount, statistics.wakeupCount, statistics.maxWakeupJitter );
+
+    CHECK( statistics.callbackCount == 10 );
+    CHECK_TIME( statistics.minCallbackDuration, 0.01 );
+    CHECK_TIME( statistics.maxCallbackDuration, 0.3 );
+    CHECK_TIME( statistics.totalCallbackDuration, 0.36 + 0.3 + 0.02 );
+    CHECK( statistics.overBudgetCallbackCount == 1 );
+
+    CHECK( statistics.wakeupCount == 9 );
+    CHECK_TIME( statistics.maxWakeupJitter, BUFFER_DURATION );
+    CHECK_TIME( statistics.totalWakeupJitter, BUFFER_DURATION / 3. + BUFFER_DURATION );
+    CHECK( statistics.wakeupJitterHistogram[0] == 7 );
+    CHECK( statistics.wakeupJitterHistogram[3] == 1 ); /* 1/4 to 1/2 of a period */
+    CHECK( statistics.wakeupJitterHistogram[paWakeupJitterBinCount - 1] == 1 );
+
+    CHECK( statistics.inputUnderflowCount == 0 );
+    CHECK( statistics.inputOverflowCount == 1 );
+    CHECK( statistics.outputUnderflowCount == 2 );
+    CHECK( statistics.outputOverflowCount == 0 );
+
+    /* updates are bracketed, so the sequence is even whenever no update is in progress */
+    CHECK( (bp.statisticsSequence & 1) == 0 );
+
+    /* flushing the buffer processor keeps the statistics, only starting the stream clears them */
+    PaUtil_ResetBufferProcessor( &bp );
+    PaUtil_GetBufferProcessorStatistics( &bp, &statistics );
+    CHECK( statistics.callbackCount == 10 );
+
+    PaUtil_ResetBufferProcessorStatistics( &bp );
+    CHECK( (bp.statisticsSequence & 1) == 0 );
+    PaUtil_GetBufferProcessorStatistics( &bp, &statistics );
+    CHECK( statistics.callbackCount == 0 && statistics.wakeupCount == 0 );
+    CHECK( statistics.maxCallbackDuration == 0. && statistics.outputUnderflowCount == 0 );
+
+    /* the first wakeup after a reset isn't compared with the last one before it */
+    ProcessHostBuffer( &bp, t + 10., 0.01, 0 );
+    PaUtil_GetBufferProcessorStatistics( &bp, &statistics );
+    CHECK( statistics.callbackCount == 1 && statistics.wakeupCount == 0 );
+
+    PaUtil_TerminateBufferProcessor( &bp );
+
+    return CHECK_REPORT();
+}
@@ -0,0 +1,195 @@
+/** @file patest_trace.c
+	@ingroup test_src
+	@brief Tests the binary event trace rings in pa_trace.c.
+
+	Adds events to traces in both ring modes and checks, through
+	PaUtil_DumpTrace(), which events are retained, how their arguments are
+	formatted and how many are reported as dropped. Doesn't open any stream.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com/
+ * Copyright (c) 1999-2008 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "portaudio.h"
+#include "pa_util.h"
+#include "pa_trace.h"
+#include "patest_check.h"
+
+#define DUMP_FILE_NAME  "patest_trace.txt"
+#define MAX_LINES       (32)
+#define MAX_LINE_LENGTH (256)
+
+static char lines_[MAX_LINES][MAX_LINE_LENGTH];
+
+/* Dump the trace and read back the text of each event, without the time
+   stamp and thread prefix. Returns the number of lines. */
+static int DumpTraceLines( PaUtilTrace *trace )
+{
+    char line[MAX_LINE_LENGTH];
+    FILE *f;
+    int count = 0;
+
+    PaUtil_DumpTrace( trace, DUMP_FILE_NAME );
+
+    f = fopen( DUMP_FILE_NAME, "r" );
+    if( f == NULL )
+        return -1;
+    while( count < MAX_LINES && fgets( line, sizeof(line), f ) != NULL )
+    {
+        const char *text = strstr( line, "]: " );
+        line[strcspn( line, "\n" )] = '\0';
+        strcpy( lines_[count++], text != NULL ? text + 3 : line );
+    }
+    fclose( f );
+    remove( DUMP_FILE_NAME );
+
+    return count;
+}
+
+static void TraceEventV( PaUtilTrace *trace, const char *format, ... )
+{
+    va_list args;
+    va_start( args, format );
+    PaUtil_TraceEventV( trace, format, args );
+    va_end( args );
+}
+
+static void TestStopWhenFull( void )
+{
+    PaUtilTrace *trace = NULL;
+    int i;
+
+    printf( "paUtilTraceStopWhenFull\n" );
+
+    /* 3 records are rounded up to 4 */
+    CHECK( PaUtil_CreateTrace( &trace, 3, paUtilTraceStopWhenFull ) == paNoError );
+    if( trace == NULL )
+        return;
+
+    for( i = 0; i < 6; ++i )
+        PaUtil_TraceEvent( trace, "event %d", i, 0, 0, 0 );
+
+    CHECK( PaUtil_GetTraceDroppedCount( trace ) == 2 );
+    CHECK( DumpTraceLines( trace ) == 5 );
+    CHECK( strcmp( lines_[0], "event 0" ) == 0 );
+    CHECK( strcmp( lines_[3], "event 3" ) == 0 );
+    CHECK( strcmp( lines_[4], "2 events dropped" ) == 0 );
+
+    PaUtil_DestroyTrace( trace );
+}
+
+static void TestOverwrite( void )
+{
+    PaUtilTrace *trace = NULL;
+    int i;
+
+    printf( "paUtilTraceOverwrite\n" );
+
+    CHECK( PaUtil_CreateTrace( &trace, 4, paUtilTraceOverwrite ) == paNoError );
+    if( trace == NULL )
+        return;
+
+    for( i = 0; i < 10; ++i )
+        PaUtil_TraceEvent( trace, "event %d", i, 0, 0, 0 );
+
+    /* the newest events are kept, in order */
+    CHECK( PaUtil_GetTraceDroppedCount( trace ) == 0 );
+    CHECK( DumpTraceLines( trace ) == 4 );
+    for( i = 0; i < 4; ++i )
+    {
+        char expected[32];
+        sprintf( expected, "event %d", 6 + i );
+        CHECK( strcmp( lines_[i], expected ) == 0 );
+    }
+
+    /* a released ring keeps its events */
+    PaUtil_ReleaseTraceThread( trace );
+    CHECK( DumpTraceLines( trace ) == 4 );
+
+    PaUtil_DestroyTrace( trace );
+}
+
+static void TestFormatting( void )
+{
+    static const char *name = "callback";
+    PaUtilTrace *trace = NULL;
+
+    printf( "formatting\n" );
+
+    CHECK( PaUtil_CreateTrace( &trace, 16, paUtilTraceStopWhenFull ) == paNoError );
+    if( trace == NULL )
+        return;
+
+    PaUtil_TraceEvent( trace, "%d %u %x %ld", -1, 2, 255, 123456789 );
+    PaUtil_TraceEvent( trace, "only %d", 7, 8, 9, 10 );
+    PaUtil_TraceBegin( trace, name );
+    PaUtil_TraceEnd( trace, name );
+    TraceEventV( trace, "%s %.2f %d%%", "text", 0.5, 42 );
+
+    CHECK( DumpTraceLines( trace ) == 5 );
+    CHECK( strcmp( lines_[0], "-1 2 ff 123456789" ) == 0 );
+    CHECK( strcmp( lines_[1], "only 7" ) == 0 );
+    CHECK( strcmp( lines_[2], "begin callback" ) == 0 );
+    CHECK( strcmp( lines_[3], "end callback" ) == 0 );
+    CHECK( strcmp( lines_[4], "text 0.50 42%" ) == 0 );
+
+    PaUtil_DestroyTrace( trace );
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    printf( "PortAudio Test: event trace.\n" );
+
+    PaUtil_InitializeClock();
+
+    /* a NULL trace is ignored */
+    PaUtil_TraceEvent( NULL, "ignored", 0, 0, 0, 0 );
+    PaUtil_TraceBegin( NULL, "ignored" );
+    CHECK( PaUtil_GetTraceDroppedCount( NULL ) == 0 );
+
+    TestStopWhenFull();
+    TestOverwrite();
+    TestFormatting();
+
+    return CHECK_REPORT();
+}
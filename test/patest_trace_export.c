@@ -0,0 +1,375 @@
+/** @file patest_trace_export.c
+	@ingroup test_src
+	@brief Tests the Chrome Trace Event JSON export in pa_trace.c.
+
+	Exports a trace with spans, instant events, text needing escapes and
+	dropped events, then parses the file with a small JSON parser and checks
+	the events it contains. Doesn't open any stream.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com/
+ * Copyright (c) 1999-2008 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "portaudio.h"
+#include "pa_util.h"
+#include "pa_trace.h"
+#include "patest_check.h"
+
+#define EXPORT_FILE_NAME    "patest_trace_export.json"
+#define MAX_FILE_SIZE       (65536)
+#define MAX_EVENTS          (64)
+#define MAX_TEXT_LENGTH     (128)
+
+typedef struct
+{
+    char name[MAX_TEXT_LENGTH];
+    char ph[8];
+    char s[8];
+    double ts;
+    double tid;
+} TraceEvent;
+
+/* A strict parser for the subset of JSON used by the export, it fails on
+   anything which isn't valid JSON. */
+typedef struct
+{
+    const char *p;
+    TraceEvent events[MAX_EVENTS];
+    int eventCount;
+} JsonParser;
+
+static void SkipSpace( JsonParser *parser )
+{
+    while( *parser->p == ' ' || *parser->p == '\t' || *parser->p == '\n' || *parser->p == '\r' )
+        ++parser->p;
+}
+
+static int Expect( JsonParser *parser, char c )
+{
+    SkipSpace( parser );
+    if( *parser->p != c )
+        return 0;
+    ++parser->p;
+    return 1;
+}
+
+static int ParseString( JsonParser *parser, char *text, size_t size )
+{
+    size_t length = 0;
+
+    if( !Expect( parser, '"' ) )
+        return 0;
+
+    while( *parser->p != '"' )
+    {
+        char c = *parser->p++;
+
+        if( (unsigned char)c < 0x20 )
+            return 0; /* control characters must be escaped */
+        if( c == '\\' )
+        {
+            c = *parser->p++;
+            switch( c )
+            {
+            case '"': case '\\': case '/': break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case 'u':
+                {
+                    char hex[5];
+                    char *end;
+                    long value;
+
+                    memcpy( hex, parser->p, 4 );
+                    hex[4] = '\0';
+                    value = strtol( hex, &end, 16 );
+                    if( end != hex + 4 )
+                        return 0;
+                    parser->p += 4;
+                    c = value < 0x80 ? (char)value : '?';
+                }
+                break;
+            default:
+                return 0;
+            }
+        }
+        if( length + 1 < size )
+            text[length++] = c;
+    }
+    ++parser->p;
+
+    text[length] = '\0';
+    return 1;
+}
+
+static int ParseNumber( JsonParser *parser, double *value )
+{
+    char *end;
+
+    SkipSpace( parser );
+    if( *parser->p != '-' && (*parser->p < '0' || *parser->p > '9') )
+        return 0;
+    *value = strtod( parser->p, &end );
+    parser->p = end;
+    return 1;
+}
+
+static int ParseValue( JsonParser *parser );
+
+/* Parse an object, calling parseMember for each member, or skipping it if parseMember is NULL */
+static int ParseObject( JsonParser *parser, int (*parseMember)( JsonParser*, const char*, void* ), void *data )
+{
+    char key[MAX_TEXT_LENGTH];
+
+    if( !Expect( parser, '{' ) )
+        return 0;
+    if( Expect( parser, '}' ) )
+        return 1;
+
+    do
+    {
+        if( !ParseString( parser, key, sizeof(key) ) || !Expect( parser, ':' ) )
+            return 0;
+        if( parseMember != NULL ? !parseMember( parser, key, data ) : !ParseValue( parser ) )
+            return 0;
+    }
+    while( Expect( parser, ',' ) );
+
+    return Expect( parser, '}' );
+}
+
+static int ParseValue( JsonParser *parser )
+{
+    char text[MAX_TEXT_LENGTH];
+    double number;
+
+    SkipSpace( parser );
+    switch( *parser->p )
+    {
+    case '{':
+        return ParseObject( parser, NULL, NULL );
+    case '[':
+        ++parser->p;
+        if( Expect( parser, ']' ) )
+            return 1;
+        do
+        {
+            if( !ParseValue( parser ) )
+                return 0;
+        }
+        while( Expect( parser, ',' ) );
+        return Expect( parser, ']' );
+    case '"':
+        return ParseString( parser, text, sizeof(text) );
+    case 't':
+        parser->p += 4;
+        return strncmp( parser->p - 4, "true", 4 ) == 0;
+    case 'f':
+        parser->p += 5;
+        return strncmp( parser->p - 5, "false", 5 ) == 0;
+    case 'n':
+        parser->p += 4;
+        return strncmp( parser->p - 4, "null", 4 ) == 0;
+    default:
+        return ParseNumber( parser, &number );
+    }
+}
+
+static int ParseEventMember( JsonParser *parser, const char *key, void *data )
+{
+    TraceEvent *event = (TraceEvent*)data;
+
+    if( strcmp( key, "name" ) == 0 )
+        return ParseString( parser, event->name, sizeof(event->name) );
+    else if( strcmp( key, "ph" ) == 0 )
+        return ParseString( parser, event->ph, sizeof(event->ph) );
+    else if( strcmp( key, "s" ) == 0 )
+        return ParseString( parser, event->s, sizeof(event->s) );
+    else if( strcmp( key, "ts" ) == 0 )
+        return ParseNumber( parser, &event->ts );
+    else if( strcmp( key, "tid" ) == 0 )
+        return ParseNumber( parser, &event->tid );
+    else
+        return ParseValue( parser );
+}
+
+static int ParseDocumentMember( JsonParser *parser, const char *key, void *data )
+{
+    (void)data;
+
+    if( strcmp( key, "traceEvents" ) != 0 )
+        return ParseValue( parser );
+
+    if( !Expect( parser, '[' ) )
+        return 0;
+    do
+    {
+        TraceEvent event;
+
+        memset( &event, 0, sizeof(event) );
+        event.ts = -1.;
+        if( !ParseObject( parser, ParseEventMember, &event ) )
+            return 0;
+        if( parser->eventCount < MAX_EVENTS )
+            parser->events[parser->eventCount++] = event;
+    }
+    while( Expect( parser, ',' ) );
+
+    return Expect( parser, ']' );
+}
+
+/* Export the trace and parse the file. Returns 0 if it isn't valid JSON. */
+static int ExportAndParse( PaUtilTrace *trace, JsonParser *parser )
+{
+    static char text[MAX_FILE_SIZE];
+    FILE *f;
+    size_t length;
+    int result;
+
+    if( PaUtil_ExportChromeTrace( trace, EXPORT_FILE_NAME ) != paNoError )
+        return 0;
+
+    f = fopen( EXPORT_FILE_NAME, "rb" );
+    if( f == NULL )
+        return 0;
+    length = fread( text, 1, sizeof(text) - 1, f );
+    text[length] = '\0';
+    fclose( f );
+    remove( EXPORT_FILE_NAME );
+
+    parser->p = text;
+    parser->eventCount = 0;
+    result = ParseObject( parser, ParseDocumentMember, NULL );
+    SkipSpace( parser );
+    return result && *parser->p == '\0';
+}
+
+static void TraceEventV( PaUtilTrace *trace, const char *format, ... )
+{
+    va_list args;
+    va_start( args, format );
+    PaUtil_TraceEventV( trace, format, args );
+    va_end( args );
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    static JsonParser parser;
+    PaUtilTrace *trace = NULL;
+    const TraceEvent *event;
+    double lastTs = 0.;
+    int i, depth = 0;
+
+    printf( "PortAudio Test: Chrome trace export.\n" );
+
+    PaUtil_InitializeClock();
+
+    CHECK( PaUtil_CreateTrace( &trace, 8, paUtilTraceStopWhenFull ) == paNoError );
+    if( trace == NULL )
+        goto done;
+
+    PaUtil_TraceEvent( trace, "start, %d frames", 256, 0, 0, 0 );
+    for( i = 0; i < 2; ++i )
+    {
+        PaUtil_TraceBegin( trace, "callback" );
+        Pa_Sleep( 1 );
+        PaUtil_TraceEnd( trace, "callback" );
+    }
+    TraceEventV( trace, "%s", "a \"quoted\"\tname\\" );
+    PaUtil_TraceEvent( trace, "xrun %d", 1, 0, 0, 0 );
+    PaUtil_TraceEvent( trace, "full", 0, 0, 0, 0 );
+    PaUtil_TraceEvent( trace, "dropped", 0, 0, 0, 0 );
+    PaUtil_TraceEvent( trace, "dropped", 0, 0, 0, 0 );
+
+    CHECK( ExportAndParse( trace, &parser ) );
+    printf( "%d events parsed\n", parser.eventCount );
+
+    /* process name, 8 recorded events and the dropped event count */
+    CHECK( parser.eventCount == 10 );
+    if( parser.eventCount != 10 )
+        goto done;
+
+    event = &parser.events[0];
+    CHECK( strcmp( event->ph, "M" ) == 0 );
+
+    for( i = 1; i <= 8; ++i )
+    {
+        event = &parser.events[i];
+        CHECK( event->ts >= lastTs );
+        CHECK( event->tid == parser.events[1].tid );
+        lastTs = event->ts;
+
+        if( strcmp( event->ph, "B" ) == 0 )
+        {
+            CHECK( strcmp( event->name, "callback" ) == 0 );
+            ++depth;
+        }
+        else if( strcmp( event->ph, "E" ) == 0 )
+        {
+            CHECK( depth > 0 );
+            --depth;
+        }
+        else
+        {
+            CHECK( strcmp( event->ph, "i" ) == 0 && strcmp( event->s, "t" ) == 0 );
+        }
+    }
+    CHECK( depth == 0 );
+
+    CHECK( strcmp( parser.events[1].name, "start, 256 frames" ) == 0 );
+    CHECK( strcmp( parser.events[2].ph, "B" ) == 0 && strcmp( parser.events[3].ph, "E" ) == 0 );
+    CHECK( parser.events[3].ts - parser.events[2].ts >= 500. ); /* microseconds */
+    CHECK( strcmp( parser.events[6].name, "a \"quoted\"\tname\\" ) == 0 );
+    CHECK( strcmp( parser.events[7].name, "xrun 1" ) == 0 );
+    CHECK( strcmp( parser.events[8].name, "full" ) == 0 );
+    CHECK( strcmp( parser.events[9].name, "2 events dropped" ) == 0 );
+    CHECK( strcmp( parser.events[9].s, "g" ) == 0 );
+
+done:
+    PaUtil_DestroyTrace( trace );
+
+    return CHECK_REPORT();
+}